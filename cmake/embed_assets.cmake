@@ -0,0 +1,167 @@
+# Embed the web assets into the firmware.
+#
+# Run in script mode:
+#   cmake -DASSETS=<file>|<file>... -DOUTPUT=<path/web_assets.c> -P embed_assets.cmake
+#
+# Every asset is minified (text types only) and emitted twice as const byte
+# arrays, gzip-compressed and plain, each with its own strong ETag and prebuilt
+# 200 / 304 response headers, so the server can send either straight from flash.
+# The server picks gzip when the request's Accept-Encoding allows it and the
+# plain copy otherwise; the headers carry Vary: Accept-Encoding. Pages are
+# cacheable but always revalidated (Cache-Control: no-cache), so a reload costs a
+# 304 instead of the whole page.
+# Routes: index.html -> "/", name.html -> "/name", anything else -> "/<file name>".
+
+cmake_minimum_required(VERSION 3.18) # file(ARCHIVE_CREATE ... COMPRESSION GZip)
+
+if(NOT ASSETS OR NOT OUTPUT)
+    message(FATAL_ERROR "embed_assets.cmake: ASSETS and OUTPUT are required")
+endif()
+
+string(REPLACE "|" ";" ASSETS "${ASSETS}")
+get_filename_component(OUTPUT_DIR "${OUTPUT}" DIRECTORY)
+set(WORK_DIR "${OUTPUT_DIR}/web_assets")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+# Whitespace-level minifier: keeps line breaks so JS without semicolons stays valid
+function(minify_text content out_var)
+    string(REGEX REPLACE "<!--[^>]*-->" "" content "${content}")
+    string(REGEX REPLACE "[ \t\r]*\n[ \t]*" "\n" content "${content}")
+    string(REGEX REPLACE "\n//[^\n]*" "" content "${content}")
+    string(REGEX REPLACE "\n\n+" "\n" content "${content}")
+    string(REGEX REPLACE "^[ \t\n]+" "" content "${content}")
+    string(REGEX REPLACE "[ \t\n]+$" "" content "${content}")
+    set(${out_var} "${content}" PARENT_SCOPE)
+endfunction()
+
+# File contents as a C initialiser list, 16 bytes per row
+function(byte_array path gzip out_var)
+    file(READ "${path}" bytes HEX)
+    if(gzip)
+        # Zero the gzip header timestamp so identical assets give identical output
+        string(REGEX REPLACE "^(1f8b08[0-9a-f][0-9a-f])[0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f][0-9a-f]"
+               "\\100000000" bytes "${bytes}")
+    endif()
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1, " bytes "${bytes}")
+    string(REPEAT "0x[0-9a-f][0-9a-f], " 16 row)
+    string(REGEX REPLACE "(${row})" "\\1\n    " bytes "${bytes}")
+    string(REGEX REPLACE " \n" "\n" bytes "${bytes}")
+    string(REGEX REPLACE "[ \n]+$" "" bytes "${bytes}")
+    set(${out_var} "${bytes}" PARENT_SCOPE)
+endfunction()
+
+# Prebuilt 200 and 304 headers of one body. Both say Vary: Accept-Encoding, so a
+# cache never hands the gzip body to a client that did not ask for it.
+function(response_headers prefix type encoding length etag out_var)
+    string(CONCAT headers
+        "static const char ${prefix}_header[] =\n"
+        "    \"HTTP/1.1 200 OK\\r\\n\"\n"
+        "    \"Content-Type: ${type}\\r\\n\"\n")
+    if(encoding)
+        string(APPEND headers "    \"${encoding}\"\n")
+    endif()
+    string(APPEND headers
+        "    \"Content-Length: ${length}\\r\\n\"\n"
+        "    \"Vary: Accept-Encoding\\r\\n\"\n"
+        "    \"ETag: \\\"${etag}\\\"\\r\\n\"\n"
+        "    \"Cache-Control: no-cache\\r\\n\";\n"
+        "static const char ${prefix}_not_modified[] =\n"
+        "    \"HTTP/1.1 304 Not Modified\\r\\n\"\n"
+        "    \"Vary: Accept-Encoding\\r\\n\"\n"
+        "    \"ETag: \\\"${etag}\\\"\\r\\n\"\n"
+        "    \"Cache-Control: no-cache\\r\\n\";\n")
+    set(${out_var} "${headers}" PARENT_SCOPE)
+endfunction()
+
+set(ARRAYS "")
+set(TABLE "")
+set(COUNT 0)
+
+foreach(asset IN LISTS ASSETS)
+    get_filename_component(name "${asset}" NAME)
+    get_filename_component(stem "${asset}" NAME_WE)
+    get_filename_component(ext "${asset}" LAST_EXT)
+    string(TOLOWER "${ext}" ext)
+    string(MAKE_C_IDENTIFIER "${name}" symbol)
+
+    # Route
+    if(name STREQUAL "index.html")
+        set(route "/")
+    elseif(ext STREQUAL ".html")
+        set(route "/${stem}")
+    else()
+        set(route "/${name}")
+    endif()
+
+    # Content type (only text types are minified)
+    set(minify TRUE)
+    if(ext STREQUAL ".html")
+        set(type "text/html; charset=utf-8")
+    elseif(ext STREQUAL ".css")
+        set(type "text/css")
+    elseif(ext STREQUAL ".js")
+        set(type "application/javascript")
+    elseif(ext STREQUAL ".json")
+        set(type "application/json")
+    elseif(ext STREQUAL ".svg")
+        set(type "image/svg+xml")
+    else()
+        set(type "application/octet-stream")
+        set(minify FALSE)
+    endif()
+
+    # 1. Minify
+    set(plain "${WORK_DIR}/${name}")
+    if(minify)
+        file(READ "${asset}" content)
+        minify_text("${content}" content)
+        file(WRITE "${plain}" "${content}")
+    else()
+        configure_file("${asset}" "${plain}" COPYONLY)
+    endif()
+
+    # 2. Compress
+    set(packed "${WORK_DIR}/${name}.gz")
+    file(REMOVE "${packed}")
+    file(ARCHIVE_CREATE OUTPUT "${packed}" PATHS "${plain}" FORMAT raw
+         COMPRESSION GZip COMPRESSION_LEVEL 9)
+    file(SIZE "${packed}" length)
+    file(SIZE "${plain}" plain_length)
+
+    # 3. Strong ETag: hash of what the client ends up with; the gzip body is a
+    #    different representation, so it gets the same hash with a "-gz" suffix
+    file(SHA1 "${plain}" hash)
+    string(SUBSTRING "${hash}" 0 16 etag)
+
+    # 4. Emit both bodies
+    byte_array("${packed}" TRUE gzip_bytes)
+    byte_array("${plain}" FALSE plain_bytes)
+    response_headers(${symbol}_gzip "${type}" "Content-Encoding: gzip\\r\\n" ${length} "${etag}-gz" gzip_headers)
+    response_headers(${symbol}_identity "${type}" "" ${plain_length} "${etag}" identity_headers)
+
+    string(APPEND ARRAYS
+        "// ${name}: ${plain_length} bytes minified, ${length} gzipped\n"
+        "static const uint8_t ${symbol}_gzip_data[${length}] = {\n    ${gzip_bytes}\n};\n"
+        "static const uint8_t ${symbol}_identity_data[${plain_length}] = {\n    ${plain_bytes}\n};\n"
+        "${gzip_headers}${identity_headers}\n")
+    string(APPEND TABLE
+        "    {\"${route}\", \"${type}\",\n"
+        "     {\"\\\"${etag}-gz\\\"\", ${symbol}_gzip_data, sizeof(${symbol}_gzip_data),\n"
+        "      ${symbol}_gzip_header, sizeof(${symbol}_gzip_header) - 1,\n"
+        "      ${symbol}_gzip_not_modified, sizeof(${symbol}_gzip_not_modified) - 1},\n"
+        "     {\"\\\"${etag}\\\"\", ${symbol}_identity_data, sizeof(${symbol}_identity_data),\n"
+        "      ${symbol}_identity_header, sizeof(${symbol}_identity_header) - 1,\n"
+        "      ${symbol}_identity_not_modified, sizeof(${symbol}_identity_not_modified) - 1}},\n")
+    math(EXPR COUNT "${COUNT} + 1")
+endforeach()
+
+string(CONCAT SOURCE
+    "// Generated by cmake/embed_assets.cmake from the files in web/ - do not edit\n"
+    "#include \"web_assets.h\"\n\n"
+    "${ARRAYS}"
+    "const web_asset_t web_assets[] = {\n${TABLE}};\n\n"
+    "const uint16_t web_asset_count = ${COUNT};\n")
+
+# Only touch the output when it changes, so unchanged assets do not trigger a rebuild
+file(WRITE "${WORK_DIR}/web_assets.c.tmp" "${SOURCE}")
+configure_file("${WORK_DIR}/web_assets.c.tmp" "${OUTPUT}" COPYONLY)
@@ -0,0 +1,150 @@
+#include "color_lab.h"
+#include "correctness.h"
+
+// Normalised channel value: Q15 (32768 = white)
+#define LAB_ONE_Q15 32768u
+
+// 2^31 / white (a Q31 reciprocal), so normalisation is a multiply: (hz * recip) >> 16 is Q15
+#define LAB_WHITE_RECIP(white_hz) ((uint32_t)((1ull << 31) / (white_hz)))
+
+// sRGB (D65) -> XYZ with each row divided by the white point (X/Xn, Y/Yn, Z/Zn), Q12.
+// Rows sum to 4096 so the white reference maps to (1, 1, 1).
+static const int32_t rgb_to_xyz_q12[3][3] = {
+    {1777, 1541, 778},
+    {871, 2929, 296},
+    {73, 448, 3575},
+};
+
+// CIELAB companding f(t) in Q15, sampled at t = i / 256 for i = 0..256:
+//   f(t) = t^(1/3)                       for t >  (6/29)^3
+//   f(t) = t / (3 * (6/29)^2) + 4 / 29   otherwise
+// Generated offline with round(f(i / 256) * 32768); interpolated linearly in between.
+static const uint16_t lab_f_lut[257] = {
+    4520, 5516, 6513, 7443, 8192, 8825, 9377, 9872, 10321, 10735, 11118, 11477,
+    11815, 12134, 12438, 12727, 13004, 13269, 13525, 13771, 14008, 14238, 14460, 14676,
+    14886, 15090, 15288, 15482, 15671, 15855, 16035, 16212, 16384, 16553, 16718, 16881,
+    17040, 17196, 17350, 17501, 17649, 17795, 17939, 18080, 18219, 18356, 18491, 18624,
+    18755, 18884, 19012, 19138, 19262, 19385, 19506, 19626, 19744, 19861, 19976, 20090,
+    20203, 20315, 20425, 20534, 20643, 20750, 20855, 20960, 21064, 21167, 21268, 21369,
+    21469, 21568, 21666, 21763, 21860, 21955, 22050, 22143, 22237, 22329, 22420, 22511,
+    22601, 22690, 22779, 22867, 22954, 23041, 23127, 23212, 23297, 23381, 23465, 23547,
+    23630, 23712, 23793, 23873, 23954, 24033, 24112, 24191, 24269, 24346, 24423, 24500,
+    24576, 24652, 24727, 24801, 24876, 24950, 25023, 25096, 25168, 25241, 25312, 25384,
+    25454, 25525, 25595, 25665, 25734, 25803, 25872, 25940, 26008, 26076, 26143, 26210,
+    26276, 26342, 26408, 26474, 26539, 26604, 26668, 26733, 26797, 26860, 26924, 26987,
+    27049, 27112, 27174, 27236, 27298, 27359, 27420, 27481, 27541, 27602, 27662, 27721,
+    27781, 27840, 27899, 27958, 28016, 28074, 28132, 28190, 28248, 28305, 28362, 28419,
+    28476, 28532, 28588, 28644, 28700, 28755, 28811, 28866, 28921, 28975, 29030, 29084,
+    29138, 29192, 29246, 29299, 29352, 29405, 29458, 29511, 29564, 29616, 29668, 29720,
+    29772, 29823, 29875, 29926, 29977, 30028, 30079, 30129, 30180, 30230, 30280, 30330,
+    30379, 30429, 30478, 30528, 30577, 30626, 30674, 30723, 30771, 30820, 30868, 30916,
+    30964, 31012, 31059, 31107, 31154, 31201, 31248, 31295, 31341, 31388, 31434, 31481,
+    31527, 31573, 31619, 31665, 31710, 31756, 31801, 31846, 31891, 31936, 31981, 32026,
+    32071, 32115, 32159, 32204, 32248, 32292, 32336, 32379, 32423, 32467, 32510, 32553,
+    32596, 32639, 32682, 32725, 32768,
+};
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+static uint32_t lab_normalise(uint32_t hz, uint32_t white_hz, uint32_t white_recip)
+{
+    // Brighter than the white reference saturates at white
+    if (hz >= white_hz)
+        return LAB_ONE_Q15;
+    return (hz * white_recip) >> 16;
+}
+
+static uint32_t lab_isqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+
+    while (bit > value)
+        bit >>= 2;
+
+    while (bit != 0)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+// -----------------------------------------------------------------------------
+// Public API implementation
+// -----------------------------------------------------------------------------
+
+int32_t color_lab_f(int32_t t_q15)
+{
+    if (t_q15 <= 0)
+        return lab_f_lut[0];
+    if (t_q15 >= (int32_t)LAB_ONE_Q15)
+        return lab_f_lut[256];
+
+    const int32_t index = t_q15 >> 7;
+    const int32_t frac = t_q15 & 0x7F;
+    const int32_t lo = lab_f_lut[index];
+    const int32_t hi = lab_f_lut[index + 1];
+    return lo + (((hi - lo) * frac) >> 7);
+}
+
+void color_lab_from_hz(uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, color_lab_t *lab)
+{
+    // 1. Normalise to the white reference (the sensor output is already linear in light)
+    const int32_t rgb[3] = {
+        (int32_t)lab_normalise(r_hz, COLOR_LAB_WHITE_R_HZ, LAB_WHITE_RECIP(COLOR_LAB_WHITE_R_HZ)),
+        (int32_t)lab_normalise(g_hz, COLOR_LAB_WHITE_G_HZ, LAB_WHITE_RECIP(COLOR_LAB_WHITE_G_HZ)),
+        (int32_t)lab_normalise(b_hz, COLOR_LAB_WHITE_B_HZ, LAB_WHITE_RECIP(COLOR_LAB_WHITE_B_HZ)),
+    };
+
+    // 2. Linear RGB -> white-relative XYZ -> f()
+    int32_t f[3];
+    for (int i = 0; i < 3; i++)
+    {
+        const int32_t t = (rgb_to_xyz_q12[i][0] * rgb[0] +
+                           rgb_to_xyz_q12[i][1] * rgb[1] +
+                           rgb_to_xyz_q12[i][2] * rgb[2]) >> 12;
+        f[i] = color_lab_f(t);
+    }
+
+    // 3. L = 116 fy - 16, a = 500 (fx - fy), b = 200 (fy - fz), scaled from Q15 to Q4
+    lab->l = ((116 * f[1]) / 2048) - 16 * 16;
+    lab->a = (500 * (f[0] - f[1])) / 2048;
+    lab->b = (200 * (f[1] - f[2])) / 2048;
+}
+
+uint32_t color_lab_delta_e(const color_lab_t *x, const color_lab_t *y)
+{
+    const int32_t dl = x->l - y->l;
+    const int32_t da = x->a - y->a;
+    const int32_t db = x->b - y->b;
+
+    // Each term is < 8000^2 in Q4, so the sum fits in 32 bits
+    return lab_isqrt((uint32_t)(dl * dl) + (uint32_t)(da * da) + (uint32_t)(db * db));
+}
+
+uint16_t color_lab_score(uint32_t delta_e_q4)
+{
+    const uint32_t zero_q4 = COLOR_LAB_DELTA_E_ZERO * 16u;
+    if (delta_e_q4 >= zero_q4)
+        return 0;
+
+    return (uint16_t)(CORRECTNESS_MAX - (delta_e_q4 * CORRECTNESS_MAX) / zero_q4);
+}
+
+uint16_t color_lab_correctness(const color_lab_t *target, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz)
+{
+    color_lab_t reading;
+    color_lab_from_hz(r_hz, g_hz, b_hz, &reading);
+    return color_lab_score(color_lab_delta_e(target, &reading));
+}
@@ -0,0 +1,44 @@
+#ifndef COLOR_LAB_H
+#define COLOR_LAB_H
+
+#include <stdint.h>
+
+// --- PERCEPTUAL (CIELAB DELTA-E) SCORING ---
+// Sensor reading of a white reference at TCS3200_REFERENCE_SCALE, per channel.
+// Readings are normalised to this before the color space conversion.
+#define COLOR_LAB_WHITE_R_HZ 5000
+#define COLOR_LAB_WHITE_G_HZ 5000
+#define COLOR_LAB_WHITE_B_HZ 5000
+
+// Delta-E at which the score reaches 0 % (the score falls linearly from 100 % at Delta-E 0,
+// so 97 % corresponds to Delta-E 3)
+#define COLOR_LAB_DELTA_E_ZERO 100
+
+// A CIELAB color, every component in Q4 (1/16 of a Lab unit)
+typedef struct
+{
+    int32_t l;
+    int32_t a;
+    int32_t b;
+} color_lab_t;
+
+// CIELAB companding f(t) of a white-relative X, Y or Z (Q15 in and out): the
+// lab_f_lut table in color_lab.c, exact at t = i / 256 and interpolated in between
+int32_t color_lab_f(int32_t t_q15);
+
+// Convert three normalised sensor readings (Hz) to CIELAB (D65 white)
+void color_lab_from_hz(uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, color_lab_t *lab);
+
+// CIE76 Delta-E between two colors, Q4
+uint32_t color_lab_delta_e(const color_lab_t *x, const color_lab_t *y);
+
+// Score for a Delta-E (Q4): linear from CORRECTNESS_MAX at 0 down to 0 at COLOR_LAB_DELTA_E_ZERO
+uint16_t color_lab_score(uint32_t delta_e_q4);
+
+/**
+ * @brief Perceptual correctness of a reading against a target already converted to Lab.
+ * @return Correctness in tenths of a percent (0..CORRECTNESS_MAX).
+ */
+uint16_t color_lab_correctness(const color_lab_t *target, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz);
+
+#endif
@@ -1,4 +1,8 @@
 #include "color_sensor.h"
+#if TCS3200_USE_PWM_COUNTER
+#include "hardware/pwm.h"
+#include "hardware/irq.h"
+#endif
 
 // -----------------------------------------------------------------------------
 // Internal helpers
@@ -58,6 +62,217 @@ static inline void tcs3200_set_s2_s3(tcs3200_filter_t filter)
     }
 }
 
+// Output scaling in percent, indexed by tcs3200_scale_t
+static const uint8_t scale_percent[4] = {0, 2, 20, 100};
+
+static tcs3200_scale_t current_scale = TCS3200_SCALE_POWER_DOWN;
+
+// Convert a reading taken at `scale` to what it would be at TCS3200_REFERENCE_SCALE
+static uint32_t tcs3200_normalise(uint32_t hz, tcs3200_scale_t scale)
+{
+    if (scale_percent[scale] == 0)
+        return 0;
+    return (uint32_t)(((uint64_t)hz * scale_percent[TCS3200_REFERENCE_SCALE]) / scale_percent[scale]);
+}
+
+// Inverse of tcs3200_normalise: expected OUT frequency at `scale`
+static uint32_t tcs3200_denormalise(uint32_t ref_hz, tcs3200_scale_t scale)
+{
+    return (uint32_t)(((uint64_t)ref_hz * scale_percent[scale]) / scale_percent[TCS3200_REFERENCE_SCALE]);
+}
+
+#if TCS3200_USE_PWM_COUNTER
+// -----------------------------------------------------------------------------
+// Hardware edge counter (PWM slice clocked by rising edges on channel B)
+// -----------------------------------------------------------------------------
+
+static uint tcs3200_slice;
+static volatile uint32_t tcs3200_wraps = 0; // Number of 16-bit counter overflows
+
+static void tcs3200_counter_wrap_isr(void)
+{
+    // PWM_IRQ_WRAP is shared by all slices, only handle ours
+    if (pwm_get_irq_status_mask() & (1u << tcs3200_slice))
+    {
+        pwm_clear_irq(tcs3200_slice);
+        tcs3200_wraps++;
+    }
+}
+
+static void tcs3200_counter_init(void)
+{
+    gpio_set_function(TCS3200_OUT_PIN, GPIO_FUNC_PWM);
+    tcs3200_slice = pwm_gpio_to_slice_num(TCS3200_OUT_PIN);
+
+    pwm_config config = pwm_get_default_config();
+    pwm_config_set_clkdiv_mode(&config, PWM_DIV_B_RISING); // +1 per rising edge on OUT
+    pwm_config_set_clkdiv(&config, 1.0f);
+    pwm_config_set_wrap(&config, 0xFFFF);
+
+    pwm_clear_irq(tcs3200_slice);
+    pwm_set_irq_enabled(tcs3200_slice, true);
+    irq_add_shared_handler(PWM_IRQ_WRAP, tcs3200_counter_wrap_isr,
+                           PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(PWM_IRQ_WRAP, true);
+
+    pwm_init(tcs3200_slice, &config, true);
+}
+
+// Free-running 32-bit edge count (overflow count + live 16-bit counter)
+static uint32_t tcs3200_counter_read(void)
+{
+    uint32_t wraps, low;
+    do
+    {
+        wraps = tcs3200_wraps;
+        low = pwm_get_counter(tcs3200_slice);
+    } while (wraps != tcs3200_wraps); // Retry if the counter wrapped in between
+
+    // Wrapped but the ISR has not run yet (e.g. called with interrupts masked)
+    if ((pwm_get_irq_status_mask() & (1u << tcs3200_slice)) && low < 0x8000u)
+        wraps++;
+
+    return (wraps << 16) | low;
+}
+
+// -----------------------------------------------------------------------------
+// Rising edge timestamp capture (reciprocal mode)
+// -----------------------------------------------------------------------------
+
+static volatile bool edge_captured = false;
+static volatile uint32_t edge_time_us = 0;
+static volatile uint32_t edge_count = 0;
+
+static void tcs3200_edge_isr(uint gpio, uint32_t events)
+{
+    (void)events;
+    if (gpio != TCS3200_OUT_PIN)
+        return;
+
+    // Timestamp first, then the edge count that goes with it
+    edge_time_us = time_us_32();
+    edge_count = tcs3200_counter_read();
+
+    // One-shot: re-armed by tcs3200_edge_arm()
+    gpio_set_irq_enabled(TCS3200_OUT_PIN, GPIO_IRQ_EDGE_RISE, false);
+    edge_captured = true;
+}
+
+static void tcs3200_edge_arm(void)
+{
+    edge_captured = false;
+    gpio_set_irq_enabled(TCS3200_OUT_PIN, GPIO_IRQ_EDGE_RISE, true);
+}
+
+static void tcs3200_edge_disarm(void)
+{
+    gpio_set_irq_enabled(TCS3200_OUT_PIN, GPIO_IRQ_EDGE_RISE, false);
+}
+
+// -----------------------------------------------------------------------------
+// Single-channel measurement state machine (shared by blocking and async paths)
+// -----------------------------------------------------------------------------
+
+typedef enum
+{
+    MEAS_IDLE,
+    MEAS_GATE,       // Gate-count: counting for a fixed time
+    MEAS_FIRST_EDGE, // Reciprocal: waiting for the edge that opens the window
+    MEAS_WINDOW,     // Reciprocal: window open, counting periods
+    MEAS_LAST_EDGE   // Reciprocal: waiting for the edge that closes the window
+} tcs3200_meas_state_t;
+
+static tcs3200_mode_t meas_mode = TCS3200_MODE_GATE_COUNT;
+static tcs3200_meas_state_t meas_state = MEAS_IDLE;
+static uint32_t meas_gate_us = 0;
+static uint32_t meas_start_us = 0;
+static uint32_t meas_start_count = 0;
+
+static void meas_start(uint32_t gate_time_us)
+{
+    meas_start_us = time_us_32();
+
+    if (meas_mode == TCS3200_MODE_RECIPROCAL)
+    {
+        tcs3200_edge_arm();
+        meas_state = MEAS_FIRST_EDGE;
+    }
+    else
+    {
+        meas_gate_us = gate_time_us;
+        meas_start_count = tcs3200_counter_read();
+        meas_state = MEAS_GATE;
+    }
+}
+
+// Returns true once the measurement has finished and *hz holds the result
+static bool meas_poll(uint32_t *hz)
+{
+    const uint32_t now = time_us_32();
+
+    switch (meas_state)
+    {
+    case MEAS_GATE:
+    {
+        const uint32_t elapsed_us = now - meas_start_us;
+        if (elapsed_us < meas_gate_us)
+            return false;
+
+        // The real elapsed time is used so a late poll does not bias the result
+        const uint32_t count = tcs3200_counter_read() - meas_start_count;
+        *hz = elapsed_us ? (uint32_t)(((uint64_t)count * 1000000u) / elapsed_us) : 0;
+        break;
+    }
+
+    case MEAS_FIRST_EDGE:
+        if (!edge_captured)
+        {
+            if ((now - meas_start_us) < TCS3200_RECIP_TIMEOUT_MS * 1000u)
+                return false;
+            tcs3200_edge_disarm();
+            *hz = 0; // No light, no edges
+            break;
+        }
+        meas_start_us = edge_time_us;
+        meas_start_count = edge_count;
+        meas_state = MEAS_WINDOW;
+        return false;
+
+    case MEAS_WINDOW:
+        if ((now - meas_start_us) < TCS3200_RECIP_WINDOW_US)
+            return false;
+        // Close the window on the next whole period
+        tcs3200_edge_arm();
+        meas_state = MEAS_LAST_EDGE;
+        return false;
+
+    case MEAS_LAST_EDGE:
+    {
+        if (!edge_captured)
+        {
+            if ((now - meas_start_us) < TCS3200_RECIP_TIMEOUT_MS * 1000u)
+                return false;
+            tcs3200_edge_disarm();
+            *hz = 0;
+            break;
+        }
+        const uint32_t periods = edge_count - meas_start_count;
+        const uint32_t span_us = edge_time_us - meas_start_us;
+        // Rounded periods * 1e6 / span
+        *hz = span_us ? (uint32_t)(((uint64_t)periods * 1000000u + span_us / 2u) / span_us) : 0;
+        break;
+    }
+
+    case MEAS_IDLE:
+    default:
+        return false;
+    }
+
+    meas_state = MEAS_IDLE;
+    return true;
+}
+#endif
+
 // -----------------------------------------------------------------------------
 // Public API implementation
 // -----------------------------------------------------------------------------
@@ -80,6 +295,14 @@ void TCS3200_Init(void)
     // Configure OUT pin as input for frequency measurement
     gpio_init(TCS3200_OUT_PIN);
     gpio_set_dir(TCS3200_OUT_PIN, GPIO_IN);
+#if TCS3200_USE_PWM_COUNTER
+    // Hand the OUT pin to the PWM slice so edges are counted in hardware
+    tcs3200_counter_init();
+
+    // Edge interrupts stay masked until a reciprocal measurement arms them
+    gpio_set_irq_callback(tcs3200_edge_isr);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+#endif
 
     // Default scaling: 20% (good for MCUs)
     TCS3200_SetFrequencyScaling(TCS3200_SCALE_20_PERCENT);
@@ -90,6 +313,7 @@ void TCS3200_Init(void)
 void TCS3200_SetFrequencyScaling(tcs3200_scale_t scale)
 {
     tcs3200_set_s0_s1(scale);
+    current_scale = scale;
 }
 
 void TCS3200_SetFilter(tcs3200_filter_t filter)
@@ -97,6 +321,34 @@ void TCS3200_SetFilter(tcs3200_filter_t filter)
     tcs3200_set_s2_s3(filter);
 }
 
+void TCS3200_SetMeasureMode(tcs3200_mode_t mode)
+{
+#if TCS3200_USE_PWM_COUNTER
+    meas_mode = mode;
+#else
+    (void)mode; // Polling backend only supports gate counting
+#endif
+}
+
+#if TCS3200_USE_PWM_COUNTER
+uint32_t TCS3200_ReadFrequencyHz(uint32_t gate_time_ms)
+{
+    if (gate_time_ms == 0 && meas_mode == TCS3200_MODE_GATE_COUNT)
+        return 0;
+
+    uint32_t hz = 0;
+    meas_start(gate_time_ms * 1000u);
+
+    // Edges are counted by the PWM slice, so we just sleep through the gate
+    if (meas_mode == TCS3200_MODE_GATE_COUNT)
+        sleep_us((uint64_t)gate_time_ms * 1000u);
+
+    while (!meas_poll(&hz))
+        tight_loop_contents();
+
+    return hz;
+}
+#else
 uint32_t TCS3200_ReadFrequencyHz(uint32_t gate_time_ms)
 {
     if (gate_time_ms == 0)
@@ -140,6 +392,7 @@ uint32_t TCS3200_ReadFrequencyHz(uint32_t gate_time_ms)
     uint32_t freq_hz = (count * 1000u) / gate_time_ms;
     return freq_hz;
 }
+#endif
 
 void TCS3200_ReadRGB(uint32_t gate_time_ms,
                      uint32_t *r_hz,
@@ -149,21 +402,191 @@ void TCS3200_ReadRGB(uint32_t gate_time_ms,
     if (!r_hz || !g_hz || !b_hz)
         return;
 
-    // RED
-    TCS3200_SetFilter(TCS3200_FILTER_RED);
-    sleep_ms(10); // Allow settling
-    *r_hz = TCS3200_ReadFrequencyHz(gate_time_ms);
+    // Blocking wrapper around the acquisition state machine
+    TCS3200_StartRGB(gate_time_ms);
+    while (!TCS3200_PollRGB())
+        tight_loop_contents();
+
+    TCS3200_GetRGB(r_hz, g_hz, b_hz);
+}
+
+// -----------------------------------------------------------------------------
+// Non-blocking acquisition state machine
+// -----------------------------------------------------------------------------
+
+typedef enum
+{
+    ACQ_IDLE,
+    ACQ_SETTLE,  // Filter selected, waiting for the output to settle
+    ACQ_MEASURE, // Single-channel measurement running
+    ACQ_DONE     // Result ready, waiting to be collected
+} tcs3200_acq_state_t;
+
+// Acquisition order; CLEAR is only measured when enabled with TCS3200_SetAcquireClear()
+#define ACQ_MAX_CHANNELS 4
+static const tcs3200_filter_t acq_filters[ACQ_MAX_CHANNELS] = {
+    TCS3200_FILTER_RED,
+    TCS3200_FILTER_GREEN,
+    TCS3200_FILTER_BLUE,
+    TCS3200_FILTER_CLEAR,
+};
+
+static tcs3200_acq_state_t acq_state = ACQ_IDLE;
+static uint8_t acq_channel = 0;
+static uint8_t acq_channel_count = 3;
+static uint32_t acq_gate_ms = 0;
+static uint32_t acq_phase_start_us = 0;
+static uint32_t acq_raw_hz = 0;
+static uint32_t acq_result_hz[ACQ_MAX_CHANNELS] = {0, 0, 0, 0}; // Normalised to TCS3200_REFERENCE_SCALE
+
+// Auto-ranging state, per channel
+static bool autorange_enabled = false;
+static tcs3200_scale_t acq_scale[ACQ_MAX_CHANNELS] = {TCS3200_REFERENCE_SCALE, TCS3200_REFERENCE_SCALE,
+                                                       TCS3200_REFERENCE_SCALE, TCS3200_REFERENCE_SCALE};
+static uint32_t acq_gate_us[ACQ_MAX_CHANNELS] = {0, 0, 0, 0};
+
+static void autorange_select(uint8_t channel)
+{
+    // Previous reading of this channel predicts the next one
+    const uint32_t ref_hz = acq_result_hz[channel];
+
+    // Highest scale that keeps OUT within what we can count: more edges per
+    // unit time means a shorter gate for the same count
+    tcs3200_scale_t scale = TCS3200_SCALE_100_PERCENT;
+    while (scale > TCS3200_SCALE_2_PERCENT && tcs3200_denormalise(ref_hz, scale) > TCS3200_AUTORANGE_MAX_HZ)
+        scale--;
+
+    // Shortest gate that reaches the target count (dark or first reading: longest gate)
+    const uint32_t expected_hz = tcs3200_denormalise(ref_hz, scale);
+    uint32_t gate_us = TCS3200_AUTORANGE_MAX_GATE_US;
+    if (expected_hz > 0)
+        gate_us = (uint32_t)(((uint64_t)TCS3200_AUTORANGE_TARGET_COUNT * 1000000u) / expected_hz);
+
+    if (gate_us < TCS3200_AUTORANGE_MIN_GATE_US)
+        gate_us = TCS3200_AUTORANGE_MIN_GATE_US;
+    if (gate_us > TCS3200_AUTORANGE_MAX_GATE_US)
+        gate_us = TCS3200_AUTORANGE_MAX_GATE_US;
+
+    acq_scale[channel] = scale;
+    acq_gate_us[channel] = gate_us;
+}
+
+static void acq_begin_channel(uint8_t channel)
+{
+    acq_channel = channel;
+
+    if (autorange_enabled)
+    {
+        autorange_select(channel);
+        // Scale is only switched here, so the filter settle time covers it too
+        tcs3200_set_s0_s1(acq_scale[channel]);
+    }
+    else
+    {
+        acq_scale[channel] = current_scale;
+        acq_gate_us[channel] = acq_gate_ms * 1000u;
+    }
+
+    TCS3200_SetFilter(acq_filters[channel]);
+    acq_phase_start_us = time_us_32();
+    acq_state = ACQ_SETTLE;
+}
+
+void TCS3200_SetAutoRange(bool enable)
+{
+    autorange_enabled = enable;
+    if (!enable)
+        tcs3200_set_s0_s1(current_scale); // Back to the caller's fixed scale
+}
+
+void TCS3200_GetRGBScale(tcs3200_scale_t *r_scale, tcs3200_scale_t *g_scale, tcs3200_scale_t *b_scale)
+{
+    if (r_scale)
+        *r_scale = acq_scale[0];
+    if (g_scale)
+        *g_scale = acq_scale[1];
+    if (b_scale)
+        *b_scale = acq_scale[2];
+}
+
+void TCS3200_SetAcquireClear(bool enable)
+{
+    acq_channel_count = enable ? 4u : 3u;
+}
 
-    // GREEN
-    TCS3200_SetFilter(TCS3200_FILTER_GREEN);
-    sleep_ms(10);
-    *g_hz = TCS3200_ReadFrequencyHz(gate_time_ms);
+void TCS3200_GetClear(uint32_t *c_hz, tcs3200_scale_t *c_scale)
+{
+    if (c_hz)
+        *c_hz = acq_result_hz[3];
+    if (c_scale)
+        *c_scale = acq_scale[3];
+}
 
-    // BLUE
-    TCS3200_SetFilter(TCS3200_FILTER_BLUE);
-    sleep_ms(10);
-    *b_hz = TCS3200_ReadFrequencyHz(gate_time_ms);
+void TCS3200_StartRGB(uint32_t gate_time_ms)
+{
+    acq_gate_ms = gate_time_ms;
+    acq_begin_channel(0);
+}
+
+bool TCS3200_PollRGB(void)
+{
+    switch (acq_state)
+    {
+    case ACQ_SETTLE:
+        if ((time_us_32() - acq_phase_start_us) < TCS3200_SETTLE_MS * 1000u)
+            return false;
+#if TCS3200_USE_PWM_COUNTER
+        meas_start(acq_gate_us[acq_channel]);
+        acq_state = ACQ_MEASURE;
+        return false;
+#else
+        // The polling backend can only count while the CPU watches the pin
+        acq_raw_hz = TCS3200_ReadFrequencyHz((acq_gate_us[acq_channel] + 999u) / 1000u);
+        break;
+#endif
+
+    case ACQ_MEASURE:
+#if TCS3200_USE_PWM_COUNTER
+        if (!meas_poll(&acq_raw_hz))
+            return false;
+#endif
+        break;
+
+    case ACQ_DONE:
+    case ACQ_IDLE:
+    default:
+        return false;
+    }
+
+    // Channel finished: report it at the common scale, then move on
+    acq_result_hz[acq_channel] = tcs3200_normalise(acq_raw_hz, acq_scale[acq_channel]);
+
+    if (acq_channel + 1u < acq_channel_count)
+    {
+        acq_begin_channel(acq_channel + 1u);
+        return false;
+    }
 
     // Reset to CLEAR
     TCS3200_SetFilter(TCS3200_FILTER_CLEAR);
-}
\ No newline at end of file
+    acq_state = ACQ_DONE;
+    return true;
+}
+
+bool TCS3200_IsBusy(void)
+{
+    return acq_state == ACQ_SETTLE || acq_state == ACQ_MEASURE;
+}
+
+void TCS3200_GetRGB(uint32_t *r_hz, uint32_t *g_hz, uint32_t *b_hz)
+{
+    if (r_hz)
+        *r_hz = acq_result_hz[0];
+    if (g_hz)
+        *g_hz = acq_result_hz[1];
+    if (b_hz)
+        *b_hz = acq_result_hz[2];
+
+    if (acq_state == ACQ_DONE)
+        acq_state = ACQ_IDLE;
+}
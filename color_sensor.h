@@ -15,8 +15,45 @@
 #define TCS3200_S3_PIN 9
 
 // Output frequency pin
+// GPIO 13 is PWM slice 6 channel B, so the slice can count OUT edges in hardware
 #define TCS3200_OUT_PIN 13
 
+// --- CAPTURE BACKEND ---
+// 1 = count rising edges on OUT with a PWM slice in counter mode (no missed edges, CPU free during the gate)
+// 0 = legacy busy-wait polling of OUT with gpio_get()
+#ifndef TCS3200_USE_PWM_COUNTER
+#define TCS3200_USE_PWM_COUNTER 1
+#endif
+
+// Time allowed for the photodiode output to settle after a filter change
+#define TCS3200_SETTLE_MS 10
+
+// --- RECIPROCAL (PERIOD) MODE ---
+// Frequency = edges / time between the first and last captured rising edge.
+// The timestamps are good to about TCS3200_RECIP_TIMING_ERROR_US, so the capture
+// window is sized to reach TCS3200_RECIP_PRECISION_PPM; the number of periods N
+// averaged then follows the signal (N = f * window, at least one period).
+#define TCS3200_RECIP_PRECISION_PPM 1000 // 0.1 % of the reading
+#define TCS3200_RECIP_TIMING_ERROR_US 2
+#define TCS3200_RECIP_WINDOW_US ((TCS3200_RECIP_TIMING_ERROR_US * 1000000u) / TCS3200_RECIP_PRECISION_PPM)
+// Give up (report 0 Hz) if no edge arrives within this time, e.g. in the dark
+#define TCS3200_RECIP_TIMEOUT_MS 50
+
+// --- AUTO-RANGING ---
+// Scale and gate are picked per channel from that channel's previous reading:
+// the highest scale that keeps OUT below TCS3200_AUTORANGE_MAX_HZ, then the
+// shortest gate that still collects TCS3200_AUTORANGE_TARGET_COUNT edges.
+#define TCS3200_AUTORANGE_TARGET_COUNT 100 // ~1 % quantisation per reading
+#define TCS3200_AUTORANGE_MIN_GATE_US 2000
+#define TCS3200_AUTORANGE_MAX_GATE_US 25000
+#if TCS3200_USE_PWM_COUNTER
+#define TCS3200_AUTORANGE_MAX_HZ 500000 // Hardware counter keeps up with the full 100 % range
+#else
+#define TCS3200_AUTORANGE_MAX_HZ 50000 // Busy-wait polling starts missing edges above this
+#endif
+// RGB readings are always reported as if taken at this scale (targets are calibrated at 20 %)
+#define TCS3200_REFERENCE_SCALE TCS3200_SCALE_20_PERCENT
+
 typedef enum
 {
     TCS3200_SCALE_POWER_DOWN,
@@ -31,11 +68,40 @@ typedef enum
     TCS3200_FILTER_CLEAR,
     TCS3200_FILTER_GREEN
 } tcs3200_filter_t;
+typedef enum
+{
+    TCS3200_MODE_GATE_COUNT, // Count edges for a fixed gate time (+/- 1 count quantisation)
+    TCS3200_MODE_RECIPROCAL  // Time N whole periods (needs TCS3200_USE_PWM_COUNTER)
+} tcs3200_mode_t;
 
 void TCS3200_Init(void);
 void TCS3200_SetFrequencyScaling(tcs3200_scale_t scale);
 void TCS3200_SetFilter(tcs3200_filter_t filter);
+// Select how frequency is measured. In reciprocal mode gate_time_ms is ignored.
+void TCS3200_SetMeasureMode(tcs3200_mode_t mode);
 uint32_t TCS3200_ReadFrequencyHz(uint32_t gate_time_ms);
 void TCS3200_ReadRGB(uint32_t gate_time_ms, uint32_t *r_hz, uint32_t *g_hz, uint32_t *b_hz);
 
+// Let the RGB acquisition choose scale and gate per channel (see TCS3200_AUTORANGE_*).
+// When disabled the scale set with TCS3200_SetFrequencyScaling and the caller's gate are used.
+void TCS3200_SetAutoRange(bool enable);
+// Scale each channel of the last RGB triple was actually measured at
+void TCS3200_GetRGBScale(tcs3200_scale_t *r_scale, tcs3200_scale_t *g_scale, tcs3200_scale_t *b_scale);
+
+// Also measure the CLEAR (unfiltered) channel after B, for ambient compensation.
+// Adds one settle + gate to every acquisition.
+void TCS3200_SetAcquireClear(bool enable);
+// CLEAR reading of the last acquisition (only valid when enabled above)
+void TCS3200_GetClear(uint32_t *c_hz, tcs3200_scale_t *c_scale);
+
+// --- NON-BLOCKING ACQUISITION ---
+// Start an R -> G -> B (-> CLEAR) acquisition (filter select -> settle -> gate per channel).
+// Call TCS3200_PollRGB() from the main loop; it returns true once the triple is ready,
+// then fetch it with TCS3200_GetRGB(). Starting again while busy restarts the sequence.
+// RGB results are normalised to TCS3200_REFERENCE_SCALE.
+void TCS3200_StartRGB(uint32_t gate_time_ms);
+bool TCS3200_PollRGB(void);
+bool TCS3200_IsBusy(void);
+void TCS3200_GetRGB(uint32_t *r_hz, uint32_t *g_hz, uint32_t *b_hz);
+
 #endif
\ No newline at end of file
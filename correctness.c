@@ -0,0 +1,150 @@
+#include "correctness.h"
+#if CORRECTNESS_USE_FLOAT
+#include <math.h>
+#endif
+
+// 1000 (tenths of a percent) in Q16.16
+#define CORRECTNESS_MAX_Q16 ((uint32_t)CORRECTNESS_MAX << 16)
+// Reciprocals carry 6 more fraction bits than the Q16.16 error sum (Q10.22), so bright
+// targets (tens of kHz and up) keep enough significant bits; see correctness_channel_q16
+#define CORRECTNESS_RECIP_EXTRA_BITS 6
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+static uint32_t correctness_recip_q22(uint32_t target_hz)
+{
+    if (target_hz == 0)
+        return 0;
+    // Rounded (1000 << 22) / (3 * target)
+    const uint64_t den = 3ull * target_hz;
+    return (uint32_t)((((uint64_t)CORRECTNESS_MAX_Q16 << CORRECTNESS_RECIP_EXTRA_BITS) + den / 2u) / den);
+}
+
+#if !CORRECTNESS_USE_FLOAT
+// One channel's share of the average error, Q16.16 tenths of a percent
+static inline uint32_t correctness_channel_q16(uint32_t x, uint32_t target, uint32_t recip_q22)
+{
+    uint32_t diff = (x > target) ? (x - target) : (target - x);
+
+    // A channel 300 % off already drives the score to 0 on its own, clamping there
+    // keeps diff * recip at most (1000 << 22) + 1.5 * target, inside 32 bits
+    if (diff > 3u * target)
+        diff = 3u * target;
+
+    const uint32_t half = 1u << (CORRECTNESS_RECIP_EXTRA_BITS - 1);
+    return (diff * recip_q22 + half) >> CORRECTNESS_RECIP_EXTRA_BITS;
+}
+#endif
+
+// -----------------------------------------------------------------------------
+// Public API implementation
+// -----------------------------------------------------------------------------
+
+uint16_t correctness_settled(uint16_t correctness, bool settled)
+{
+    if (!settled && correctness >= CORRECTNESS_SUCCESS)
+        return CORRECTNESS_SUCCESS - 1;
+    return correctness;
+}
+
+void correctness_target_init(correctness_target_t *target, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz)
+{
+    target->r_hz = r_hz;
+    target->g_hz = g_hz;
+    target->b_hz = b_hz;
+    target->r_recip_q22 = correctness_recip_q22(r_hz);
+    target->g_recip_q22 = correctness_recip_q22(g_hz);
+    target->b_recip_q22 = correctness_recip_q22(b_hz);
+}
+
+#if CORRECTNESS_USE_FLOAT
+uint16_t correctness_compute(const correctness_target_t *target, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz)
+{
+    // 1. Avoid division by zero
+    if (target->r_hz == 0 || target->g_hz == 0 || target->b_hz == 0)
+        return 0;
+
+    // 2. Calculate % difference for each channel individually
+    float diff_r = fabsf((float)r_hz - target->r_hz) / target->r_hz;
+    float diff_g = fabsf((float)g_hz - target->g_hz) / target->g_hz;
+    float diff_b = fabsf((float)b_hz - target->b_hz) / target->b_hz;
+
+    // 3. Average the errors and invert
+    float total_error = (diff_r + diff_g + diff_b) / 3.0f;
+    float accuracy = CORRECTNESS_MAX * (1.0f - total_error);
+
+    // 4. Clamp results
+    if (accuracy < 0.0f)
+        accuracy = 0.0f;
+    if (accuracy > CORRECTNESS_MAX)
+        accuracy = CORRECTNESS_MAX;
+
+    return (uint16_t)(accuracy + 0.5f);
+}
+#else
+uint16_t correctness_compute(const correctness_target_t *target, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz)
+{
+    // 1. Avoid division by zero (recip is 0 for a 0 Hz target)
+    if (target->r_recip_q22 == 0 || target->g_recip_q22 == 0 || target->b_recip_q22 == 0)
+        return 0;
+
+    // 2. Per-channel relative error, already divided by 3 and scaled to tenths of a percent.
+    //    Each term is <= 1000 << 16, so the sum fits comfortably in 32 bits.
+    const uint32_t error_q16 = correctness_channel_q16(r_hz, target->r_hz, target->r_recip_q22) +
+                               correctness_channel_q16(g_hz, target->g_hz, target->g_recip_q22) +
+                               correctness_channel_q16(b_hz, target->b_hz, target->b_recip_q22);
+
+    // 3. Invert and clamp
+    if (error_q16 >= CORRECTNESS_MAX_Q16)
+        return 0;
+
+    return (uint16_t)((CORRECTNESS_MAX_Q16 - error_q16 + 0x8000u) >> 16);
+}
+#endif
+
+uint32_t correctness_chroma(uint32_t channel_hz, uint32_t clear_hz)
+{
+    if (clear_hz == 0)
+        return 0;
+
+    // Inputs are clamped to 18 bits so the shift stays in 32 bits
+    // (the hardware divider then handles the divide)
+    const uint32_t limit = (1u << (32 - CORRECTNESS_CHROMA_SHIFT)) - 1u;
+    if (channel_hz > limit)
+        channel_hz = limit;
+
+    uint32_t chroma = (channel_hz << CORRECTNESS_CHROMA_SHIFT) / clear_hz;
+    if (chroma > (4u << CORRECTNESS_CHROMA_SHIFT))
+        chroma = 4u << CORRECTNESS_CHROMA_SHIFT;
+    return chroma;
+}
+
+void correctness_chroma_target_init(correctness_target_t *target, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz,
+                                    uint32_t c_hz)
+{
+    if (c_hz == 0)
+    {
+        correctness_target_init(target, 0, 0, 0);
+        return;
+    }
+
+    correctness_target_init(target,
+                            correctness_chroma(r_hz, c_hz),
+                            correctness_chroma(g_hz, c_hz),
+                            correctness_chroma(b_hz, c_hz));
+}
+
+uint16_t correctness_compute_chroma(const correctness_target_t *target, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz,
+                                    uint32_t c_hz)
+{
+    if (c_hz == 0)
+        return 0;
+
+    // Only the ratios are scored; the kernel itself is shared with the absolute mode
+    return correctness_compute(target,
+                               correctness_chroma(r_hz, c_hz),
+                               correctness_chroma(g_hz, c_hz),
+                               correctness_chroma(b_hz, c_hz));
+}
@@ -0,0 +1,77 @@
+#ifndef CORRECTNESS_H
+#define CORRECTNESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// --- KERNEL SELECTION ---
+// 0 = Q16.16 integer kernel with precomputed target reciprocals (default, no FPU on the RP2040)
+// 1 = original float implementation
+#ifndef CORRECTNESS_USE_FLOAT
+#define CORRECTNESS_USE_FLOAT 0
+#endif
+
+// Correctness is passed around as tenths of a percent: 0..1000 = 0.0..100.0 %
+#define CORRECTNESS_MAX 1000
+// Success threshold (97.0 %)
+#define CORRECTNESS_SUCCESS 970
+
+/**
+ * @brief The one success decision shared by the LCD, the motor and the web server.
+ *
+ * Success only counts on settled readings (see sample_filter_settled()): until then a
+ * score at or above CORRECTNESS_SUCCESS is held at CORRECTNESS_SUCCESS - 1, so a filter
+ * sweeping through the target color on its way somewhere else cannot lock anything.
+ */
+uint16_t correctness_settled(uint16_t correctness, bool settled);
+
+/**
+ * @brief A target color with everything the kernel needs precomputed.
+ * Build it once with correctness_target_init(), not per sample.
+ */
+typedef struct
+{
+    uint32_t r_hz;
+    uint32_t g_hz;
+    uint32_t b_hz;
+    // Q10.22 of (1000 / (3 * target)): per-channel error in tenths of a percent per Hz
+    uint32_t r_recip_q22;
+    uint32_t g_recip_q22;
+    uint32_t b_recip_q22;
+} correctness_target_t;
+
+void correctness_target_init(correctness_target_t *target, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz);
+
+/**
+ * @brief Correctness of a reading against a target.
+ *
+ * Average of the per-channel relative errors |x - t| / t, inverted and clamped:
+ * 0 error = 1000, average error >= 100 % = 0.
+ *
+ * @return Correctness in tenths of a percent (0..CORRECTNESS_MAX).
+ */
+uint16_t correctness_compute(const correctness_target_t *target, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz);
+
+// --- AMBIENT-COMPENSATED (CHROMATICITY) MODE ---
+// Each channel is divided by the CLEAR reading before scoring, so a brighter or
+// dimmer room scales all four together and cancels out. Chromaticity is Q14.
+#define CORRECTNESS_CHROMA_SHIFT 14
+
+// channel / clear in Q14, saturating at 4.0 (0 if clear is 0)
+uint32_t correctness_chroma(uint32_t channel_hz, uint32_t clear_hz);
+
+/**
+ * @brief Build a chromaticity target (r/c, g/c, b/c) from the R/G/B/CLEAR
+ * readings of the treasure color. The result is used with correctness_compute_chroma().
+ */
+void correctness_chroma_target_init(correctness_target_t *target, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz,
+                                    uint32_t c_hz);
+
+/**
+ * @brief Same metric as correctness_compute(), applied to chromaticity instead of absolute Hz.
+ * @return Correctness in tenths of a percent (0 if the CLEAR reading is 0).
+ */
+uint16_t correctness_compute_chroma(const correctness_target_t *target, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz,
+                                    uint32_t c_hz);
+
+#endif
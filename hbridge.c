@@ -1,7 +1,8 @@
 #include "hbridge.h"
 #include "hardware/pwm.h"
 #include "hardware/gpio.h"
-#include <math.h>
+#include "correctness.h"
+#include <stdlib.h>
 
 // Enumeration for internal use
 typedef enum
@@ -68,7 +69,7 @@ void Motor_Init(void)
     Motor_Stop();
 }
 
-void Motor_UpdateActuation(float correctness_percent)
+void Motor_UpdateActuation(uint16_t correctness)
 {
     // If motor locked (already completed success), don't update
     if (motor_locked)
@@ -81,11 +82,12 @@ void Motor_UpdateActuation(float correctness_percent)
     // 0% correctness = motor at 0% position
     // 97%+ correctness = motor performs full 360° rotation and locks
     // Motor rotates smoothly to match the current percentage
+    // Positions are in tenths of a percent, like correctness (0-1000)
 
     const uint32_t FULL_ROTATION_TIME_MS = 2000; // Time for full 360° rotation
-    const float MIN_CHANGE_THRESHOLD = 0.5f;     // Ignore tiny changes
+    const int32_t MIN_CHANGE_THRESHOLD = 5;      // Ignore tiny changes (0.5%)
 
-    static float current_position = 0.0f;   // Current motor position (0-100%)
+    static int32_t current_position = 0;    // Current motor position (0-1000)
     static uint32_t rotation_start_ms = 0;  // When current rotation began
     static uint32_t target_duration_ms = 0; // How long this rotation should take
     static HBRIDGE_DIRECTION direction = MOTOR_DIRECTION_BRAKE;
@@ -95,7 +97,7 @@ void Motor_UpdateActuation(float correctness_percent)
     uint32_t now_ms = to_ms_since_boot(get_absolute_time());
 
     // At 97%+, perform full 360° rotation once then lock
-    if (correctness_percent >= 97.0f)
+    if (correctness >= CORRECTNESS_SUCCESS)
     {
         if (!success_rotation_started)
         {
@@ -106,7 +108,7 @@ void Motor_UpdateActuation(float correctness_percent)
             rotating = true;
             success_rotation_started = true;
             HBridge_SetDirection(direction);
-            HBridge_SetSpeed((uint16_t)(PWM_WRAP_VALUE * 0.80f));
+            HBridge_SetSpeed((uint16_t)((PWM_WRAP_VALUE * 4u) / 5u)); // 80%
         }
         else if (rotating)
         {
@@ -116,7 +118,7 @@ void Motor_UpdateActuation(float correctness_percent)
             {
                 Motor_Stop();
                 rotating = false;
-                current_position = 100.0f;
+                current_position = CORRECTNESS_MAX;
                 motor_locked = true; // Lock motor - no more updates ever
             }
         }
@@ -124,11 +126,11 @@ void Motor_UpdateActuation(float correctness_percent)
     }
 
     // Below 97%: smooth proportional movement
-    float target_position = correctness_percent; // 0-97%
-    float position_diff = target_position - current_position;
+    int32_t target_position = correctness; // 0-970
+    int32_t position_diff = target_position - current_position;
 
     // Check if position has changed meaningfully
-    if (fabsf(position_diff) < MIN_CHANGE_THRESHOLD)
+    if (abs(position_diff) < MIN_CHANGE_THRESHOLD)
     {
         // Tiny change, ignore
         if (rotating)
@@ -149,13 +151,13 @@ void Motor_UpdateActuation(float correctness_percent)
     {
         // Start new rotation to target position
         direction = (position_diff > 0) ? MOTOR_DIRECTION_FORWARD : MOTOR_DIRECTION_REVERSE;
-        float movement_ratio = fabsf(position_diff) / 100.0f; // What % of full rotation?
-        target_duration_ms = (uint32_t)(movement_ratio * FULL_ROTATION_TIME_MS);
+        // What fraction of a full rotation?
+        target_duration_ms = ((uint32_t)abs(position_diff) * FULL_ROTATION_TIME_MS) / CORRECTNESS_MAX;
         rotation_start_ms = now_ms;
         rotating = true;
 
         HBridge_SetDirection(direction);
-        HBridge_SetSpeed((uint16_t)(PWM_WRAP_VALUE * 0.80f));
+        HBridge_SetSpeed((uint16_t)((PWM_WRAP_VALUE * 4u) / 5u)); // 80%
     }
     else
     {
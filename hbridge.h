@@ -22,13 +22,13 @@ void Motor_Init(void);
 
 /**
  * @brief Updates the motor state based on the Chromatic Validation percentage.
- * * * This function supports bidirectional control:
- * 1. If Correctness is POSITIVE (+0.1 to +100.0): Motor runs FORWARD.
- * 2. If Correctness is NEGATIVE (-0.1 to -100.0): Motor runs REVERSE.
- * 3. If the absolute value is >= 97%: Full power is applied.
- * * @param correctness_percent A float value from -100.0 to 100.0 representing the control effort.
+ * * * The motor position follows correctness:
+ * 1. If Correctness RISES: Motor runs FORWARD to the new position.
+ * 2. If Correctness FALLS: Motor runs REVERSE to the new position.
+ * 3. If Correctness is >= 97%: One full rotation is made and the motor locks.
+ * * @param correctness Correctness in tenths of a percent (0 to 1000, see correctness.h).
  */
-void Motor_UpdateActuation(float correctness_percent);
+void Motor_UpdateActuation(uint16_t correctness);
 
 /**
  * @brief Immediately stops the motor (Safety/Shutdown).
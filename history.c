@@ -0,0 +1,48 @@
+#include "history.h"
+
+#define HISTORY_MASK (HISTORY_SIZE - 1u)
+
+static history_entry_t entries[HISTORY_SIZE];
+static uint32_t next_seq = 0;
+static uint32_t last_time_ms = 0;
+
+void history_init(void)
+{
+    next_seq = 0;
+    last_time_ms = 0;
+}
+
+void history_add(uint32_t time_ms, uint16_t r, uint16_t g, uint16_t b, uint16_t correctness)
+{
+    if (next_seq != 0 && (time_ms - last_time_ms) < HISTORY_MIN_INTERVAL_MS)
+        return;
+
+    history_entry_t *entry = &entries[next_seq & HISTORY_MASK];
+    entry->seq = next_seq;
+    entry->time_ms = time_ms;
+    entry->r = r;
+    entry->g = g;
+    entry->b = b;
+    entry->correctness = correctness;
+
+    last_time_ms = time_ms;
+    next_seq++;
+}
+
+uint32_t history_next_seq(void)
+{
+    return next_seq;
+}
+
+uint32_t history_oldest_seq(void)
+{
+    return (next_seq > HISTORY_SIZE) ? next_seq - HISTORY_SIZE : 0;
+}
+
+bool history_get(uint32_t seq, history_entry_t *entry)
+{
+    if (seq >= next_seq || seq < history_oldest_seq())
+        return false;
+    *entry = entries[seq & HISTORY_MASK];
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// --- CONFIGURATION ---
+// Entries kept (must be a power of two); 512 x 16 bytes = 8 KB
+#define HISTORY_SIZE 512
+// Minimum spacing between recorded entries, so the ring covers a longer session
+// (512 entries x 100 ms = the last ~50 s)
+#define HISTORY_MIN_INTERVAL_MS 100
+
+// One recorded reading. Sequence numbers start at 0 at boot and never repeat.
+typedef struct
+{
+    uint32_t seq;
+    uint32_t time_ms;     // Milliseconds since boot
+    uint16_t r;           // Hz
+    uint16_t g;
+    uint16_t b;
+    uint16_t correctness; // Tenths of a percent
+} history_entry_t;
+
+/**
+ * @brief Fixed-size ring of the most recent readings, overwritten oldest first.
+ *
+ * Readers address entries by sequence number, so a reader that falls behind
+ * the writer can tell exactly which entries it lost.
+ */
+void history_init(void);
+
+// Record a reading (dropped if the previous one is less than HISTORY_MIN_INTERVAL_MS old)
+void history_add(uint32_t time_ms, uint16_t r, uint16_t g, uint16_t b, uint16_t correctness);
+
+// Sequence number the next entry will get (= number of entries ever recorded)
+uint32_t history_next_seq(void);
+
+// Oldest sequence number still held
+uint32_t history_oldest_seq(void);
+
+// Copy out one entry. Returns false if it was already overwritten or not written yet.
+bool history_get(uint32_t seq, history_entry_t *entry);
+
+#endif
@@ -0,0 +1,385 @@
+#include "http_parser.h"
+#include <string.h>
+
+enum
+{
+    STATE_METHOD,
+    STATE_PATH,
+    STATE_QUERY,
+    STATE_VERSION,
+    STATE_LINE_LF,      // CR seen at the end of a line, expecting LF
+    STATE_HEADER_START, // Start of a header line (or the blank line)
+    STATE_HEADER_NAME,
+    STATE_HEADER_VALUE,
+    STATE_END_LF, // CR of the blank line seen, expecting LF
+    STATE_DONE,
+    STATE_ERROR,
+};
+
+enum
+{
+    HEADER_OTHER,
+    HEADER_CONNECTION,
+    HEADER_ACCEPT_ENCODING,
+    HEADER_IF_NONE_MATCH,
+    HEADER_UPGRADE,
+    HEADER_WS_KEY,
+    HEADER_WS_VERSION,
+};
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+static inline char to_lower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+}
+
+static bool equals_nocase(const char *s, int len, const char *lower)
+{
+    for (int i = 0; i < len; i++, lower++)
+    {
+        if (*lower == '\0' || to_lower(s[i]) != *lower)
+            return false;
+    }
+    return *lower == '\0';
+}
+
+static void token_push(http_parser_t *parser, char c)
+{
+    if (parser->token_len < HTTP_PARSER_VALUE_MAX)
+        parser->token[parser->token_len++] = c;
+    else
+        parser->token_overflow = true;
+}
+
+static void token_clear(http_parser_t *parser)
+{
+    parser->token_len = 0;
+    parser->token_overflow = false;
+}
+
+static uint8_t header_id(const http_parser_t *parser)
+{
+    if (parser->token_overflow)
+        return HEADER_OTHER;
+    if (equals_nocase(parser->token, parser->token_len, "connection"))
+        return HEADER_CONNECTION;
+    if (equals_nocase(parser->token, parser->token_len, "accept-encoding"))
+        return HEADER_ACCEPT_ENCODING;
+    if (equals_nocase(parser->token, parser->token_len, "if-none-match"))
+        return HEADER_IF_NONE_MATCH;
+    if (equals_nocase(parser->token, parser->token_len, "upgrade"))
+        return HEADER_UPGRADE;
+    if (equals_nocase(parser->token, parser->token_len, "sec-websocket-key"))
+        return HEADER_WS_KEY;
+    if (equals_nocase(parser->token, parser->token_len, "sec-websocket-version"))
+        return HEADER_WS_VERSION;
+    return HEADER_OTHER;
+}
+
+// "Connection" is a comma-separated token list, e.g. "keep-alive, Upgrade"
+static void apply_connection(http_parser_t *parser, const char *value, int len)
+{
+    int start = 0;
+    while (start < len)
+    {
+        int end = start;
+        while (end < len && value[end] != ',')
+            end++;
+
+        int a = start, b = end;
+        while (a < b && value[a] == ' ')
+            a++;
+        while (b > a && value[b - 1] == ' ')
+            b--;
+
+        if (equals_nocase(value + a, b - a, "close"))
+            parser->connection = 0;
+        else if (equals_nocase(value + a, b - a, "keep-alive") && parser->connection != 0)
+            parser->connection = 1;
+
+        start = end + 1;
+    }
+}
+
+// "Accept-Encoding" is a list of codings with optional weights, e.g. "gzip, deflate, br;q=0.5".
+// gzip is accepted if listed (as gzip or x-gzip), or covered by "*", with a non-zero q.
+static void apply_accept_encoding(http_parser_t *parser, const char *value, int len)
+{
+    int gzip = -1, any = -1; // -1 not listed, 0 refused (q=0), 1 accepted
+    int start = 0;
+    while (start < len)
+    {
+        int end = start;
+        while (end < len && value[end] != ',')
+            end++;
+
+        int a = start;
+        while (a < end && value[a] == ' ')
+            a++;
+        int b = a;
+        while (b < end && value[b] != ';' && value[b] != ' ')
+            b++;
+
+        // q=0, q=0.0, ... refuses the coding; anything else (or no weight) accepts it
+        int q = b;
+        while (q < end && (value[q] == ' ' || value[q] == ';'))
+            q++;
+        int accepted = 1;
+        if (end - q >= 2 && to_lower(value[q]) == 'q' && value[q + 1] == '=')
+        {
+            accepted = 0;
+            for (int k = q + 2; k < end && value[k] != ' '; k++)
+            {
+                if (value[k] != '0' && value[k] != '.')
+                    accepted = 1;
+            }
+        }
+
+        if (equals_nocase(value + a, b - a, "gzip") || equals_nocase(value + a, b - a, "x-gzip"))
+            gzip = accepted;
+        else if (b - a == 1 && value[a] == '*')
+            any = accepted;
+
+        start = end + 1;
+    }
+    parser->accept_gzip = (gzip >= 0) ? gzip == 1 : any == 1;
+}
+
+// A header value is complete: keep it if it is one we route on
+static void apply_header(http_parser_t *parser)
+{
+    int len = parser->token_len;
+    while (len > 0 && (parser->token[len - 1] == ' ' || parser->token[len - 1] == '\t'))
+        len--;
+
+    switch (parser->header)
+    {
+    case HEADER_CONNECTION:
+        apply_connection(parser, parser->token, len);
+        break;
+    case HEADER_ACCEPT_ENCODING:
+        apply_accept_encoding(parser, parser->token, len);
+        break;
+    case HEADER_IF_NONE_MATCH:
+        memcpy(parser->if_none_match, parser->token, len);
+        parser->if_none_match[len] = '\0';
+        break;
+    case HEADER_UPGRADE:
+        parser->upgrade_websocket = equals_nocase(parser->token, len, "websocket");
+        break;
+    case HEADER_WS_KEY:
+        // A truncated key can never produce the right accept value
+        if (!parser->token_overflow)
+        {
+            memcpy(parser->ws_key, parser->token, len);
+            parser->ws_key[len] = '\0';
+        }
+        break;
+    case HEADER_WS_VERSION:
+    {
+        unsigned version = 0;
+        for (int i = 0; i < len && version <= 255; i++)
+        {
+            if (parser->token[i] < '0' || parser->token[i] > '9')
+            {
+                version = 0;
+                break;
+            }
+            version = version * 10u + (unsigned)(parser->token[i] - '0');
+        }
+        parser->ws_version = (version <= 255) ? (uint8_t)version : 0;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static uint8_t finish_request_line(http_parser_t *parser)
+{
+    // Only HTTP/1.x; the minor version decides the keep-alive default
+    if (parser->token_len != 8 || memcmp(parser->token, "HTTP/1.", 7) != 0 ||
+        parser->token[7] < '0' || parser->token[7] > '9')
+        return STATE_ERROR;
+    parser->minor_version = (uint8_t)(parser->token[7] - '0');
+    parser->keep_alive = parser->minor_version >= 1;
+    return STATE_HEADER_START;
+}
+
+static void finish_head(http_parser_t *parser)
+{
+    if (parser->connection >= 0)
+        parser->keep_alive = parser->connection == 1;
+}
+
+// -----------------------------------------------------------------------------
+// Public API implementation
+// -----------------------------------------------------------------------------
+
+void http_parser_reset(http_parser_t *parser)
+{
+    parser->method = HTTP_METHOD_OTHER;
+    parser->minor_version = 0;
+    parser->keep_alive = false;
+    parser->upgrade_websocket = false;
+    parser->accept_gzip = false;
+    parser->path[0] = '\0';
+    parser->query[0] = '\0';
+    parser->if_none_match[0] = '\0';
+    parser->ws_key[0] = '\0';
+    parser->ws_version = 0;
+
+    parser->state = STATE_METHOD;
+    parser->header = HEADER_OTHER;
+    parser->connection = -1;
+    parser->total = 0;
+    token_clear(parser);
+}
+
+http_parse_result_t http_parser_feed(http_parser_t *parser, const char *data, uint16_t len, uint16_t *consumed)
+{
+    uint16_t i = 0;
+
+    while (i < len && parser->state != STATE_DONE && parser->state != STATE_ERROR)
+    {
+        const char c = data[i++];
+
+        if (++parser->total > HTTP_PARSER_HEADER_MAX)
+        {
+            parser->state = STATE_ERROR;
+            break;
+        }
+
+        switch (parser->state)
+        {
+        case STATE_METHOD:
+            if (c == ' ')
+            {
+                if (parser->token_len == 0)
+                    break; // Tolerate leading spaces
+                if (!parser->token_overflow && parser->token_len == 3 && memcmp(parser->token, "GET", 3) == 0)
+                    parser->method = HTTP_METHOD_GET;
+                else if (!parser->token_overflow && parser->token_len == 4 && memcmp(parser->token, "HEAD", 4) == 0)
+                    parser->method = HTTP_METHOD_HEAD;
+                token_clear(parser);
+                parser->state = STATE_PATH;
+            }
+            else if (c == '\r' || c == '\n')
+            {
+                // Blank lines before a request are allowed (RFC 7230 3.5)
+                if (parser->token_len != 0)
+                    parser->state = STATE_ERROR;
+            }
+            else
+                token_push(parser, c);
+            break;
+
+        case STATE_PATH:
+        case STATE_QUERY:
+        {
+            char *field = (parser->state == STATE_PATH) ? parser->path : parser->query;
+            const uint8_t max = (parser->state == STATE_PATH) ? HTTP_PARSER_PATH_MAX : HTTP_PARSER_QUERY_MAX;
+
+            if (c == ' ')
+            {
+                field[parser->token_len] = '\0';
+                if (parser->state == STATE_PATH && parser->token_len == 0)
+                    parser->state = STATE_ERROR;
+                else
+                {
+                    token_clear(parser);
+                    parser->state = STATE_VERSION;
+                }
+            }
+            else if (c == '?' && parser->state == STATE_PATH)
+            {
+                field[parser->token_len] = '\0';
+                token_clear(parser);
+                parser->state = STATE_QUERY;
+            }
+            else if (c == '\r' || c == '\n' || parser->token_len >= max)
+                parser->state = STATE_ERROR; // HTTP/0.9 or too long
+            else
+                field[parser->token_len++] = c;
+            break;
+        }
+
+        case STATE_VERSION:
+            if (c == '\r' || c == '\n')
+            {
+                parser->state = finish_request_line(parser);
+                if (c == '\r' && parser->state != STATE_ERROR)
+                    parser->state = STATE_LINE_LF;
+                token_clear(parser);
+            }
+            else
+                token_push(parser, c);
+            break;
+
+        case STATE_LINE_LF:
+            parser->state = (c == '\n') ? STATE_HEADER_START : STATE_ERROR;
+            break;
+
+        case STATE_HEADER_START:
+            if (c == '\r')
+                parser->state = STATE_END_LF;
+            else if (c == '\n')
+            {
+                finish_head(parser);
+                parser->state = STATE_DONE;
+            }
+            else
+            {
+                token_clear(parser);
+                token_push(parser, c);
+                parser->state = STATE_HEADER_NAME;
+            }
+            break;
+
+        case STATE_HEADER_NAME:
+            if (c == ':')
+            {
+                parser->header = header_id(parser);
+                token_clear(parser);
+                parser->state = STATE_HEADER_VALUE;
+            }
+            else if (c == '\r' || c == '\n')
+                parser->state = STATE_ERROR; // Header line without a colon
+            else
+                token_push(parser, c);
+            break;
+
+        case STATE_HEADER_VALUE:
+            if (c == '\r' || c == '\n')
+            {
+                apply_header(parser);
+                parser->state = (c == '\r') ? STATE_LINE_LF : STATE_HEADER_START;
+            }
+            else if (parser->token_len == 0 && (c == ' ' || c == '\t'))
+                break; // Leading whitespace
+            else if (parser->header != HEADER_OTHER)
+                token_push(parser, c);
+            break;
+
+        case STATE_END_LF:
+            if (c == '\n')
+            {
+                finish_head(parser);
+                parser->state = STATE_DONE;
+            }
+            else
+                parser->state = STATE_ERROR;
+            break;
+        }
+    }
+
+    *consumed = i;
+    if (parser->state == STATE_DONE)
+        return HTTP_PARSE_DONE;
+    if (parser->state == STATE_ERROR)
+        return HTTP_PARSE_ERROR;
+    return HTTP_PARSE_INCOMPLETE;
+}
@@ -0,0 +1,74 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// --- CONFIGURATION ---
+// Longest path / query string accepted (longer requests are rejected)
+#define HTTP_PARSER_PATH_MAX 48
+#define HTTP_PARSER_QUERY_MAX 48
+// Longest header name or value kept; longer values of headers we use are truncated
+#define HTTP_PARSER_VALUE_MAX 64
+// Request line + headers larger than this are rejected
+#define HTTP_PARSER_HEADER_MAX 2048
+
+typedef enum
+{
+    HTTP_PARSE_INCOMPLETE, // Need more bytes
+    HTTP_PARSE_DONE,       // Request head complete, fields below are valid
+    HTTP_PARSE_ERROR,      // Malformed or too large; answer 400 and close
+} http_parse_result_t;
+
+typedef enum
+{
+    HTTP_METHOD_OTHER,
+    HTTP_METHOD_GET,
+    HTTP_METHOD_HEAD,
+} http_method_t;
+
+/**
+ * @brief Incremental HTTP/1.x request-head parser.
+ *
+ * Bytes are fed in whatever pieces they arrive in (one pbuf at a time); the
+ * parser keeps its position between calls, never looks at a byte twice and
+ * allocates nothing. Only the fields the server routes on are kept.
+ */
+typedef struct
+{
+    // Results (valid once http_parser_feed returned HTTP_PARSE_DONE)
+    uint8_t method;         // http_method_t
+    uint8_t minor_version;  // HTTP/1.x
+    bool keep_alive;        // After the Connection header and the HTTP version
+    bool upgrade_websocket; // "Upgrade: websocket"
+    bool accept_gzip;       // Accept-Encoding allows gzip (false without the header)
+    char path[HTTP_PARSER_PATH_MAX + 1];
+    char query[HTTP_PARSER_QUERY_MAX + 1]; // Without the '?'
+    char if_none_match[HTTP_PARSER_VALUE_MAX + 1];
+    char ws_key[HTTP_PARSER_VALUE_MAX + 1]; // Sec-WebSocket-Key
+    uint8_t ws_version;     // Sec-WebSocket-Version (0 if absent or not a number up to 255)
+
+    // Internal state
+    uint8_t state;
+    uint8_t header;     // Header whose value is being read
+    int8_t connection;  // Connection header: -1 absent, 0 close, 1 keep-alive
+    uint8_t token_len;
+    bool token_overflow;
+    uint16_t total;     // Bytes of the request head so far
+    char token[HTTP_PARSER_VALUE_MAX + 1]; // Method, version, header name or value being read
+} http_parser_t;
+
+// Prepare for the next request on the connection
+void http_parser_reset(http_parser_t *parser);
+
+/**
+ * @brief Feed the next piece of the stream.
+ *
+ * Stops right after the blank line that ends the request head, so bytes of a
+ * pipelined next request are left unconsumed.
+ *
+ * @param consumed Set to the number of bytes used from data.
+ */
+http_parse_result_t http_parser_feed(http_parser_t *parser, const char *data, uint16_t len, uint16_t *consumed);
+
+#endif
@@ -1,4 +1,32 @@
 #include "lcd.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+// Queue entry: bits 0-7 byte, bit 8 RS (1 = data)
+#define LCD_QUEUE_MASK (LCD_QUEUE_SIZE - 1u)
+#define LCD_QUEUE_RS (1u << 8)
+// Ticks to wait after a byte, on top of the two ticks before the next Enable pulse
+#define LCD_TICKS_AFTER(exec_us) (((exec_us) + LCD_QUEUE_TICK_US - 1) / LCD_QUEUE_TICK_US > 2 \
+                                      ? ((exec_us) + LCD_QUEUE_TICK_US - 1) / LCD_QUEUE_TICK_US - 2 : 0)
+
+// Shadow framebuffer: callers draw into frame, lcd_flush sends the cells that differ from shown
+static char frame[LCD_ROWS][LCD_COLS];
+static char shown[LCD_ROWS][LCD_COLS];
+static int draw_row = 0, draw_col = 0;
+static int hw_address = -1; // DDRAM address the controller will write next, -1 if unknown
+
+// Output queue: lcd_flush produces, the repeating timer callback consumes (both on core 0)
+static volatile uint16_t queue[LCD_QUEUE_SIZE];
+static volatile uint32_t queue_head = 0; // Next slot to write (free-running)
+static volatile uint32_t queue_tail = 0; // Next slot to send (free-running)
+static volatile bool draining = false;   // Timer running
+static volatile uint32_t queue_deferred = 0;
+static repeating_timer_t lcd_timer;
+
+// Timer state: which step of the current byte comes next
+static uint8_t tick_phase = 0;
+static uint16_t tick_entry = 0;
+static uint16_t tick_wait = 0;
 
 // Helper: Pulse the Enable pin to tell LCD to read data
 void lcd_toggle_enable(void)
@@ -9,13 +37,19 @@ void lcd_toggle_enable(void)
     sleep_us(50); // Wait for data to latch
 }
 
-// Helper: Send 4 bits of data to D4-D7
-void lcd_send_nibble(uint8_t nibble)
+// Helper: Put 4 bits on D4-D7 (Enable untouched)
+static void lcd_put_nibble(uint8_t nibble)
 {
     gpio_put(LCD_PIN_D4, (nibble >> 0) & 0x01);
     gpio_put(LCD_PIN_D5, (nibble >> 1) & 0x01);
     gpio_put(LCD_PIN_D6, (nibble >> 2) & 0x01);
     gpio_put(LCD_PIN_D7, (nibble >> 3) & 0x01);
+}
+
+// Helper: Send 4 bits of data to D4-D7
+void lcd_send_nibble(uint8_t nibble)
+{
+    lcd_put_nibble(nibble);
     lcd_toggle_enable();
 }
 
@@ -36,23 +70,135 @@ void lcd_send_byte(uint8_t val, int mode)
     sleep_us(200);
 }
 
-void lcd_clear(void)
+// -----------------------------------------------------------------------------
+// Timer-driven output queue
+// -----------------------------------------------------------------------------
+
+// One bus step per tick, so every setup, Enable pulse and hold time is a whole
+// tick (>= 25 us against HD44780 minimums of well under 1 us):
+//   0 RS + high nibble, 1 EN high, 2 EN low, 3 low nibble, 4 EN high, 5 EN low
+// The next Enable rise is two ticks after the last fall, which covers the 37 us
+// execution time; clear / home (1.52 ms) wait extra ticks.
+static bool lcd_queue_tick(repeating_timer_t *timer)
+{
+    (void)timer;
+
+    if (tick_wait)
+    {
+        tick_wait--;
+        return true;
+    }
+
+    switch (tick_phase)
+    {
+    case 0:
+        if (queue_tail == queue_head)
+        {
+            draining = false; // Runs in the timer IRQ, so lcd_queue_kick cannot interleave
+            return false;
+        }
+        tick_entry = queue[queue_tail & LCD_QUEUE_MASK];
+        queue_tail++;
+        gpio_put(LCD_PIN_RS, (tick_entry & LCD_QUEUE_RS) != 0);
+        lcd_put_nibble((tick_entry >> 4) & 0x0F);
+        break;
+    case 1:
+    case 4:
+        gpio_put(LCD_PIN_EN, 1);
+        break;
+    case 2:
+        gpio_put(LCD_PIN_EN, 0);
+        break;
+    case 3:
+        lcd_put_nibble(tick_entry & 0x0F);
+        break;
+    case 5:
+        gpio_put(LCD_PIN_EN, 0);
+        const bool slow = !(tick_entry & LCD_QUEUE_RS) && (tick_entry & 0xFF) <= 0x03;
+        tick_wait = slow ? LCD_TICKS_AFTER(LCD_SLOW_EXEC_US) : LCD_TICKS_AFTER(LCD_EXEC_US);
+        tick_phase = 0;
+        return true;
+    }
+    tick_phase++;
+    return true;
+}
+
+static uint32_t lcd_queue_space(void)
+{
+    return LCD_QUEUE_SIZE - (queue_head - queue_tail);
+}
+
+static void lcd_queue_push(uint8_t val, int mode)
+{
+    queue[queue_head & LCD_QUEUE_MASK] = val | (mode ? LCD_QUEUE_RS : 0);
+    queue_head++;
+}
+
+// Start the timer if it is not already draining the queue
+static void lcd_queue_kick(void)
+{
+    bool started = true;
+
+    uint32_t irq = save_and_disable_interrupts();
+    if (!draining && queue_tail != queue_head)
+    {
+        draining = true;
+        tick_phase = 0;
+        tick_wait = 0;
+        started = add_repeating_timer_us(-(int64_t)LCD_QUEUE_TICK_US, lcd_queue_tick, NULL, &lcd_timer);
+        if (!started)
+            draining = false;
+    }
+    restore_interrupts(irq);
+
+    // No alarm slot free: send what is queued the blocking way rather than stall
+    while (!started && queue_tail != queue_head)
+    {
+        const uint16_t entry = queue[queue_tail & LCD_QUEUE_MASK];
+        queue_tail++;
+        lcd_send_byte(entry & 0xFF, (entry & LCD_QUEUE_RS) != 0);
+    }
+}
+
+// Helper: DDRAM address of a cell (row 0 starts at 0x00, row 1 at 0x40)
+static int lcd_cell_address(int row, int col)
+{
+    return ((row == 0) ? 0x00 : 0x40) + col;
+}
+
+// Helper: Hardware clear, only used at init (costs 2 ms)
+static void lcd_hw_clear(void)
 {
     lcd_send_byte(0x01, 0);
     sleep_ms(2); // Clear command requires a full 2ms delay
+
+    memset(shown, ' ', sizeof(shown));
+    hw_address = 0x00;
+}
+
+// -----------------------------------------------------------------------------
+// Framebuffer API (RAM only until lcd_flush)
+// -----------------------------------------------------------------------------
+
+void lcd_clear(void)
+{
+    memset(frame, ' ', sizeof(frame));
+    draw_row = 0;
+    draw_col = 0;
 }
 
 void lcd_set_cursor(int row, int col)
 {
-    // 0x80 is the command to set cursor address
-    // Row 0 starts at 0x00, Row 1 starts at 0x40
-    uint8_t val = (row == 0) ? (0x80 + col) : (0xC0 + col);
-    lcd_send_byte(val, 0);
+    draw_row = row;
+    draw_col = col;
 }
 
 void lcd_char(char c)
 {
-    lcd_send_byte(c, 1); // 1 = Data mode
+    // Off-screen characters are dropped
+    if (draw_row >= 0 && draw_row < LCD_ROWS && draw_col >= 0 && draw_col < LCD_COLS)
+        frame[draw_row][draw_col] = c;
+    draw_col++;
 }
 
 void lcd_string(const char *s)
@@ -63,6 +209,68 @@ void lcd_string(const char *s)
     }
 }
 
+int lcd_flush(void)
+{
+    int sent = 0;
+
+    for (int row = 0; row < LCD_ROWS; row++)
+    {
+        for (int col = 0; col < LCD_COLS; col++)
+        {
+            if (frame[row][col] == shown[row][col])
+                continue;
+
+            // Room for an address command and the character, or apply the overflow policy
+            if (lcd_queue_space() < 2)
+            {
+#if LCD_QUEUE_OVERFLOW_WAIT
+                lcd_queue_kick();
+                while (lcd_queue_space() < 2)
+                    tight_loop_contents();
+#else
+                // Cells not queued stay different from shown, so the next flush sends them
+                queue_deferred++;
+                lcd_queue_kick();
+                return sent;
+#endif
+            }
+
+            // Only move the controller's cursor when it is not already there
+            const int address = lcd_cell_address(row, col);
+            if (address != hw_address)
+            {
+                lcd_queue_push(0x80 | address, 0); // Set DDRAM address
+                sent++;
+            }
+
+            lcd_queue_push(frame[row][col], 1); // 1 = Data mode
+            shown[row][col] = frame[row][col];
+            hw_address = address + 1; // Entry mode: increment
+            sent++;
+        }
+    }
+
+    lcd_queue_kick();
+    return sent;
+}
+
+bool lcd_busy(void)
+{
+    return draining || queue_tail != queue_head;
+}
+
+void lcd_wait(void)
+{
+    lcd_queue_kick();
+    while (lcd_busy())
+        tight_loop_contents();
+}
+
+uint32_t lcd_deferred_count(void)
+{
+    return queue_deferred;
+}
+
 void lcd_init(void)
 {
     // 1. Setup GPIO
@@ -112,7 +320,8 @@ void lcd_init(void)
     // Display Control: Display OFF, Cursor OFF, Blink OFF
     lcd_send_byte(0x08, 0);
 
-    // Clear Display
+    // Clear Display (and the framebuffer)
+    lcd_hw_clear();
     lcd_clear();
 
     // Entry Mode Set: Increment cursor, no shift
@@ -11,10 +11,50 @@
 #define LCD_PIN_D6 4
 #define LCD_PIN_D7 5
 
+// --- DISPLAY SIZE ---
+#define LCD_ROWS 2
+#define LCD_COLS 16
+
+// --- OUTPUT QUEUE ---
+// Bytes waiting for the bus (power of two; a full redraw is at most 2 x 17)
+#define LCD_QUEUE_SIZE 64
+// Repeating timer period; one bus step (pins, Enable edge) per tick
+#define LCD_QUEUE_TICK_US 25
+// HD44780 execution times: most instructions / writes, and clear + home
+#define LCD_EXEC_US 37
+#define LCD_SLOW_EXEC_US 1520
+// Queue full during lcd_flush: 1 = wait for room, 0 = stop and leave the rest for the next flush
+#define LCD_QUEUE_OVERFLOW_WAIT 0
+
 void lcd_init(void);
-void lcd_clear(void);
+
+// Drawing goes into a RAM framebuffer; nothing reaches the display until lcd_flush.
+// Characters outside the 16x2 area are dropped.
+void lcd_clear(void); // Blanks the framebuffer (never sends the slow hardware clear)
 void lcd_set_cursor(int row, int col);
 void lcd_string(const char *s);
 void lcd_char(char c);
 
+/**
+ * @brief Queue the cells that changed since the last flush and return.
+ *
+ * A cursor-address command is only queued when the next changed cell is not
+ * where the controller's cursor already is, so redrawing an unchanged screen
+ * costs nothing and one changed digit costs two bytes. A hardware repeating
+ * timer clocks the queue out in the background; nothing here sleeps (unless
+ * LCD_QUEUE_OVERFLOW_WAIT is set and the queue is full).
+ *
+ * @return Bytes queued for the controller (commands + characters).
+ */
+int lcd_flush(void);
+
+// True while queued bytes are still going out
+bool lcd_busy(void);
+
+// Block until everything flushed so far has reached the display
+void lcd_wait(void);
+
+// Flushes cut short by a full queue (their remaining cells went out with a later flush)
+uint32_t lcd_deferred_count(void);
+
 #endif
\ No newline at end of file
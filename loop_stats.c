@@ -0,0 +1,126 @@
+#include "loop_stats.h"
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct
+{
+    uint32_t count;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t overruns; // Runs longer than the stage budget
+    uint32_t hist[LOOP_STATS_BUCKETS];
+} loop_stage_stats_t;
+
+static loop_stage_stats_t stages[LOOP_STAGE_COUNT];
+// Hardware spin lock around stages[]: both cores record, /stats reads from core 0 (or
+// an IRQ), and the M0+ has no 64-bit load or store, so total_us could be read torn
+static spin_lock_t *stats_lock = NULL;
+
+static const char *const stage_names[LOOP_STAGE_COUNT] = {
+    "pots", "sensor", "samples", "model", "motor", "lcd",
+};
+
+// Overrun budgets, us. A task that runs longer delays every other task on its
+// core, and the motor task is due every ms.
+static const uint32_t stage_budget_us[LOOP_STAGE_COUNT] = {
+    500,   // pots (three ADC reads)
+    200,   // sensor (never blocks)
+    2000,  // samples
+    200,   // model (float RLS on an FPU-less core)
+    200,   // motor
+    500,   // lcd (queues only, the timer sends)
+};
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+static inline int loop_stats_bucket(uint32_t us)
+{
+    if (us < LOOP_STATS_FIRST_BUCKET_US)
+        return 0;
+    // 16..31 -> 1, 32..63 -> 2, ...
+    int bucket = (31 - __builtin_clz(us)) - (31 - __builtin_clz(LOOP_STATS_FIRST_BUCKET_US)) + 1;
+    return (bucket < LOOP_STATS_BUCKETS) ? bucket : LOOP_STATS_BUCKETS - 1;
+}
+
+// -----------------------------------------------------------------------------
+// Public API implementation
+// -----------------------------------------------------------------------------
+
+void loop_stats_init(void)
+{
+    // Initialised again: keep the lock
+    if (!stats_lock)
+        stats_lock = spin_lock_init(spin_lock_claim_unused(true));
+
+    const uint32_t saved_irq = spin_lock_blocking(stats_lock);
+    memset(stages, 0, sizeof(stages));
+    spin_unlock(stats_lock, saved_irq);
+}
+
+void loop_stats_record(loop_stage_t stage, uint32_t us)
+{
+    loop_stage_stats_t *s = &stages[stage];
+    const int bucket = loop_stats_bucket(us);
+
+    // Interrupts stay off on this core while the lock is held, so /stats running in an
+    // IRQ can never spin on a lock its own core was interrupted holding
+    const uint32_t saved_irq = spin_lock_blocking(stats_lock);
+    s->count++;
+    s->total_us += us;
+    s->hist[bucket]++;
+    if (us > s->max_us)
+        s->max_us = us;
+    if (us > stage_budget_us[stage])
+        s->overruns++;
+    spin_unlock(stats_lock, saved_irq);
+}
+
+void loop_stats_mark(loop_stage_t stage, uint32_t *mark)
+{
+    uint32_t now = time_us_32();
+    loop_stats_record(stage, now - *mark);
+    *mark = now;
+}
+
+uint32_t loop_stats_bucket_limit_us(int bucket)
+{
+    if (bucket >= LOOP_STATS_BUCKETS - 1)
+        return 0;
+    return (uint32_t)LOOP_STATS_FIRST_BUCKET_US << bucket;
+}
+
+int loop_stats_format_json(char *buf, int size)
+{
+    int len = snprintf(buf, size, "{\"buckets_us\":[");
+    for (int i = 0; i < LOOP_STATS_BUCKETS - 1 && len < size; i++)
+        len += snprintf(buf + len, size - len, "%s%lu", i ? "," : "", (unsigned long)loop_stats_bucket_limit_us(i));
+    if (len < size)
+        len += snprintf(buf + len, size - len, "],\"stages\":{");
+
+    for (int stage = 0; stage < LOOP_STAGE_COUNT && len < size; stage++)
+    {
+        // Copy under the lock, format after: the recording core is held up for a few loads only
+        loop_stage_stats_t copy;
+        const uint32_t saved_irq = spin_lock_blocking(stats_lock);
+        copy = stages[stage];
+        spin_unlock(stats_lock, saved_irq);
+
+        const loop_stage_stats_t *s = &copy;
+        len += snprintf(buf + len, size - len,
+                        "%s\"%s\":{\"count\":%lu,\"avg_us\":%lu,\"max_us\":%lu,\"budget_us\":%lu,\"overruns\":%lu,\"hist\":[",
+                        stage ? "," : "", stage_names[stage], (unsigned long)s->count,
+                        (unsigned long)(s->count ? s->total_us / s->count : 0), (unsigned long)s->max_us,
+                        (unsigned long)stage_budget_us[stage], (unsigned long)s->overruns);
+        for (int i = 0; i < LOOP_STATS_BUCKETS && len < size; i++)
+            len += snprintf(buf + len, size - len, "%s%lu", i ? "," : "", (unsigned long)s->hist[i]);
+        if (len < size)
+            len += snprintf(buf + len, size - len, "]}");
+    }
+    if (len < size)
+        len += snprintf(buf + len, size - len, "}}");
+    return len;
+}
@@ -0,0 +1,49 @@
+#ifndef LOOP_STATS_H
+#define LOOP_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// --- CONFIGURATION ---
+// Histogram buckets per stage: bucket 0 is < 16 us, bucket k is [8 << k, 16 << k) us,
+// the last one collects everything from 16 << (LOOP_STATS_BUCKETS - 2) us up
+#define LOOP_STATS_BUCKETS 12
+#define LOOP_STATS_FIRST_BUCKET_US 16
+
+// Timed stages (scheduler tasks). POTS and SENSOR run on core 1 (sensor_worker), the
+// rest on core 0. Networking is not a stage: it runs in the background async_context.
+typedef enum
+{
+    LOOP_STAGE_POTS,    // Potentiometers -> LEDs (core 1)
+    LOOP_STAGE_SENSOR,  // Color sensor state machine and ring push (core 1)
+    LOOP_STAGE_SAMPLES, // Filters, scoring, model update, web publish
+    LOOP_STAGE_MODEL,   // One pot_model_update (soft-float RLS), also counted in SAMPLES
+    LOOP_STAGE_MOTOR,   // Estimate + Motor_UpdateActuation
+    LOOP_STAGE_LCD,     // LCD writes
+    LOOP_STAGE_COUNT
+} loop_stage_t;
+
+/**
+ * @brief Fixed-cost timing of the firmware stages.
+ *
+ * Recording costs one timer read, a count-leading-zeros and a few increments
+ * under a hardware spin lock, so it stays enabled in production. The lock is what
+ * keeps /stats consistent: the M0+ has no 64-bit load or store, so an unlocked
+ * reader on the other core could see the 64-bit total half updated. Call from
+ * core 0 before core 1 records anything (it claims the spin lock).
+ */
+void loop_stats_init(void);
+
+// Record the time since *mark against stage and move *mark to now (chain stages with one clock read each)
+void loop_stats_mark(loop_stage_t stage, uint32_t *mark);
+
+// Record one run of a stage
+void loop_stats_record(loop_stage_t stage, uint32_t us);
+
+// Upper bound (exclusive) of a histogram bucket in us; 0 for the open-ended last bucket
+uint32_t loop_stats_bucket_limit_us(int bucket);
+
+// Append the stages as a JSON object. Returns the length written (snprintf-style).
+int loop_stats_format_json(char *buf, int size);
+
+#endif
@@ -1,5 +1,5 @@
 #include <stdio.h>
-#include <math.h>
+#include <stdlib.h>
 #include "pico/stdlib.h"
 #include "hardware/adc.h"
 #include "lcd.h"
@@ -8,6 +8,15 @@
 #include "hbridge.h"
 #include "color_sensor.h"
 #include "wifi_server.h"
+#include "sample_ring.h"
+#include "sample_filter.h"
+#include "correctness.h"
+#include "color_lab.h"
+#include "target_set.h"
+#include "pot_model.h"
+#include "loop_stats.h"
+#include "sensor_worker.h"
+#include "scheduler.h"
 
 // --- GEOMETRIC SEQUENCE REWARD ---
 /**
@@ -16,40 +25,243 @@
  */
 
 // --- CONFIGURATION ---
-// Target RGB values (The "Treasure" color)
+// Target RGB values (The "Treasure" color, first entry of target_table below)
 #define TARGET_R_HZ 1200
 #define TARGET_G_HZ 1000
 #define TARGET_B_HZ 1600
+// CLEAR reading of the treasure color, calibrate together with R/G/B above
+#define TARGET_C_HZ 3800
 // Max frequency expected (for normalization)
-#define MAX_EXPECTED_HZ 5000.0f
+#define MAX_EXPECTED_HZ 5000u
 
-// Helper to calculate correctness % based on Euclidean Distance
-float calculate_correctness(uint32_t r, uint32_t g, uint32_t b)
+// Color sensor measurement: TCS3200_MODE_GATE_COUNT or TCS3200_MODE_RECIPROCAL.
+// Reciprocal is opt-in until its precision and acquisition time are measured on the
+// board; gate counting is what the targets above were calibrated with.
+#define SENSOR_MEASURE_MODE TCS3200_MODE_GATE_COUNT
+// How a reading is scored against the target:
+// SCORE_ABSOLUTE - average per-channel % error of the absolute Hz
+// SCORE_CHROMA   - same metric on channel / CLEAR, so ambient light changes cancel out
+//                  (costs one extra settle + gate per sample)
+// SCORE_DELTA_E  - perceptual CIELAB Delta-E (see color_lab.h)
+#define SCORE_ABSOLUTE 0
+#define SCORE_CHROMA 1
+#define SCORE_DELTA_E 2
+#define SCORE_MODE SCORE_ABSOLUTE
+// Let the sensor pick scale and gate per channel from the previous reading
+#define SENSOR_AUTORANGE true
+// Color sensor gate time per channel (gate-count mode without auto-ranging only)
+#define SENSOR_GATE_MS 10
+// Task rates on core 0 (each subsystem runs at its own rate, see scheduler.h)
+// Sample consumption + live estimate: acquisitions take tens of ms, so 5 ms adds little latency
+#define SAMPLES_PERIOD_MS 5
+// Motor control: rotation timing is kept at ms granularity
+#define MOTOR_PERIOD_MS 1
+// LCD accuracy refresh period
+#define LCD_REFRESH_MS 500
+// How often timing and sample rate are reported over USB
+#define LOOP_REPORT_MS 5000
+// How often USB stdio is checked for a stats request (send 's' for a full /stats dump)
+#define STATS_INPUT_POLL_MS 100
+#define STATS_DUMP_MAX 3072
+// Knob travel (raw ADC counts) since the last sample before the model prediction
+// replaces the measured score (keeps ADC noise from swapping the two back and forth)
+#define ESTIMATE_POT_DEADBAND 24
+
+// Sensor samples flow producer -> ring -> filters -> correctness
+static sample_ring_t sample_ring;
+static sample_filter_t filter_r, filter_g, filter_b, filter_c;
+
+// Game state shared by the core 0 tasks
+static uint32_t sensor_r = 0, sensor_g = 0, sensor_b = 0;
+static uint16_t correctness = 0; // Tenths of a percent, from the last real sample
+static uint16_t estimate = 0;    // What the motor follows: measured, or predicted once the knobs move
+static uint16_t sample_pots[3] = {0, 0, 0}; // Knob positions of the last real sample
+static bool success_reward_shown = false;
+static target_match_t match = {0, 0, 0};
+
+static scheduler_t core0_scheduler;
+static scheduler_task_t samples_task, motor_task, lcd_task, report_task, input_task;
+
+// Target colors (levels / treasures). Every sample is scored against the closest one.
+static const struct
+{
+    const char *name;
+    uint32_t r_hz, g_hz, b_hz, c_hz;
+} target_table[] = {
+    {"Treasure", TARGET_R_HZ, TARGET_G_HZ, TARGET_B_HZ, TARGET_C_HZ},
+};
+
+#if SCORE_MODE == SCORE_CHROMA
+#define SCORE_METRIC TARGET_METRIC_CHROMA
+#elif SCORE_MODE == SCORE_DELTA_E
+#define SCORE_METRIC TARGET_METRIC_DELTA_E
+#else
+#define SCORE_METRIC TARGET_METRIC_ABSOLUTE
+#endif
+
+// True if any knob moved more than ESTIMATE_POT_DEADBAND away from `from`
+static bool pots_moved(const uint16_t pots[3], const uint16_t from[3])
+{
+    for (int i = 0; i < 3; i++)
+    {
+        if (abs((int)pots[i] - (int)from[i]) > ESTIMATE_POT_DEADBAND)
+            return true;
+    }
+    return false;
+}
+
+// Score a reading against the closest target, both judged in the SCORE_MODE space
+static uint16_t score_reading(uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, uint32_t c_hz, target_match_t *match)
+{
+    if (!target_set_match_metric(SCORE_METRIC, r_hz, g_hz, b_hz, c_hz, match))
+        return 0;
+    return match->score;
+}
+
+// -----------------------------------------------------------------------------
+// Core 0 tasks
+// -----------------------------------------------------------------------------
+
+// Consume queued samples, then refresh the live estimate from the knobs
+static void samples_task_run(void *arg)
+{
+    (void)arg;
+    uint32_t stage_mark = time_us_32();
+
+    // Consume queued samples through the filters
+    color_sample_t sample;
+    bool fresh = false;
+    while (sample_ring_pop(&sample_ring, &sample))
+    {
+        fresh = true;
+        sample_filter_update(&filter_r, sample.r_hz);
+        sample_filter_update(&filter_g, sample.g_hz);
+        sample_filter_update(&filter_b, sample.b_hz);
+        sample_filter_update(&filter_c, sample.c_hz);
+
+        sensor_r = sample_filter_value(&filter_r);
+        sensor_g = sample_filter_value(&filter_g);
+        sensor_b = sample_filter_value(&filter_b);
+
+        // Find the closest target and calculate correctness on the filtered values. Success
+        // only counts once the readings have stopped moving, so a filter sweeping through
+        // the target while the knobs are still turning locks neither the motor, the web
+        // page nor the LCD (they all see this one value)
+        const bool settled = sample_filter_settled(&filter_r) && sample_filter_settled(&filter_g) &&
+                             sample_filter_settled(&filter_b);
+        correctness = correctness_settled(
+            score_reading(sensor_r, sensor_g, sensor_b, sample_filter_value(&filter_c), &match), settled);
+        if (target_set_count() > 0)
+            wifi_update_target(match.index, target_set_get(match.index)->name);
+
+        // Teach the pot -> sensor model with the raw reading. The RLS step is float
+        // arithmetic done in software on the M0+, so its cost is a stage of its own in /stats
+        const uint32_t measured[3] = {sample.r_hz, sample.g_hz, sample.b_hz};
+        const uint32_t model_start = time_us_32();
+        pot_model_update(sample.pots, measured);
+        loop_stats_record(LOOP_STAGE_MODEL, time_us_32() - model_start);
+        for (int i = 0; i < 3; i++)
+            sample_pots[i] = sample.pots[i];
+
+        // Update web server
+        wifi_update_data((uint16_t)sensor_r, (uint16_t)sensor_g, (uint16_t)sensor_b, correctness);
+    }
+
+    // A fresh measurement is the estimate. Between samples, once the knobs (read by core 1)
+    // have moved away from where the last sample was taken, predict from their positions.
+    // Success is only ever declared from a real measurement.
+    estimate = correctness;
+    if (!fresh && pot_model_ready() && correctness < CORRECTNESS_SUCCESS)
+    {
+        uint16_t pots[3];
+        sensor_worker_get_pots(pots);
+        if (pots_moved(pots, sample_pots))
+        {
+            uint32_t predicted[3];
+            target_match_t predicted_match;
+            pot_model_predict(pots, predicted);
+            estimate = score_reading(predicted[0], predicted[1], predicted[2], sample_filter_value(&filter_c),
+                                     &predicted_match);
+            if (estimate >= CORRECTNESS_SUCCESS)
+                estimate = CORRECTNESS_SUCCESS - 1;
+        }
+    }
+    loop_stats_mark(LOOP_STAGE_SAMPLES, &stage_mark);
+
+    // Display success message
+    if (correctness >= CORRECTNESS_SUCCESS && !success_reward_shown)
+    {
+        success_reward_shown = true;
+        lcd_clear();
+        lcd_string("SUCCESS! Seq:");
+        lcd_set_cursor(1, 0);
+        lcd_string("2,6,18,54,X");
+        lcd_flush();
+        loop_stats_mark(LOOP_STAGE_LCD, &stage_mark);
+    }
+}
+
+static void motor_task_run(void *arg)
 {
-    // 1. Avoid division by zero
-    if (TARGET_R_HZ == 0 || TARGET_G_HZ == 0 || TARGET_B_HZ == 0)
-        return 0.0f;
-
-    // 2. Calculate % difference for each channel individually
-    // A value of 0.0 means perfect. 1.0 means 100% wrong.
-    float diff_r = fabsf((float)r - TARGET_R_HZ) / TARGET_R_HZ;
-    float diff_g = fabsf((float)g - TARGET_G_HZ) / TARGET_G_HZ;
-    float diff_b = fabsf((float)b - TARGET_B_HZ) / TARGET_B_HZ;
-
-    // 3. Average the errors
-    float total_error = (diff_r + diff_g + diff_b) / 3.0f;
-
-    // 4. Invert: If error is 0, accuracy is 100%.
-    // If error is > 1.0 (more than 100% off), accuracy is 0.
-    float accuracy = 100.0f * (1.0f - total_error);
-
-    // 5. Clamp results
-    if (accuracy < 0.0f)
-        accuracy = 0.0f;
-    if (accuracy > 100.0f)
-        accuracy = 100.0f;
-
-    return accuracy;
+    (void)arg;
+    uint32_t stage_mark = time_us_32();
+    Motor_UpdateActuation(estimate);
+    loop_stats_mark(LOOP_STAGE_MOTOR, &stage_mark);
+}
+
+static void lcd_task_run(void *arg)
+{
+    (void)arg;
+    if (success_reward_shown)
+        return;
+
+    uint32_t stage_mark = time_us_32();
+
+    // Redraw the whole screen; the flush only sends the cells that changed
+    // Row 0: name of the closest target
+    if (target_set_count() > 0)
+    {
+        char name_buf[17];
+        snprintf(name_buf, sizeof(name_buf), "%-16s", target_set_get(match.index)->name);
+        lcd_set_cursor(0, 0);
+        lcd_string(name_buf);
+    }
+
+    lcd_set_cursor(1, 0);
+    char buf[16];
+    snprintf(buf, 16, "Acc: %3u.%u%%", estimate / 10u, estimate % 10u);
+    lcd_string(buf);
+    lcd_flush();
+    loop_stats_mark(LOOP_STAGE_LCD, &stage_mark);
+}
+
+static void report_task_run(void *arg)
+{
+    (void)arg;
+    static uint32_t last_samples = 0;
+    static uint32_t last_idle_us = 0;
+
+    const uint32_t samples = sensor_worker_sample_count();
+    const uint32_t idle_us = core0_scheduler.idle_us;
+    printf("motor jitter max: %lu us, idle: %lu%%, samples: %lu/s (dropped %lu), model err: %lu Hz%s\n",
+           (unsigned long)motor_task.max_jitter_us,
+           (unsigned long)((idle_us - last_idle_us) / (LOOP_REPORT_MS * 10u)),
+           (unsigned long)((samples - last_samples) * 1000u / LOOP_REPORT_MS), (unsigned long)sample_ring.dropped,
+           (unsigned long)pot_model_error_hz(), pot_model_ready() ? "" : " (learning)");
+    last_samples = samples;
+    last_idle_us = idle_us;
+}
+
+// Full stats dump on demand over USB
+static void input_task_run(void *arg)
+{
+    (void)arg;
+    if (getchar_timeout_us(0) == 's')
+    {
+        static char stats[STATS_DUMP_MAX];
+        wifi_format_stats(stats, sizeof(stats));
+        printf("%s\n", stats);
+    }
 }
 
 int main()
@@ -59,11 +271,11 @@ int main()
     // 1. Initialize Subsystems
     lcd_init();
     lcd_string("Booting...");
+    lcd_flush();
 
     button_init();
     PotLED_Init();
     Motor_Init();
-    TCS3200_Init();
 
     // 2. Initialize Wi-Fi (AP Mode)
     wifi_init_ap("Treasure_Hunt", "password123");
@@ -73,67 +285,49 @@ int main()
     lcd_string("IP: 192.168.4.1");
     lcd_set_cursor(1, 0);
     lcd_string("Waiting Start...");
+    lcd_flush();
 
     // Wait for button press to start the game
     while (!button_is_pressed())
-    {
-        wifi_poll();
         sleep_ms(50);
-    }
 
     lcd_clear();
     lcd_string("Game Active!");
+    lcd_flush();
 
-    // Variables for the loop
-    uint32_t sensor_r = 0, sensor_g = 0, sensor_b = 0;
-    uint16_t pot_r = 0, pot_g = 0, pot_b = 0;
-    float correctness = 0.0f;
-    bool success_reward_shown = false;
-
-    while (true)
-    {
-        // Poll WiFi
-        wifi_poll();
-
-        // Read potentiometers and update LEDs
-        pot_r = PotLED_UpdateIntensity(POT_R_GPIO_PIN, LED_R_GPIO_PIN);
-        pot_g = PotLED_UpdateIntensity(POT_G_GPIO_PIN, LED_G_GPIO_PIN);
-        pot_b = PotLED_UpdateIntensity(POT_B_GPIO_PIN, LED_B_GPIO_PIN);
-
-        // Read color sensor
-        TCS3200_ReadRGB(10, &sensor_r, &sensor_g, &sensor_b);
-
-        // Calculate correctness
-        correctness = calculate_correctness(sensor_r, sensor_g, sensor_b);
-
-        // Control motor
-        Motor_UpdateActuation(correctness);
-
-        // Display success message
-        if (correctness >= 97.0f && !success_reward_shown)
-        {
-            success_reward_shown = true;
-            lcd_clear();
-            lcd_string("SUCCESS! Seq:");
-            lcd_set_cursor(1, 0);
-            lcd_string("2,6,18,54,X");
-        }
+    for (unsigned i = 0; i < sizeof(target_table) / sizeof(target_table[0]); i++)
+        target_set_add(target_table[i].name, target_table[i].r_hz, target_table[i].g_hz,
+                       target_table[i].b_hz, target_table[i].c_hz);
+    sample_ring_init(&sample_ring);
+    sample_filter_init(&filter_r);
+    sample_filter_init(&filter_g);
+    sample_filter_init(&filter_b);
+    sample_filter_init(&filter_c);
+    pot_model_init();
+    loop_stats_init();
 
-        // Update web server
-        wifi_update_data((uint16_t)sensor_r, (uint16_t)sensor_g, (uint16_t)sensor_b, correctness);
+    // Pots, LEDs and color acquisition run on core 1 from here on; this core
+    // keeps scoring, the motor and the LCD (networking runs in the background)
+    const sensor_worker_config_t worker_config = {
+        .ring = &sample_ring,
+        .measure_mode = SENSOR_MEASURE_MODE,
+        .autorange = SENSOR_AUTORANGE,
+        .acquire_clear = SCORE_MODE == SCORE_CHROMA,
+        .gate_ms = SENSOR_GATE_MS,
+    };
+    scheduler_init(&core0_scheduler, "core0", NULL);
+    sensor_worker_start(&worker_config);
 
-        // Update LCD
-        static int lcd_counter = 0;
-        if (lcd_counter++ > 10 && !success_reward_shown)
-        {
-            lcd_set_cursor(1, 0);
-            char buf[16];
-            snprintf(buf, 16, "Acc: %3.1f%%", correctness);
-            lcd_string(buf);
-            lcd_counter = 0;
-        }
+    scheduler_add_periodic(&core0_scheduler, &samples_task, "samples", samples_task_run, NULL,
+                           SAMPLES_PERIOD_MS * 1000u, 0);
+    scheduler_add_periodic(&core0_scheduler, &motor_task, "motor", motor_task_run, NULL, MOTOR_PERIOD_MS * 1000u, 0);
+    scheduler_add_periodic(&core0_scheduler, &lcd_task, "lcd", lcd_task_run, NULL, LCD_REFRESH_MS * 1000u,
+                           LCD_REFRESH_MS * 1000u);
+    scheduler_add_periodic(&core0_scheduler, &report_task, "report", report_task_run, NULL, LOOP_REPORT_MS * 1000u,
+                           LOOP_REPORT_MS * 1000u);
+    scheduler_add_periodic(&core0_scheduler, &input_task, "input", input_task_run, NULL, STATS_INPUT_POLL_MS * 1000u,
+                           STATS_INPUT_POLL_MS * 1000u);
+    scheduler_run(&core0_scheduler);
 
-        sleep_ms(50);
-    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,130 @@
+#include "pot_model.h"
+#include "potentiometer_led.h"
+
+#define POT_MODEL_PARAMS 4 // bias + three pots
+
+static float theta[3][POT_MODEL_PARAMS];              // Weights per output channel
+static float cov[POT_MODEL_PARAMS][POT_MODEL_PARAMS]; // Shared covariance P
+static uint32_t update_count = 0;
+static float error_ema = 0.0f; // Mean abs error per channel, Hz
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+// Regressor: [1, pot_r, pot_g, pot_b] with pots scaled to 0..1
+static void pot_model_regressor(const uint16_t pots[3], float x[POT_MODEL_PARAMS])
+{
+    x[0] = 1.0f;
+    for (int i = 0; i < 3; i++)
+        x[i + 1] = (float)pots[i] / (float)(ADC_MAX_VALUE + 1);
+}
+
+static float pot_model_eval(int channel, const float x[POT_MODEL_PARAMS])
+{
+    float y = 0.0f;
+    for (int i = 0; i < POT_MODEL_PARAMS; i++)
+        y += theta[channel][i] * x[i];
+    return y;
+}
+
+static uint32_t pot_model_clamp_hz(float y)
+{
+    return (y <= 0.0f) ? 0u : (uint32_t)(y + 0.5f);
+}
+
+// -----------------------------------------------------------------------------
+// Public API implementation
+// -----------------------------------------------------------------------------
+
+void pot_model_init(void)
+{
+    for (int i = 0; i < POT_MODEL_PARAMS; i++)
+    {
+        for (int j = 0; j < POT_MODEL_PARAMS; j++)
+            cov[i][j] = (i == j) ? POT_MODEL_INITIAL_P : 0.0f;
+        for (int c = 0; c < 3; c++)
+            theta[c][i] = 0.0f;
+    }
+    update_count = 0;
+    error_ema = 0.0f;
+}
+
+void pot_model_update(const uint16_t pots[3], const uint32_t hz[3])
+{
+    float x[POT_MODEL_PARAMS];
+    pot_model_regressor(pots, x);
+
+    // 1. A-priori error: how well did we predict this sample?
+    float err[3];
+    float abs_err_sum = 0.0f;
+    for (int c = 0; c < 3; c++)
+    {
+        err[c] = (float)hz[c] - pot_model_eval(c, x);
+        abs_err_sum += (err[c] < 0.0f) ? -err[c] : err[c];
+    }
+    const float abs_err = abs_err_sum * (1.0f / 3.0f);
+    error_ema = (update_count == 0) ? abs_err : error_ema + 0.1f * (abs_err - error_ema);
+
+    // 2. Gain k = P x / (lambda + x' P x)
+    float px[POT_MODEL_PARAMS];
+    float xpx = 0.0f;
+    for (int i = 0; i < POT_MODEL_PARAMS; i++)
+    {
+        px[i] = 0.0f;
+        for (int j = 0; j < POT_MODEL_PARAMS; j++)
+            px[i] += cov[i][j] * x[j];
+        xpx += x[i] * px[i];
+    }
+
+    // Without new excitation P grows by 1/lambda per update; stop forgetting before it winds up
+    float trace = 0.0f;
+    for (int i = 0; i < POT_MODEL_PARAMS; i++)
+        trace += cov[i][i];
+    const float lambda = (trace > POT_MODEL_MAX_TRACE) ? 1.0f : POT_MODEL_FORGETTING;
+
+    // No FPU on the M0+: every float operation is a software call and division is the
+    // dearest, so divide once for each reciprocal and multiply after
+    const float inv_denom = 1.0f / (lambda + xpx);
+    const float inv_lambda = 1.0f / lambda;
+    float k[POT_MODEL_PARAMS];
+    for (int i = 0; i < POT_MODEL_PARAMS; i++)
+        k[i] = px[i] * inv_denom;
+
+    // 3. Weights: theta += k * err (same gain for every channel)
+    for (int c = 0; c < 3; c++)
+        for (int i = 0; i < POT_MODEL_PARAMS; i++)
+            theta[c][i] += k[i] * err[c];
+
+    // 4. Covariance: P = (P - k (P x)') / lambda  (P is symmetric, so x' P = (P x)').
+    // Only the upper triangle is computed and mirrored: in float, updating both halves
+    // lets rounding make P asymmetric, then indefinite, and the fit diverges after a
+    // few thousand samples. It also saves 6 of the 16 soft-float updates.
+    for (int i = 0; i < POT_MODEL_PARAMS; i++)
+        for (int j = i; j < POT_MODEL_PARAMS; j++)
+        {
+            cov[i][j] = (cov[i][j] - k[i] * px[j]) * inv_lambda;
+            cov[j][i] = cov[i][j];
+        }
+
+    update_count++;
+}
+
+void pot_model_predict(const uint16_t pots[3], uint32_t hz[3])
+{
+    float x[POT_MODEL_PARAMS];
+    pot_model_regressor(pots, x);
+
+    for (int c = 0; c < 3; c++)
+        hz[c] = pot_model_clamp_hz(pot_model_eval(c, x));
+}
+
+bool pot_model_ready(void)
+{
+    return update_count >= POT_MODEL_MIN_UPDATES && error_ema < (float)POT_MODEL_MAX_ERROR_HZ;
+}
+
+uint32_t pot_model_error_hz(void)
+{
+    return pot_model_clamp_hz(error_ema);
+}
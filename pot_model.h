@@ -0,0 +1,47 @@
+#ifndef POT_MODEL_H
+#define POT_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// --- CONFIGURATION ---
+// Forgetting factor: older samples lose weight by this factor per update (slow drift, ambient light)
+#define POT_MODEL_FORGETTING 0.98f
+// Initial covariance (large = trust the first samples a lot)
+#define POT_MODEL_INITIAL_P 1000.0f
+// Covariance trace above which forgetting is paused (pots left alone = no new information)
+#define POT_MODEL_MAX_TRACE 10000.0f
+// Updates needed before predictions are trusted
+#define POT_MODEL_MIN_UPDATES 20
+// Predictions are only used while the running error stays below this (Hz per channel).
+// About 3 % of the ~1.3 kHz treasure readings, i.e. the success margin: a looser model
+// would move the estimate by more than the distance the player is trying to close.
+#define POT_MODEL_MAX_ERROR_HZ 40
+
+/**
+ * @brief Online model of the color sensor readings as a function of the potentiometers.
+ *
+ * Each channel is modelled as hz = w0 + w1 * pot_r + w2 * pot_g + w3 * pot_b, fitted by
+ * recursive least squares on every real sensor sample. The three channels share one
+ * covariance matrix since they share the regressors. Between sensor reads the model
+ * predicts what the sensor would see for the current knob positions.
+ *
+ * The fit is float arithmetic, which the M0+ does in software; main.c times every
+ * update as the "model" stage in /stats.
+ */
+void pot_model_init(void);
+
+// Fit one real sample: pot positions (raw ADC) while it was acquired, and the measured Hz
+void pot_model_update(const uint16_t pots[3], const uint32_t hz[3]);
+
+// Predict the sensor readings for the given pot positions
+void pot_model_predict(const uint16_t pots[3], uint32_t hz[3]);
+
+// True once the model has seen enough samples and its recent error is small
+bool pot_model_ready(void);
+
+// Running mean absolute error of predicted-vs-measured, Hz per channel
+// (each sample is predicted before the model is updated with it)
+uint32_t pot_model_error_hz(void);
+
+#endif
@@ -0,0 +1,110 @@
+#include "sample_filter.h"
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+// Remove one occurrence of `value` from the sorted window
+static void sorted_remove(sample_filter_t *f, uint32_t value)
+{
+    uint8_t i = 0;
+    while (i < f->count && f->sorted[i] != value)
+        i++;
+
+    for (; i + 1u < f->count; i++)
+        f->sorted[i] = f->sorted[i + 1u];
+}
+
+// Insert `value` keeping the window sorted (entries [0, n) are valid)
+static void sorted_insert(sample_filter_t *f, uint8_t n, uint32_t value)
+{
+    uint8_t i = n;
+    while (i > 0 && f->sorted[i - 1u] > value)
+    {
+        f->sorted[i] = f->sorted[i - 1u];
+        i--;
+    }
+    f->sorted[i] = value;
+}
+
+// -----------------------------------------------------------------------------
+// Public API implementation
+// -----------------------------------------------------------------------------
+
+void sample_filter_init(sample_filter_t *f)
+{
+    f->count = 0;
+    f->next = 0;
+    f->sum = 0;
+    f->sum_sq = 0;
+    f->ema_q8 = 0;
+    f->ema_primed = false;
+}
+
+void sample_filter_update(sample_filter_t *f, uint32_t hz)
+{
+    // 1. Slide the window: drop the oldest reading once full
+    if (f->count == SAMPLE_FILTER_WINDOW)
+    {
+        const uint32_t oldest = f->history[f->next];
+        f->sum -= oldest;
+        f->sum_sq -= (uint64_t)oldest * oldest;
+        sorted_remove(f, oldest);
+        f->count--;
+    }
+
+    f->history[f->next] = hz;
+    f->next = (uint8_t)((f->next + 1u) % SAMPLE_FILTER_WINDOW);
+    sorted_insert(f, f->count, hz);
+    f->count++;
+    f->sum += hz;
+    f->sum_sq += (uint64_t)hz * hz;
+
+    // 2. EMA of the median: ema += (median - ema) * alpha
+    const uint32_t median_q8 = sample_filter_median(f) << 8;
+    if (!f->ema_primed)
+    {
+        f->ema_q8 = median_q8;
+        f->ema_primed = true;
+    }
+    else
+    {
+        int32_t delta = (int32_t)(median_q8 - f->ema_q8);
+        f->ema_q8 = (uint32_t)((int32_t)f->ema_q8 + (delta / (1 << SAMPLE_FILTER_EMA_SHIFT)));
+    }
+}
+
+uint32_t sample_filter_median(const sample_filter_t *f)
+{
+    if (f->count == 0)
+        return 0;
+    return f->sorted[f->count / 2u];
+}
+
+uint32_t sample_filter_value(const sample_filter_t *f)
+{
+    // Round Q24.8 back to whole Hz
+    return (f->ema_q8 + 128u) >> 8;
+}
+
+uint32_t sample_filter_variance(const sample_filter_t *f)
+{
+    if (f->count < 2)
+        return 0;
+
+    // Var = (sum_sq - sum^2 / n) / (n - 1)
+    const uint64_t n = f->count;
+    const uint64_t spread = f->sum_sq - (f->sum * f->sum) / n;
+    const uint64_t variance = spread / (n - 1u);
+    return variance > UINT32_MAX ? UINT32_MAX : (uint32_t)variance; // Saturate for very noisy windows
+}
+
+bool sample_filter_settled(const sample_filter_t *f)
+{
+    if (f->count < SAMPLE_FILTER_WINDOW)
+        return false;
+
+    // stddev <= median * pct / 100, compared squared to stay in integers
+    const uint64_t limit = ((uint64_t)sample_filter_median(f) * SAMPLE_FILTER_SETTLED_PERCENT) / 100u;
+    return (uint64_t)sample_filter_variance(f) <= limit * limit;
+}
@@ -0,0 +1,51 @@
+#ifndef SAMPLE_FILTER_H
+#define SAMPLE_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Sliding window length for the median and variance (small and odd)
+#define SAMPLE_FILTER_WINDOW 5
+// EMA smoothing factor alpha = 1 / 2^SAMPLE_FILTER_EMA_SHIFT
+#define SAMPLE_FILTER_EMA_SHIFT 2
+// A full window whose standard deviation is within this share of the median counts as settled
+#define SAMPLE_FILTER_SETTLED_PERCENT 2
+
+/**
+ * @brief Streaming filter state for one color channel.
+ *
+ * Each new reading goes into a sliding window (median + variance), and the
+ * window median feeds an EMA. A single noisy gate is rejected by the median
+ * before it can reach the EMA. All updates are constant time for the fixed window.
+ */
+typedef struct
+{
+    uint32_t history[SAMPLE_FILTER_WINDOW]; // Window in arrival order (circular)
+    uint32_t sorted[SAMPLE_FILTER_WINDOW];  // Same values kept sorted
+    uint8_t count;                          // Valid entries (<= window)
+    uint8_t next;                           // Oldest entry / next write position
+    uint64_t sum;                           // Sum of the window
+    uint64_t sum_sq;                        // Sum of squares of the window
+    uint32_t ema_q8;                        // EMA of the median, Q24.8
+    bool ema_primed;
+} sample_filter_t;
+
+void sample_filter_init(sample_filter_t *f);
+
+// Push one raw reading (Hz)
+void sample_filter_update(sample_filter_t *f, uint32_t hz);
+
+// Median of the current window
+uint32_t sample_filter_median(const sample_filter_t *f);
+
+// Smoothed output (EMA of the median) - this is what the correctness pipeline uses
+uint32_t sample_filter_value(const sample_filter_t *f);
+
+// Variance of the raw readings in the window (Hz^2)
+uint32_t sample_filter_variance(const sample_filter_t *f);
+
+// True once the window is full and its spread is within SAMPLE_FILTER_SETTLED_PERCENT
+// of the median, i.e. the sensor is holding still on one color
+bool sample_filter_settled(const sample_filter_t *f);
+
+#endif
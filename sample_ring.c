@@ -0,0 +1,49 @@
+#include "sample_ring.h"
+#include "hardware/sync.h"
+
+#define SAMPLE_RING_MASK (SAMPLE_RING_SIZE - 1u)
+
+void sample_ring_init(sample_ring_t *ring)
+{
+    ring->head = 0;
+    ring->tail = 0;
+    ring->dropped = 0;
+}
+
+bool sample_ring_push(sample_ring_t *ring, const color_sample_t *sample)
+{
+    const uint32_t head = ring->head;
+    if ((head - ring->tail) >= SAMPLE_RING_SIZE)
+    {
+        ring->dropped++;
+        return false;
+    }
+
+    ring->slots[head & SAMPLE_RING_MASK] = *sample;
+
+    // Make the slot contents visible before publishing the new head
+    __dmb();
+    ring->head = head + 1u;
+    return true;
+}
+
+bool sample_ring_pop(sample_ring_t *ring, color_sample_t *sample)
+{
+    const uint32_t tail = ring->tail;
+    if (tail == ring->head)
+        return false;
+
+    // Read the slot only after seeing the head that published it
+    __dmb();
+    *sample = ring->slots[tail & SAMPLE_RING_MASK];
+
+    // Finish reading the slot before handing it back to the producer
+    __dmb();
+    ring->tail = tail + 1u;
+    return true;
+}
+
+uint32_t sample_ring_count(const sample_ring_t *ring)
+{
+    return ring->head - ring->tail;
+}
@@ -0,0 +1,47 @@
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "color_sensor.h"
+
+// Number of slots (must be a power of two)
+#define SAMPLE_RING_SIZE 16
+
+// One RGB acquisition from the color sensor
+typedef struct
+{
+    uint32_t timestamp_us; // time_us_32() when the triple completed
+    uint32_t r_hz;         // Normalised to TCS3200_REFERENCE_SCALE
+    uint32_t g_hz;
+    uint32_t b_hz;
+    uint32_t c_hz;   // CLEAR channel, 0 unless the acquisition includes it
+    uint8_t r_scale; // tcs3200_scale_t each channel was measured at
+    uint8_t g_scale;
+    uint8_t b_scale;
+    uint8_t c_scale;
+    uint16_t pots[3]; // Raw potentiometer positions (R, G, B) when the acquisition started
+} color_sample_t;
+
+// Single-producer / single-consumer ring. No locks and no allocation:
+// only the producer writes head, only the consumer writes tail.
+typedef struct
+{
+    color_sample_t slots[SAMPLE_RING_SIZE];
+    volatile uint32_t head;    // Next slot to write (free-running)
+    volatile uint32_t tail;    // Next slot to read (free-running)
+    volatile uint32_t dropped; // Samples rejected because the ring was full
+} sample_ring_t;
+
+void sample_ring_init(sample_ring_t *ring);
+
+// Producer side. Returns false (and counts a drop) if the ring is full.
+bool sample_ring_push(sample_ring_t *ring, const color_sample_t *sample);
+
+// Consumer side. Returns false if the ring is empty.
+bool sample_ring_pop(sample_ring_t *ring, color_sample_t *sample);
+
+// Number of samples waiting to be consumed
+uint32_t sample_ring_count(const sample_ring_t *ring);
+
+#endif
@@ -0,0 +1,290 @@
+#include "scheduler.h"
+#include <stdio.h>
+#include <stddef.h>
+#ifndef SCHEDULER_HOST
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#endif
+
+// Sleep used when no task is queued at all
+#define SCHEDULER_EMPTY_SLEEP_US 1000
+
+static scheduler_t *schedulers[SCHEDULER_MAX_INSTANCES];
+static int scheduler_count = 0;
+
+// One task's statistics as copied out for scheduler_format_json
+typedef struct
+{
+    const char *name;
+    uint32_t period_us;
+    uint32_t runs;
+    uint32_t overruns;
+    uint32_t max_jitter_us;
+    uint64_t total_jitter_us;
+} task_stats_t;
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+#ifndef SCHEDULER_HOST
+static uint32_t hw_now_us(void)
+{
+    return time_us_32();
+}
+
+static void hw_sleep_until_us(uint32_t deadline_us)
+{
+    const int32_t delay = (int32_t)(deadline_us - time_us_32());
+    if (delay > 0)
+        sleep_us((uint64_t)delay); // Hardware alarm + WFE, the core really idles
+}
+
+static const scheduler_clock_t hw_clock = {hw_now_us, hw_sleep_until_us};
+#endif
+
+// Interrupts stay off on this core while the lock is held, so /stats running in an
+// IRQ can never spin on a lock its own core was interrupted holding
+static inline uint32_t stats_lock(const scheduler_t *sched)
+{
+#ifndef SCHEDULER_HOST
+    return spin_lock_blocking(sched->stats_lock);
+#else
+    (void)sched;
+    return 0;
+#endif
+}
+
+static inline void stats_unlock(const scheduler_t *sched, uint32_t saved_irq)
+{
+#ifndef SCHEDULER_HOST
+    spin_unlock(sched->stats_lock, saved_irq);
+#else
+    (void)sched;
+    (void)saved_irq;
+#endif
+}
+
+// Wrap-safe "a is before b"
+static inline bool time_before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+static void queue_insert(scheduler_t *sched, scheduler_task_t *task)
+{
+    scheduler_task_t **link = &sched->queue;
+    // Equal deadlines keep insertion order, so tasks due together run round-robin
+    while (*link && !time_before(task->deadline_us, (*link)->deadline_us))
+        link = &(*link)->next;
+    task->next = *link;
+    *link = task;
+    task->queued = true;
+}
+
+static void queue_remove(scheduler_t *sched, scheduler_task_t *task)
+{
+    for (scheduler_task_t **link = &sched->queue; *link; link = &(*link)->next)
+    {
+        if (*link == task)
+        {
+            *link = task->next;
+            break;
+        }
+    }
+    task->next = NULL;
+    task->queued = false;
+}
+
+static void task_setup(scheduler_task_t *task, const char *name, scheduler_task_fn fn, void *arg, uint32_t period_us)
+{
+    task->name = name;
+    task->fn = fn;
+    task->arg = arg;
+    task->period_us = period_us;
+    task->runs = 0;
+    task->overruns = 0;
+    task->max_jitter_us = 0;
+    task->total_jitter_us = 0;
+}
+
+// List the task in /stats (once, however often it is re-added). Call with the stats lock held.
+static void task_register(scheduler_t *sched, scheduler_task_t *task)
+{
+    for (int i = 0; i < sched->task_count; i++)
+    {
+        if (sched->tasks[i] == task)
+            return;
+    }
+    if (sched->task_count < SCHEDULER_MAX_TASKS)
+        sched->tasks[sched->task_count++] = task;
+}
+
+// -----------------------------------------------------------------------------
+// Public API implementation
+// -----------------------------------------------------------------------------
+
+void scheduler_init(scheduler_t *sched, const char *name, const scheduler_clock_t *clock)
+{
+#ifndef SCHEDULER_HOST
+    if (!clock)
+        clock = &hw_clock;
+#endif
+    sched->name = name;
+    sched->clock = clock;
+    sched->queue = NULL;
+    sched->started_us = clock->now_us();
+    sched->idle_us = 0;
+    sched->task_count = 0;
+
+    // Initialised again: keep its place in /stats and its lock
+    for (int i = 0; i < scheduler_count; i++)
+    {
+        if (schedulers[i] == sched)
+            return;
+    }
+
+#ifndef SCHEDULER_HOST
+    sched->stats_lock = spin_lock_init(spin_lock_claim_unused(true));
+#else
+    sched->stats_lock = NULL;
+#endif
+    // Only ever called from core 0 before core 1 runs (see scheduler.h), so no lock
+    if (scheduler_count < SCHEDULER_MAX_INSTANCES)
+        schedulers[scheduler_count++] = sched;
+}
+
+void scheduler_add_periodic(scheduler_t *sched, scheduler_task_t *task, const char *name,
+                            scheduler_task_fn fn, void *arg, uint32_t period_us, uint32_t first_delay_us)
+{
+    if (task->queued)
+        queue_remove(sched, task);
+
+    const uint32_t saved_irq = stats_lock(sched);
+    task_setup(task, name, fn, arg, period_us);
+    task_register(sched, task);
+    stats_unlock(sched, saved_irq);
+
+    task->deadline_us = sched->clock->now_us() + first_delay_us;
+    queue_insert(sched, task);
+}
+
+void scheduler_add_oneshot(scheduler_t *sched, scheduler_task_t *task, const char *name,
+                           scheduler_task_fn fn, void *arg, uint32_t delay_us)
+{
+    scheduler_add_periodic(sched, task, name, fn, arg, 0, delay_us);
+}
+
+void scheduler_cancel(scheduler_t *sched, scheduler_task_t *task)
+{
+    if (task->queued)
+        queue_remove(sched, task);
+}
+
+uint32_t scheduler_run_due(scheduler_t *sched)
+{
+    uint32_t ran = 0;
+
+    // Only what is due now: a task that keeps falling behind cannot keep this call from returning
+    const uint32_t horizon = sched->clock->now_us();
+    while (sched->queue && !time_before(horizon, sched->queue->deadline_us))
+    {
+        scheduler_task_t *task = sched->queue;
+        const uint32_t now = sched->clock->now_us();
+
+        // Dequeue first, so the task may cancel or re-add itself
+        queue_remove(sched, task);
+
+        const uint32_t jitter = now - task->deadline_us;
+        const uint32_t saved_irq = stats_lock(sched);
+        task->runs++;
+        task->total_jitter_us += jitter;
+        if (jitter > task->max_jitter_us)
+            task->max_jitter_us = jitter;
+
+        if (task->period_us)
+        {
+            // Next deadline on the original grid; skip (and count) whole periods that were missed
+            task->deadline_us += task->period_us;
+            if (!time_before(now, task->deadline_us))
+            {
+                const uint32_t missed = (now - task->deadline_us) / task->period_us + 1;
+                task->deadline_us += missed * task->period_us;
+                task->overruns++;
+            }
+        }
+        stats_unlock(sched, saved_irq);
+
+        if (task->period_us)
+            queue_insert(sched, task);
+
+        task->fn(task->arg);
+        ran++;
+    }
+    return ran;
+}
+
+void scheduler_run(scheduler_t *sched)
+{
+    while (true)
+    {
+        scheduler_run_due(sched);
+
+        const uint32_t sleep_from = sched->clock->now_us();
+        const uint32_t deadline = sched->queue ? sched->queue->deadline_us : sleep_from + SCHEDULER_EMPTY_SLEEP_US;
+        if (time_before(sleep_from, deadline))
+        {
+            sched->clock->sleep_until_us(deadline);
+            const uint32_t slept = sched->clock->now_us() - sleep_from;
+            const uint32_t saved_irq = stats_lock(sched);
+            sched->idle_us += slept;
+            stats_unlock(sched, saved_irq);
+        }
+    }
+}
+
+int scheduler_format_json(char *buf, int size)
+{
+    int len = snprintf(buf, size, "{");
+
+    for (int i = 0; i < scheduler_count && len < size; i++)
+    {
+        const scheduler_t *sched = schedulers[i];
+
+        // Copy under the lock, format after: the owning core is held up for a few loads only
+        task_stats_t stats[SCHEDULER_MAX_TASKS];
+        const uint32_t saved_irq = stats_lock(sched);
+        const uint32_t idle_us = sched->idle_us;
+        const int count = sched->task_count;
+        for (int k = 0; k < count; k++)
+        {
+            const scheduler_task_t *task = sched->tasks[k];
+            stats[k].name = task->name;
+            stats[k].period_us = task->period_us;
+            stats[k].runs = task->runs;
+            stats[k].overruns = task->overruns;
+            stats[k].max_jitter_us = task->max_jitter_us;
+            stats[k].total_jitter_us = task->total_jitter_us;
+        }
+        stats_unlock(sched, saved_irq);
+
+        const uint32_t elapsed = sched->clock->now_us() - sched->started_us;
+        len += snprintf(buf + len, size - len, "%s\"%s\":{\"uptime_us\":%lu,\"idle_us\":%lu,\"tasks\":{", i ? "," : "",
+                        sched->name, (unsigned long)elapsed, (unsigned long)idle_us);
+
+        for (int k = 0; k < count && len < size; k++)
+        {
+            const task_stats_t *task = &stats[k];
+            len += snprintf(buf + len, size - len,
+                            "%s\"%s\":{\"period_us\":%lu,\"runs\":%lu,\"avg_jitter_us\":%lu,\"max_jitter_us\":%lu,\"overruns\":%lu}",
+                            k ? "," : "", task->name, (unsigned long)task->period_us, (unsigned long)task->runs,
+                            (unsigned long)(task->runs ? task->total_jitter_us / task->runs : 0),
+                            (unsigned long)task->max_jitter_us, (unsigned long)task->overruns);
+        }
+        if (len < size)
+            len += snprintf(buf + len, size - len, "}}");
+    }
+    if (len < size)
+        len += snprintf(buf + len, size - len, "}");
+    return len;
+}
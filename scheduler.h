@@ -0,0 +1,97 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// --- CONFIGURATION ---
+// Schedulers listed in /stats (one per core)
+#define SCHEDULER_MAX_INSTANCES 2
+// Tasks per scheduler listed in /stats (more still run, they are just not reported)
+#define SCHEDULER_MAX_TASKS 8
+// Build with SCHEDULER_HOST defined to drop the Pico clock; every scheduler then needs a clock
+
+// Time source. Times are free-running 32-bit microseconds (wrap-safe up to ~35 min ahead).
+typedef struct
+{
+    uint32_t (*now_us)(void);
+    void (*sleep_until_us)(uint32_t deadline_us); // May return early; the scheduler re-checks
+} scheduler_clock_t;
+
+typedef void (*scheduler_task_fn)(void *arg);
+
+// Task storage is owned by the caller (usually static); the scheduler only links it in
+typedef struct scheduler_task
+{
+    const char *name;
+    scheduler_task_fn fn;
+    void *arg;
+    uint32_t period_us;   // 0 for a one-shot task
+    uint32_t deadline_us; // When it is next due
+    bool queued;
+
+    // Statistics
+    uint32_t runs;
+    uint32_t overruns;      // Runs that started a whole period late (the missed periods are skipped)
+    uint32_t max_jitter_us; // Worst start delay past the deadline
+    uint64_t total_jitter_us;
+
+    struct scheduler_task *next;
+} scheduler_task_t;
+
+typedef struct
+{
+    const char *name;
+    const scheduler_clock_t *clock;
+    scheduler_task_t *queue; // Sorted by deadline, earliest first
+    uint32_t started_us;
+    uint32_t idle_us; // Time spent sleeping until the next deadline (wraps like uptime)
+
+    // Every task ever added, in order (unlike the queue, never relinked), for /stats
+    scheduler_task_t *tasks[SCHEDULER_MAX_TASKS];
+    uint8_t task_count;
+    // Hardware spin lock around the statistics and tasks[]: /stats reads them from the
+    // other core (or from an IRQ on this one), and the M0+ cannot load or store the
+    // 64-bit total_jitter_us in one go. NULL with SCHEDULER_HOST.
+    volatile uint32_t *stats_lock;
+} scheduler_t;
+
+/**
+ * @brief Deadline-ordered cooperative scheduler.
+ *
+ * Tasks run to completion in deadline order; between them the scheduler sleeps
+ * until exactly the next deadline (a hardware alarm wakes the core), so every
+ * subsystem runs at its own rate instead of the rate of one shared loop.
+ * Nothing is allocated. A scheduler and its tasks belong to one core.
+ *
+ * Registration for /stats is not locked: initialise every scheduler from core 0
+ * before core 1 is launched (its tasks can then be added from core 1).
+ *
+ * @param clock NULL for the Pico timer (time_us_32 + sleep_us); a virtual clock
+ *              makes runs deterministic off-target.
+ */
+void scheduler_init(scheduler_t *sched, const char *name, const scheduler_clock_t *clock);
+
+// Run fn every period_us, first after first_delay_us. Deadlines advance by the period, so there is no drift.
+void scheduler_add_periodic(scheduler_t *sched, scheduler_task_t *task, const char *name,
+                            scheduler_task_fn fn, void *arg, uint32_t period_us, uint32_t first_delay_us);
+
+// Run fn once after delay_us (a queued task is rescheduled)
+void scheduler_add_oneshot(scheduler_t *sched, scheduler_task_t *task, const char *name,
+                           scheduler_task_fn fn, void *arg, uint32_t delay_us);
+
+// Remove a task (no-op if it is not queued). Safe to call from a running task.
+void scheduler_cancel(scheduler_t *sched, scheduler_task_t *task);
+
+// Run every task that is due. Returns how many ran.
+uint32_t scheduler_run_due(scheduler_t *sched);
+
+// Run tasks and sleep between them forever
+void scheduler_run(scheduler_t *sched);
+
+// Append every registered scheduler (idle time, per-task runs / jitter / overruns) as a JSON object.
+// Safe from either core and from interrupts: each scheduler is copied under its lock, then formatted.
+// Returns the length written (snprintf-style).
+int scheduler_format_json(char *buf, int size);
+
+#endif
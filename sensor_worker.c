@@ -0,0 +1,127 @@
+#include "sensor_worker.h"
+#include "potentiometer_led.h"
+#include "loop_stats.h"
+#include "scheduler.h"
+#include "pico/multicore.h"
+#include "hardware/sync.h"
+
+static sensor_worker_config_t worker_config;
+
+// Pot snapshot: seq is odd while core 1 is writing, readers retry if it moved
+static volatile uint32_t pots_seq = 0;
+static volatile uint16_t pots_shared[3];
+
+static volatile uint32_t samples_completed = 0;
+
+// Core 1 only
+static uint16_t pots[3] = {0, 0, 0};
+static uint16_t pots_at_start[3] = {0, 0, 0}; // Pot positions when the running acquisition started
+static scheduler_t core1_scheduler;
+static scheduler_task_t sensor_task, pots_task;
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+static void pots_publish(const uint16_t values[3])
+{
+    pots_seq++;
+    __dmb();
+    for (int i = 0; i < 3; i++)
+        pots_shared[i] = values[i];
+    __dmb();
+    pots_seq++;
+}
+
+// Read potentiometers and update LEDs
+static void pots_task_run(void *arg)
+{
+    (void)arg;
+    uint32_t stage_mark = time_us_32();
+    pots[0] = PotLED_UpdateIntensity(POT_R_GPIO_PIN, LED_R_GPIO_PIN);
+    pots[1] = PotLED_UpdateIntensity(POT_G_GPIO_PIN, LED_G_GPIO_PIN);
+    pots[2] = PotLED_UpdateIntensity(POT_B_GPIO_PIN, LED_B_GPIO_PIN);
+    pots_publish(pots);
+    loop_stats_mark(LOOP_STAGE_POTS, &stage_mark);
+}
+
+// Advance the color sensor state machine (never blocks) and queue finished samples
+static void sensor_task_run(void *arg)
+{
+    (void)arg;
+    uint32_t stage_mark = time_us_32();
+    if (TCS3200_PollRGB())
+    {
+        color_sample_t acquired;
+        tcs3200_scale_t scale_r, scale_g, scale_b, scale_c;
+        TCS3200_GetRGB(&acquired.r_hz, &acquired.g_hz, &acquired.b_hz);
+        TCS3200_GetRGBScale(&scale_r, &scale_g, &scale_b);
+        TCS3200_GetClear(&acquired.c_hz, &scale_c);
+        for (int i = 0; i < 3; i++)
+            acquired.pots[i] = pots_at_start[i];
+
+        TCS3200_StartRGB(worker_config.gate_ms);
+        for (int i = 0; i < 3; i++)
+            pots_at_start[i] = pots[i];
+
+        acquired.timestamp_us = time_us_32();
+        acquired.r_scale = (uint8_t)scale_r;
+        acquired.g_scale = (uint8_t)scale_g;
+        acquired.b_scale = (uint8_t)scale_b;
+        acquired.c_scale = (uint8_t)scale_c;
+        sample_ring_push(worker_config.ring, &acquired);
+        samples_completed++;
+    }
+    loop_stats_mark(LOOP_STAGE_SENSOR, &stage_mark);
+}
+
+// Core 1 entry point
+static void sensor_worker_main(void)
+{
+    TCS3200_Init();
+    TCS3200_SetMeasureMode(worker_config.measure_mode);
+    TCS3200_SetAutoRange(worker_config.autorange);
+    TCS3200_SetAcquireClear(worker_config.acquire_clear);
+
+    // Kick off the first color acquisition; it runs in the background from here on
+    pots_task_run(NULL);
+    TCS3200_StartRGB(worker_config.gate_ms);
+    for (int i = 0; i < 3; i++)
+        pots_at_start[i] = pots[i];
+
+    scheduler_add_periodic(&core1_scheduler, &sensor_task, "sensor", sensor_task_run, NULL, SENSOR_WORKER_PERIOD_US,
+                           SENSOR_WORKER_PERIOD_US);
+    scheduler_add_periodic(&core1_scheduler, &pots_task, "pots", pots_task_run, NULL, SENSOR_WORKER_POT_PERIOD_US,
+                           SENSOR_WORKER_POT_PERIOD_US);
+    scheduler_run(&core1_scheduler);
+}
+
+// -----------------------------------------------------------------------------
+// Public API implementation
+// -----------------------------------------------------------------------------
+
+void sensor_worker_start(const sensor_worker_config_t *config)
+{
+    worker_config = *config;
+    // Registered from core 0 like every scheduler (see scheduler_init); core 1 adds its tasks
+    scheduler_init(&core1_scheduler, "core1", NULL);
+    multicore_launch_core1(sensor_worker_main);
+}
+
+void sensor_worker_get_pots(uint16_t pots[3])
+{
+    uint32_t seq;
+    do
+    {
+        seq = pots_seq;
+        __dmb();
+        for (int i = 0; i < 3; i++)
+            pots[i] = pots_shared[i];
+        __dmb();
+    } while ((seq & 1u) || seq != pots_seq);
+}
+
+uint32_t sensor_worker_sample_count(void)
+{
+    return samples_completed;
+}
@@ -0,0 +1,40 @@
+#ifndef SENSOR_WORKER_H
+#define SENSOR_WORKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "color_sensor.h"
+#include "sample_ring.h"
+
+// --- CONFIGURATION ---
+// Core 1 task rates: how late a finished acquisition (or a sensor phase change) is noticed,
+// and the pot -> LED latency
+#define SENSOR_WORKER_PERIOD_US 500
+#define SENSOR_WORKER_POT_PERIOD_US 2000
+
+typedef struct
+{
+    sample_ring_t *ring; // Finished acquisitions go here (core 1 produces, core 0 consumes)
+    tcs3200_mode_t measure_mode;
+    bool autorange;
+    bool acquire_clear;
+    uint32_t gate_ms; // Gate time per channel (gate-count mode without auto-ranging only)
+} sensor_worker_config_t;
+
+/**
+ * @brief Run pot sampling, the LEDs and color acquisition on core 1.
+ *
+ * The sensor is initialised on core 1 so its edge / counter interrupts are
+ * serviced there too. Samples reach core 0 through the SPSC sample ring; the
+ * live pot positions through a seqlock-protected snapshot.
+ * PotLED_Init must have been called already.
+ */
+void sensor_worker_start(const sensor_worker_config_t *config);
+
+// Latest pot positions (R, G, B), always a consistent triple
+void sensor_worker_get_pots(uint16_t pots[3]);
+
+// Acquisitions completed since start (for the sample rate)
+uint32_t sensor_worker_sample_count(void);
+
+#endif
@@ -0,0 +1,127 @@
+#include "sha1.h"
+#include <string.h>
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+static inline uint32_t rol32(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+static void sha1_block(sha1_ctx_t *ctx, const uint8_t *block)
+{
+    // 16-word rolling message schedule instead of the full 80 words (stack is small)
+    uint32_t w[16];
+    for (int i = 0; i < 16; i++)
+        w[i] = ((uint32_t)block[4 * i] << 24) | ((uint32_t)block[4 * i + 1] << 16) |
+               ((uint32_t)block[4 * i + 2] << 8) | (uint32_t)block[4 * i + 3];
+
+    uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3], e = ctx->state[4];
+
+    for (int i = 0; i < 80; i++)
+    {
+        if (i >= 16)
+            w[i & 15] = rol32(w[(i + 13) & 15] ^ w[(i + 8) & 15] ^ w[(i + 2) & 15] ^ w[i & 15], 1);
+
+        uint32_t f, k;
+        if (i < 20)
+        {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        }
+        else if (i < 40)
+        {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        }
+        else if (i < 60)
+        {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        }
+        else
+        {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+
+        uint32_t t = rol32(a, 5) + f + e + k + w[i & 15];
+        e = d;
+        d = c;
+        c = rol32(b, 30);
+        b = a;
+        a = t;
+    }
+
+    ctx->state[0] += a;
+    ctx->state[1] += b;
+    ctx->state[2] += c;
+    ctx->state[3] += d;
+    ctx->state[4] += e;
+}
+
+// -----------------------------------------------------------------------------
+// Public API implementation
+// -----------------------------------------------------------------------------
+
+void sha1_init(sha1_ctx_t *ctx)
+{
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xEFCDAB89;
+    ctx->state[2] = 0x98BADCFE;
+    ctx->state[3] = 0x10325476;
+    ctx->state[4] = 0xC3D2E1F0;
+    ctx->length = 0;
+    ctx->block_len = 0;
+}
+
+void sha1_update(sha1_ctx_t *ctx, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    ctx->length += len;
+
+    while (len > 0)
+    {
+        size_t take = 64u - ctx->block_len;
+        if (take > len)
+            take = len;
+        memcpy(ctx->block + ctx->block_len, p, take);
+        ctx->block_len += (uint8_t)take;
+        p += take;
+        len -= take;
+
+        if (ctx->block_len == 64)
+        {
+            sha1_block(ctx, ctx->block);
+            ctx->block_len = 0;
+        }
+    }
+}
+
+void sha1_final(sha1_ctx_t *ctx, uint8_t digest[SHA1_DIGEST_SIZE])
+{
+    const uint64_t bit_length = ctx->length * 8u;
+
+    // Padding: a single 1 bit, zeros up to 56 mod 64, then the 64-bit big-endian length
+    ctx->block[ctx->block_len++] = 0x80;
+    if (ctx->block_len > 56)
+    {
+        memset(ctx->block + ctx->block_len, 0, 64u - ctx->block_len);
+        sha1_block(ctx, ctx->block);
+        ctx->block_len = 0;
+    }
+    memset(ctx->block + ctx->block_len, 0, 56u - ctx->block_len);
+    for (int i = 0; i < 8; i++)
+        ctx->block[56 + i] = (uint8_t)(bit_length >> (56 - 8 * i));
+    sha1_block(ctx, ctx->block);
+
+    for (int i = 0; i < 5; i++)
+    {
+        digest[4 * i] = (uint8_t)(ctx->state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(ctx->state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(ctx->state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)ctx->state[i];
+    }
+}
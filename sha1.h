@@ -0,0 +1,27 @@
+#ifndef SHA1_H
+#define SHA1_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SHA1_DIGEST_SIZE 20
+
+/**
+ * @brief Streaming SHA-1 (FIPS 180-4).
+ *
+ * Only used for the WebSocket handshake, where RFC 6455 mandates it; it is not
+ * meant for anything security related.
+ */
+typedef struct
+{
+    uint32_t state[5];
+    uint64_t length; // Bytes hashed so far
+    uint8_t block[64];
+    uint8_t block_len;
+} sha1_ctx_t;
+
+void sha1_init(sha1_ctx_t *ctx);
+void sha1_update(sha1_ctx_t *ctx, const void *data, size_t len);
+void sha1_final(sha1_ctx_t *ctx, uint8_t digest[SHA1_DIGEST_SIZE]);
+
+#endif
@@ -0,0 +1,281 @@
+#include "target_set.h"
+#include <string.h>
+
+#define GRID_CELLS_PER_AXIS (1 << TARGET_SET_GRID_BITS)
+#define GRID_CELLS (GRID_CELLS_PER_AXIS * GRID_CELLS_PER_AXIS * GRID_CELLS_PER_AXIS)
+#define GRID_CELL_HZ ((TARGET_SET_GRID_MAX_HZ + GRID_CELLS_PER_AXIS - 1) / GRID_CELLS_PER_AXIS)
+
+static color_target_t targets[TARGET_SET_MAX];
+static uint16_t target_count = 0;
+
+// Grid buckets (counting-sort layout): targets of cell i are
+// grid_items[grid_start[i] .. grid_start[i + 1])
+static uint16_t grid_start[GRID_CELLS + 1];
+static uint16_t grid_items[TARGET_SET_MAX];
+static bool grid_dirty = true;
+// Largest channel of any target (Hz), bounds the ABSOLUTE score of far targets
+static uint32_t target_max_hz = 0;
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+static inline int grid_axis(uint32_t hz)
+{
+    uint32_t cell = hz / GRID_CELL_HZ;
+    if (cell >= GRID_CELLS_PER_AXIS)
+        cell = GRID_CELLS_PER_AXIS - 1;
+    return (int)cell;
+}
+
+static inline int grid_index(int x, int y, int z)
+{
+    return (x * GRID_CELLS_PER_AXIS + y) * GRID_CELLS_PER_AXIS + z;
+}
+
+static inline uint32_t abs_diff(uint32_t a, uint32_t b)
+{
+    return (a > b) ? (a - b) : (b - a);
+}
+
+static inline int target_cell(const color_target_t *t)
+{
+    return grid_index(grid_axis(t->r_hz), grid_axis(t->g_hz), grid_axis(t->b_hz));
+}
+
+static void grid_rebuild(void)
+{
+    // Next free slot per cell while scattering (static: too big for the 2 KB main stack)
+    static uint16_t grid_fill[GRID_CELLS];
+
+    memset(grid_start, 0, sizeof(grid_start));
+    target_max_hz = 0;
+
+    // 1. Count targets per cell
+    for (uint16_t i = 0; i < target_count; i++)
+    {
+        const color_target_t *t = &targets[i];
+        grid_start[target_cell(t) + 1]++;
+        if (t->r_hz > target_max_hz)
+            target_max_hz = t->r_hz;
+        if (t->g_hz > target_max_hz)
+            target_max_hz = t->g_hz;
+        if (t->b_hz > target_max_hz)
+            target_max_hz = t->b_hz;
+    }
+
+    // 2. Prefix sum into start offsets
+    for (int c = 0; c < GRID_CELLS; c++)
+        grid_start[c + 1] += grid_start[c];
+
+    // 3. Scatter
+    memcpy(grid_fill, grid_start, sizeof(grid_fill));
+    for (uint16_t i = 0; i < target_count; i++)
+        grid_items[grid_fill[target_cell(&targets[i])]++] = i;
+
+    grid_dirty = false;
+}
+
+// Nearest in L1 Hz, or (by_score) best correctness_compute() score with L1 breaking ties
+static void grid_scan_cell(int cell, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, bool by_score,
+                           target_match_t *best)
+{
+    for (uint16_t k = grid_start[cell]; k < grid_start[cell + 1]; k++)
+    {
+        const color_target_t *t = &targets[grid_items[k]];
+        const uint32_t d = abs_diff(r_hz, t->r_hz) + abs_diff(g_hz, t->g_hz) + abs_diff(b_hz, t->b_hz);
+        if (by_score)
+        {
+            const uint16_t score = correctness_compute(&t->absolute, r_hz, g_hz, b_hz);
+            if (score < best->score || (score == best->score && d >= best->distance))
+                continue;
+            best->score = score;
+        }
+        else if (d >= best->distance)
+            continue;
+        best->distance = d;
+        best->index = grid_items[k];
+    }
+}
+
+// Highest ABSOLUTE score a target at least l1_hz away from the reading can get.
+// Each channel's relative error is |x - t| / t >= |x - t| / target_max_hz, so the
+// average error is at least l1_hz / (3 * target_max_hz); one extra covers rounding.
+static uint32_t score_bound(uint32_t l1_hz)
+{
+    if (target_max_hz == 0)
+        return 1;
+    const uint64_t drop = (uint64_t)l1_hz * CORRECTNESS_MAX / (3ull * target_max_hz);
+    return (drop >= CORRECTNESS_MAX) ? 1u : (uint32_t)(CORRECTNESS_MAX - drop) + 1u;
+}
+
+static void grid_search(uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, bool by_score, target_match_t *best)
+{
+    if (grid_dirty)
+        grid_rebuild();
+
+    const int qx = grid_axis(r_hz);
+    const int qy = grid_axis(g_hz);
+    const int qz = grid_axis(b_hz);
+
+    best->index = 0;
+    best->distance = UINT32_MAX;
+    best->score = 0;
+
+    // Visit cells in shells of growing Chebyshev radius around the reading's cell.
+    // Any target in shell k + 1 is at least k cells away on one axis, so at least
+    // k * GRID_CELL_HZ away in L1: once the best match is closer than that (or
+    // scores at least what a target that far away could), we are done.
+    for (int k = 0; k < GRID_CELLS_PER_AXIS; k++)
+    {
+        for (int x = qx - k; x <= qx + k; x++)
+        {
+            if (x < 0 || x >= GRID_CELLS_PER_AXIS)
+                continue;
+            for (int y = qy - k; y <= qy + k; y++)
+            {
+                if (y < 0 || y >= GRID_CELLS_PER_AXIS)
+                    continue;
+
+                const bool xy_on_shell = (x == qx - k || x == qx + k || y == qy - k || y == qy + k);
+                // Interior (x, y) columns only contribute their two z end caps
+                const int z_step = xy_on_shell ? 1 : (2 * k > 0 ? 2 * k : 1);
+                for (int z = qz - k; z <= qz + k; z += z_step)
+                {
+                    if (z < 0 || z >= GRID_CELLS_PER_AXIS)
+                        continue;
+                    grid_scan_cell(grid_index(x, y, z), r_hz, g_hz, b_hz, by_score, best);
+                }
+            }
+        }
+
+        const uint32_t reach_hz = (uint32_t)k * GRID_CELL_HZ;
+        if (by_score ? best->score >= score_bound(reach_hz) : best->distance <= reach_hz)
+            break;
+    }
+}
+
+// Chromaticity: best chroma score, distance is the L1 of the Q14 ratios
+static void match_chroma(uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, uint32_t c_hz, target_match_t *best)
+{
+    const uint32_t cr = correctness_chroma(r_hz, c_hz);
+    const uint32_t cg = correctness_chroma(g_hz, c_hz);
+    const uint32_t cb = correctness_chroma(b_hz, c_hz);
+
+    for (uint16_t i = 0; i < target_count; i++)
+    {
+        const correctness_target_t *t = &targets[i].chroma;
+        const uint16_t score = correctness_compute(t, cr, cg, cb);
+        const uint32_t d = abs_diff(cr, t->r_hz) + abs_diff(cg, t->g_hz) + abs_diff(cb, t->b_hz);
+        if (i == 0 || score > best->score || (score == best->score && d < best->distance))
+        {
+            best->index = i;
+            best->score = score;
+            best->distance = d;
+        }
+    }
+}
+
+// CIELAB: smallest Delta-E (which is also the best score)
+static void match_lab(uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, target_match_t *best)
+{
+    color_lab_t reading;
+    color_lab_from_hz(r_hz, g_hz, b_hz, &reading);
+
+    for (uint16_t i = 0; i < target_count; i++)
+    {
+        const uint32_t d = color_lab_delta_e(&targets[i].lab, &reading);
+        if (i == 0 || d < best->distance)
+        {
+            best->index = i;
+            best->distance = d;
+        }
+    }
+    best->score = color_lab_score(best->distance);
+}
+
+// -----------------------------------------------------------------------------
+// Public API implementation
+// -----------------------------------------------------------------------------
+
+void target_set_clear(void)
+{
+    target_count = 0;
+    grid_dirty = true;
+}
+
+int target_set_add(const char *name, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, uint32_t c_hz)
+{
+    if (target_count >= TARGET_SET_MAX)
+        return -1;
+
+    color_target_t *t = &targets[target_count];
+    strncpy(t->name, name ? name : "", TARGET_NAME_LEN);
+    t->name[TARGET_NAME_LEN] = '\0';
+    t->r_hz = r_hz;
+    t->g_hz = g_hz;
+    t->b_hz = b_hz;
+    t->c_hz = c_hz;
+
+    // Precompute every scorer's view of the target once, not per sample
+    correctness_target_init(&t->absolute, r_hz, g_hz, b_hz);
+    correctness_chroma_target_init(&t->chroma, r_hz, g_hz, b_hz, c_hz);
+    color_lab_from_hz(r_hz, g_hz, b_hz, &t->lab);
+
+    grid_dirty = true;
+    return target_count++;
+}
+
+uint16_t target_set_count(void)
+{
+    return target_count;
+}
+
+const color_target_t *target_set_get(uint16_t index)
+{
+    if (index >= target_count)
+        return NULL;
+    return &targets[index];
+}
+
+bool target_set_match(uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, target_match_t *match)
+{
+    if (target_count == 0)
+        return false;
+
+    grid_search(r_hz, g_hz, b_hz, false, match);
+    match->score = correctness_compute(&targets[match->index].absolute, r_hz, g_hz, b_hz);
+    return true;
+}
+
+bool target_set_match_metric(target_metric_t metric, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, uint32_t c_hz,
+                             target_match_t *match)
+{
+    if (target_count == 0)
+        return false;
+
+    switch (metric)
+    {
+    case TARGET_METRIC_CHROMA:
+        if (c_hz == 0)
+        {
+            // No CLEAR reading: nothing to normalise by, and nothing to score
+            target_set_match(r_hz, g_hz, b_hz, match);
+            match->score = 0;
+            return true;
+        }
+        match_chroma(r_hz, g_hz, b_hz, c_hz, match);
+        return true;
+
+    case TARGET_METRIC_DELTA_E:
+        match_lab(r_hz, g_hz, b_hz, match);
+        return true;
+
+    case TARGET_METRIC_ABSOLUTE:
+    default:
+        // Relative error weighs a Hz of difference more on a dim target than on a
+        // bright one, so the best score is not always the L1-nearest target
+        grid_search(r_hz, g_hz, b_hz, true, match);
+        return true;
+    }
+}
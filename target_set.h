@@ -0,0 +1,84 @@
+#ifndef TARGET_SET_H
+#define TARGET_SET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "correctness.h"
+#include "color_lab.h"
+
+// --- CONFIGURATION ---
+// Maximum number of targets (levels / treasures) held at once
+#define TARGET_SET_MAX 256
+// Search grid: 2^BITS cells per axis covering 0..TARGET_SET_GRID_MAX_HZ
+// (readings and targets above the range fall into the last cell)
+#define TARGET_SET_GRID_BITS 3
+#define TARGET_SET_GRID_MAX_HZ 5000
+// Longest target name shown on the LCD / dashboard
+#define TARGET_NAME_LEN 12
+
+/**
+ * @brief One target color with everything each scorer needs precomputed.
+ */
+typedef struct
+{
+    char name[TARGET_NAME_LEN + 1];
+    uint32_t r_hz;
+    uint32_t g_hz;
+    uint32_t b_hz;
+    uint32_t c_hz;                 // CLEAR reading, 0 if not calibrated
+    correctness_target_t absolute; // For correctness_compute()
+    correctness_target_t chroma;   // For correctness_compute_chroma()
+    color_lab_t lab;               // For color_lab_correctness()
+} color_target_t;
+
+// Space a reading is matched and scored in (one per scorer)
+typedef enum
+{
+    TARGET_METRIC_ABSOLUTE, // Hz, correctness_compute()
+    TARGET_METRIC_CHROMA,   // Q14 channel / CLEAR ratios, correctness_compute_chroma()
+    TARGET_METRIC_DELTA_E   // CIELAB, color_lab_correctness()
+} target_metric_t;
+
+typedef struct
+{
+    uint16_t index;    // Index of the nearest target
+    uint32_t distance; // Distance in the metric's space: L1 Hz, L1 Q14 ratio, or Delta-E Q4
+    uint16_t score;    // Correctness against it in the same metric, tenths of a percent
+} target_match_t;
+
+// Remove every target
+void target_set_clear(void);
+
+// Add a target. Returns its index, or -1 if the set is full.
+int target_set_add(const char *name, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, uint32_t c_hz);
+
+uint16_t target_set_count(void);
+const color_target_t *target_set_get(uint16_t index);
+
+/**
+ * @brief Find the target nearest to a reading and score it.
+ *
+ * Targets are bucketed in a uniform 3D grid; the search visits cells in growing
+ * shells around the reading and stops as soon as no unvisited cell can be closer,
+ * so the cost depends on local density rather than on the total number of targets.
+ *
+ * @return false if the set is empty.
+ */
+bool target_set_match(uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, target_match_t *match);
+
+/**
+ * @brief Find the best-scoring target for a reading in the given metric.
+ *
+ * ABSOLUTE runs the target_set_match() grid search for the highest correctness_compute()
+ * score instead of the smallest Hz distance, pruned by the best score a target that far
+ * away could still get. CHROMA and DELTA_E convert the reading once and
+ * compare it with every target in that space (the Hz grid says nothing about
+ * distances there), so the cost grows with the number of targets. CHROMA picks the
+ * highest chroma score and falls back to the Hz match, scored 0, without a CLEAR reading.
+ *
+ * @return false if the set is empty.
+ */
+bool target_set_match_metric(target_metric_t metric, uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, uint32_t c_hz,
+                             target_match_t *match);
+
+#endif
@@ -0,0 +1,641 @@
+#include <stdlib.h>
+#include <string.h>
+#include "lwip_sim.h"
+#include "lwip/stats.h"
+#include "pico/cyw43_arch.h"
+
+#define SIM_TCP_PCBS 8
+#define SIM_SEND_QUEUE 64
+// Heap cost of one queued segment / PBUF_RAM buffer on top of its payload:
+// struct pbuf, TCP/IP/Ethernet header room and the heap block header
+#define SIM_PBUF_OVERHEAD 80
+
+typedef struct
+{
+    uint32_t len;
+    uint32_t heap; // Heap bytes released when the segment is acknowledged
+    uint16_t segments;
+} sim_write_t;
+
+struct tcp_pcb
+{
+    lwip_sim_state_t state;
+    void *arg;
+    tcp_accept_fn accept;
+    tcp_recv_fn recv;
+    tcp_sent_fn sent;
+    tcp_poll_fn poll;
+    tcp_err_fn err;
+
+    char *out;
+    uint32_t out_len;
+    uint32_t out_cap;
+
+    uint16_t sndbuf_limit;
+    uint32_t unacked;
+    sim_write_t queue[SIM_SEND_QUEUE]; // Unacknowledged writes, oldest first
+    int queue_head;
+    int queue_count;
+    uint32_t head_acked; // Bytes of the oldest write already acknowledged
+    uint32_t recved;
+};
+
+struct udp_pcb
+{
+    int unused;
+};
+
+// -----------------------------------------------------------------------------
+// Simulated state
+// -----------------------------------------------------------------------------
+
+static struct tcp_pcb listener;
+static struct tcp_pcb pcbs[SIM_TCP_PCBS];
+static struct udp_pcb udp;
+
+static uint32_t heap_size = MEM_SIZE;
+static uint32_t heap_used = 0;
+static int pbufs_live = 0;
+static int pbuf_alloc_failures = 0;
+static void (*udp_hook)(const uint8_t *data, uint16_t len, uint16_t port) = NULL;
+
+static struct stats_mem memp_stats[MEMP_MAX];
+struct stats_ lwip_stats = {
+    .mem = {.avail = MEM_SIZE},
+    .memp = {&memp_stats[0], &memp_stats[1], &memp_stats[2], &memp_stats[3], &memp_stats[4], &memp_stats[5]},
+};
+
+const ip_addr_t ip_addr_any = {0};
+cyw43_t cyw43_state;
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+static bool heap_take(uint32_t bytes)
+{
+    if (heap_used + bytes > heap_size)
+    {
+        lwip_stats.mem.err++;
+        return false;
+    }
+    heap_used += bytes;
+    lwip_stats.mem.used = (u16_t)heap_used;
+    if (heap_used > lwip_stats.mem.max)
+        lwip_stats.mem.max = (u16_t)heap_used;
+    return true;
+}
+
+static void heap_give(uint32_t bytes)
+{
+    heap_used -= bytes;
+    lwip_stats.mem.used = (u16_t)heap_used;
+}
+
+// Drop every unacknowledged write (connection gone)
+static void send_queue_release(struct tcp_pcb *pcb)
+{
+    while (pcb->queue_count)
+    {
+        heap_give(pcb->queue[pcb->queue_head].heap);
+        pcb->queue_head = (pcb->queue_head + 1) % SIM_SEND_QUEUE;
+        pcb->queue_count--;
+    }
+    pcb->unacked = 0;
+    pcb->head_acked = 0;
+}
+
+static void pcb_detach(struct tcp_pcb *pcb)
+{
+    pcb->arg = NULL;
+    pcb->recv = NULL;
+    pcb->sent = NULL;
+    pcb->poll = NULL;
+    pcb->err = NULL;
+}
+
+static void output_append(struct tcp_pcb *pcb, const void *data, uint32_t len)
+{
+    if (pcb->out_len + len + 1 > pcb->out_cap)
+    {
+        pcb->out_cap = 2 * (pcb->out_len + len + 1);
+        pcb->out = realloc(pcb->out, pcb->out_cap);
+    }
+    memcpy(pcb->out + pcb->out_len, data, len);
+    pcb->out_len += len;
+    pcb->out[pcb->out_len] = '\0';
+}
+
+static struct pbuf *pbuf_new(u16_t len, pbuf_type type, uint32_t heap)
+{
+    struct pbuf *p = malloc(sizeof(struct pbuf) + len);
+    p->next = NULL;
+    p->payload = p + 1;
+    p->tot_len = len;
+    p->len = len;
+    p->type_internal = (u8_t)type;
+    p->heap = (u16_t)heap;
+    pbufs_live++;
+    return p;
+}
+
+// -----------------------------------------------------------------------------
+// Test API
+// -----------------------------------------------------------------------------
+
+void lwip_sim_reset(void)
+{
+    for (int i = 0; i < SIM_TCP_PCBS; i++)
+    {
+        struct tcp_pcb *pcb = &pcbs[i];
+        if (pcb->state == LWIP_SIM_OPEN)
+        {
+            tcp_err_fn err = pcb->err;
+            void *arg = pcb->arg;
+            pcb->state = LWIP_SIM_RESET;
+            pcb_detach(pcb);
+            if (err)
+                err(arg, ERR_RST);
+        }
+        send_queue_release(pcb);
+        pcb->out_len = 0;
+    }
+    pbuf_alloc_failures = 0;
+    udp_hook = NULL;
+}
+
+struct tcp_pcb *lwip_sim_connect(void)
+{
+    struct tcp_pcb *pcb = NULL;
+    for (int i = 0; i < SIM_TCP_PCBS && !pcb; i++)
+    {
+        if (pcbs[i].state == LWIP_SIM_FREE)
+            pcb = &pcbs[i];
+    }
+    // Then the slot of the connection that ended longest ago
+    for (int i = 0; i < SIM_TCP_PCBS && !pcb; i++)
+    {
+        if (pcbs[i].state != LWIP_SIM_OPEN)
+            pcb = &pcbs[i];
+    }
+    if (!pcb || !listener.accept)
+        return NULL;
+
+    send_queue_release(pcb);
+    pcb_detach(pcb);
+    pcb->state = LWIP_SIM_OPEN;
+    pcb->out_len = 0;
+    pcb->sndbuf_limit = TCP_SND_BUF;
+    pcb->recved = 0;
+
+    err_t result = listener.accept(listener.arg, pcb, ERR_OK);
+    if (result != ERR_OK)
+    {
+        if (result != ERR_ABRT)
+            tcp_abort(pcb);
+        return NULL;
+    }
+    return pcb;
+}
+
+err_t lwip_sim_recv(struct tcp_pcb *pcb, const void *data, uint16_t len, uint16_t piece)
+{
+    if (pcb->state != LWIP_SIM_OPEN)
+        return ERR_CLSD;
+    if (piece == 0 || piece > len)
+        piece = len;
+
+    struct pbuf *head = NULL, **tail = &head;
+    for (uint16_t offset = 0; offset < len || !head; offset += piece)
+    {
+        const u16_t n = (len - offset < piece) ? (u16_t)(len - offset) : piece;
+        struct pbuf *p = pbuf_new(n, PBUF_POOL, 0);
+        memcpy(p->payload, (const char *)data + offset, n);
+        p->tot_len = (u16_t)(len - offset);
+        *tail = p;
+        tail = &p->next;
+        if (n == 0)
+            break;
+    }
+
+    if (!pcb->recv)
+    {
+        // tcp_recv_null
+        tcp_recved(pcb, len);
+        pbuf_free(head);
+        return ERR_OK;
+    }
+    return pcb->recv(pcb->arg, pcb, head, ERR_OK);
+}
+
+err_t lwip_sim_recv_str(struct tcp_pcb *pcb, const char *text, uint16_t piece)
+{
+    return lwip_sim_recv(pcb, text, (uint16_t)strlen(text), piece);
+}
+
+err_t lwip_sim_fin(struct tcp_pcb *pcb)
+{
+    if (pcb->state != LWIP_SIM_OPEN)
+        return ERR_CLSD;
+    if (!pcb->recv)
+        return tcp_close(pcb);
+    return pcb->recv(pcb->arg, pcb, NULL, ERR_OK);
+}
+
+uint32_t lwip_sim_ack(struct tcp_pcb *pcb, uint32_t len)
+{
+    const uint32_t acked = (len < pcb->unacked) ? len : pcb->unacked;
+    uint32_t left = acked;
+
+    while (left && pcb->queue_count)
+    {
+        sim_write_t *w = &pcb->queue[pcb->queue_head];
+        const uint32_t take = (w->len - pcb->head_acked < left) ? w->len - pcb->head_acked : left;
+        pcb->head_acked += take;
+        left -= take;
+        if (pcb->head_acked == w->len)
+        {
+            heap_give(w->heap);
+            pcb->queue_head = (pcb->queue_head + 1) % SIM_SEND_QUEUE;
+            pcb->queue_count--;
+            pcb->head_acked = 0;
+        }
+    }
+    pcb->unacked -= acked;
+
+    for (uint32_t done = 0; done < acked && pcb->state == LWIP_SIM_OPEN && pcb->sent;)
+    {
+        const u16_t n = (acked - done > 0xFFFF) ? 0xFFFF : (u16_t)(acked - done);
+        done += n;
+        if (pcb->sent(pcb->arg, pcb, n) == ERR_ABRT)
+            break;
+    }
+    return acked;
+}
+
+err_t lwip_sim_poll(struct tcp_pcb *pcb)
+{
+    if (pcb->state != LWIP_SIM_OPEN || !pcb->poll)
+        return ERR_OK;
+    return pcb->poll(pcb->arg, pcb);
+}
+
+lwip_sim_state_t lwip_sim_state(const struct tcp_pcb *pcb)
+{
+    return pcb->state;
+}
+
+const char *lwip_sim_output(const struct tcp_pcb *pcb, uint32_t *len)
+{
+    if (len)
+        *len = pcb->out_len;
+    return pcb->out_len ? pcb->out : "";
+}
+
+void lwip_sim_clear_output(struct tcp_pcb *pcb)
+{
+    pcb->out_len = 0;
+}
+
+uint32_t lwip_sim_unacked(const struct tcp_pcb *pcb)
+{
+    return pcb->unacked;
+}
+
+uint32_t lwip_sim_recved(const struct tcp_pcb *pcb)
+{
+    return pcb->recved;
+}
+
+void lwip_sim_set_sndbuf(struct tcp_pcb *pcb, uint16_t bytes)
+{
+    pcb->sndbuf_limit = bytes;
+}
+
+void lwip_sim_set_heap(uint32_t bytes)
+{
+    heap_size = bytes;
+    lwip_stats.mem.avail = (u16_t)bytes;
+}
+
+uint32_t lwip_sim_heap_used(void)
+{
+    return heap_used;
+}
+
+int lwip_sim_pbufs_live(void)
+{
+    return pbufs_live;
+}
+
+void lwip_sim_fail_pbuf_alloc(int count)
+{
+    pbuf_alloc_failures = count;
+}
+
+void lwip_sim_set_udp_hook(void (*hook)(const uint8_t *data, uint16_t len, uint16_t port))
+{
+    udp_hook = hook;
+}
+
+// -----------------------------------------------------------------------------
+// lwIP raw API
+// -----------------------------------------------------------------------------
+
+struct tcp_pcb *tcp_new(void)
+{
+    memset(&listener, 0, sizeof(listener));
+    return &listener;
+}
+
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
+{
+    (void)pcb;
+    (void)ipaddr;
+    (void)port;
+    return ERR_OK;
+}
+
+struct tcp_pcb *tcp_listen(struct tcp_pcb *pcb)
+{
+    return pcb;
+}
+
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept)
+{
+    pcb->accept = accept;
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg)
+{
+    pcb->arg = arg;
+}
+
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv)
+{
+    pcb->recv = recv;
+}
+
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent)
+{
+    pcb->sent = sent;
+}
+
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval)
+{
+    (void)interval;
+    pcb->poll = poll;
+}
+
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err)
+{
+    pcb->err = err;
+}
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags)
+{
+    if (pcb->state != LWIP_SIM_OPEN)
+        return ERR_CONN;
+    if (len == 0)
+        return ERR_OK;
+
+    const uint16_t segments = (uint16_t)((len + TCP_MSS - 1) / TCP_MSS);
+    if (len > tcp_sndbuf(pcb) || tcp_sndqueuelen(pcb) + segments > TCP_SND_QUEUELEN ||
+        pcb->queue_count == SIM_SEND_QUEUE)
+        return ERR_MEM;
+
+    const uint32_t heap = (apiflags & TCP_WRITE_FLAG_COPY) ? len + segments * SIM_PBUF_OVERHEAD : 0;
+    if (heap && !heap_take(heap))
+        return ERR_MEM;
+
+    sim_write_t *w = &pcb->queue[(pcb->queue_head + pcb->queue_count) % SIM_SEND_QUEUE];
+    w->len = len;
+    w->heap = heap;
+    w->segments = segments;
+    pcb->queue_count++;
+    pcb->unacked += len;
+    output_append(pcb, dataptr, len);
+    return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb *pcb)
+{
+    (void)pcb;
+    return ERR_OK;
+}
+
+void tcp_recved(struct tcp_pcb *pcb, u16_t len)
+{
+    pcb->recved += len;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb)
+{
+    pcb->state = LWIP_SIM_CLOSED; // Queued data is still delivered (and acknowledged)
+    pcb_detach(pcb);
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb)
+{
+    tcp_err_fn err = pcb->err;
+    void *arg = pcb->arg;
+
+    pcb->state = LWIP_SIM_ABORTED;
+    send_queue_release(pcb);
+    pcb_detach(pcb);
+    if (err)
+        err(arg, ERR_ABRT);
+}
+
+void tcp_nagle_disable(struct tcp_pcb *pcb)
+{
+    (void)pcb;
+}
+
+void tcp_setprio(struct tcp_pcb *pcb, u8_t prio)
+{
+    (void)pcb;
+    (void)prio;
+}
+
+u16_t tcp_sndbuf(const struct tcp_pcb *pcb)
+{
+    return (pcb->unacked < pcb->sndbuf_limit) ? (u16_t)(pcb->sndbuf_limit - pcb->unacked) : 0;
+}
+
+u16_t tcp_sndqueuelen(const struct tcp_pcb *pcb)
+{
+    u16_t segments = 0;
+    for (int i = 0; i < pcb->queue_count; i++)
+        segments += pcb->queue[(pcb->queue_head + i) % SIM_SEND_QUEUE].segments;
+    return segments;
+}
+
+struct pbuf *pbuf_alloc(pbuf_layer layer, u16_t length, pbuf_type type)
+{
+    (void)layer;
+    if (pbuf_alloc_failures > 0)
+    {
+        pbuf_alloc_failures--;
+        lwip_stats.mem.err++;
+        return NULL;
+    }
+
+    const uint32_t heap = (type == PBUF_RAM) ? length + SIM_PBUF_OVERHEAD : 0;
+    if (heap && !heap_take(heap))
+        return NULL;
+    return pbuf_new(length, type, heap);
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+    u8_t count = 0;
+    while (p)
+    {
+        struct pbuf *next = p->next;
+        heap_give(p->heap);
+        free(p);
+        pbufs_live--;
+        count++;
+        p = next;
+    }
+    return count;
+}
+
+void pbuf_cat(struct pbuf *head, struct pbuf *tail)
+{
+    struct pbuf *p = head;
+    for (; p->next; p = p->next)
+        p->tot_len += tail->tot_len;
+    p->tot_len += tail->tot_len;
+    p->next = tail;
+}
+
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size)
+{
+    while (q && size)
+    {
+        if (size >= q->len)
+        {
+            struct pbuf *next = q->next;
+            size -= q->len;
+            q->next = NULL;
+            pbuf_free(q);
+            q = next;
+        }
+        else
+        {
+            q->payload = (char *)q->payload + size;
+            q->len -= size;
+            q->tot_len -= size;
+            size = 0;
+        }
+    }
+    return q;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf *p, void *dataptr, u16_t len, u16_t offset)
+{
+    u16_t copied = 0;
+    for (; p && copied < len; p = p->next)
+    {
+        if (offset >= p->len)
+        {
+            offset -= p->len;
+            continue;
+        }
+        u16_t n = p->len - offset;
+        if (n > len - copied)
+            n = len - copied;
+        memcpy((char *)dataptr + copied, (const char *)p->payload + offset, n);
+        copied += n;
+        offset = 0;
+    }
+    return copied;
+}
+
+err_t pbuf_take(struct pbuf *buf, const void *dataptr, u16_t len)
+{
+    if (!buf || buf->tot_len < len)
+        return ERR_ARG;
+    for (u16_t done = 0; done < len; buf = buf->next)
+    {
+        const u16_t n = (len - done < buf->len) ? (u16_t)(len - done) : buf->len;
+        memcpy(buf->payload, (const char *)dataptr + done, n);
+        done += n;
+    }
+    return ERR_OK;
+}
+
+u8_t pbuf_get_at(const struct pbuf *p, u16_t offset)
+{
+    for (; p; p = p->next)
+    {
+        if (offset < p->len)
+            return ((const u8_t *)p->payload)[offset];
+        offset -= p->len;
+    }
+    return 0;
+}
+
+struct udp_pcb *udp_new(void)
+{
+    return &udp;
+}
+
+err_t udp_sendto_if(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port,
+                    struct netif *netif)
+{
+    (void)pcb;
+    (void)dst_ip;
+    (void)netif;
+    uint8_t datagram[1500];
+    const u16_t len = pbuf_copy_partial(p, datagram, sizeof(datagram), 0);
+    if (udp_hook)
+        udp_hook(datagram, len, dst_port);
+    return ERR_OK;
+}
+
+void netif_set_ipaddr(struct netif *netif, const ip4_addr_t *ipaddr)
+{
+    netif->ip_addr = *ipaddr;
+}
+
+void netif_set_netmask(struct netif *netif, const ip4_addr_t *netmask)
+{
+    netif->netmask = *netmask;
+}
+
+void netif_set_up(struct netif *netif)
+{
+    netif->up = 1;
+}
+
+// -----------------------------------------------------------------------------
+// cyw43 driver (lwIP runs in the test's thread, so the lock is a no-op)
+// -----------------------------------------------------------------------------
+
+int cyw43_arch_init(void)
+{
+    return 0;
+}
+
+void cyw43_arch_enable_ap_mode(const char *ssid, const char *password, uint32_t auth)
+{
+    (void)ssid;
+    (void)password;
+    (void)auth;
+}
+
+void cyw43_arch_poll(void)
+{
+}
+
+void cyw43_arch_lwip_begin(void)
+{
+}
+
+void cyw43_arch_lwip_end(void)
+{
+}
@@ -0,0 +1,67 @@
+#ifndef LWIP_SIM_H
+#define LWIP_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+
+// -----------------------------------------------------------------------------
+// Simulated lwIP (raw API) for host tests
+// -----------------------------------------------------------------------------
+// The test plays the network: it opens client connections, delivers request bytes
+// in pbuf chains cut into arbitrary pieces, acknowledges sent data and fires the
+// poll timer. Everything the server writes is captured per connection.
+//
+// tcp_write with TCP_WRITE_FLAG_COPY and PBUF_RAM allocations draw from one shared
+// heap of MEM_SIZE bytes (lwipopts.h) until acknowledged / freed, as on the Pico,
+// so two connections can starve each other the way they do on the device.
+
+typedef enum
+{
+    LWIP_SIM_FREE,    // Slot not in use
+    LWIP_SIM_OPEN,
+    LWIP_SIM_CLOSED,  // Server called tcp_close
+    LWIP_SIM_ABORTED, // Server called tcp_abort (or evicted the connection)
+    LWIP_SIM_RESET,   // Dropped by the network (lwip_sim_reset)
+} lwip_sim_state_t;
+
+// Every open connection fails with ERR_RST (through its err callback), the heap and
+// the captured datagrams are cleared. The listener and its accept callback are kept.
+void lwip_sim_reset(void);
+
+// A client connects. Returns NULL if the server refused it.
+struct tcp_pcb *lwip_sim_connect(void);
+
+// Deliver `len` bytes as one pbuf chain of `piece`-byte pbufs (0: a single pbuf)
+err_t lwip_sim_recv(struct tcp_pcb *pcb, const void *data, uint16_t len, uint16_t piece);
+err_t lwip_sim_recv_str(struct tcp_pcb *pcb, const char *text, uint16_t piece);
+// The client closes its side
+err_t lwip_sim_fin(struct tcp_pcb *pcb);
+// Acknowledge up to `len` unacknowledged bytes and call the sent callback. Returns the bytes acknowledged.
+uint32_t lwip_sim_ack(struct tcp_pcb *pcb, uint32_t len);
+// One tcp_poll interval
+err_t lwip_sim_poll(struct tcp_pcb *pcb);
+
+lwip_sim_state_t lwip_sim_state(const struct tcp_pcb *pcb);
+// Everything written so far (NUL-terminated), and forgetting it
+const char *lwip_sim_output(const struct tcp_pcb *pcb, uint32_t *len);
+void lwip_sim_clear_output(struct tcp_pcb *pcb);
+// Bytes written but not acknowledged yet, and bytes the server has tcp_recved
+uint32_t lwip_sim_unacked(const struct tcp_pcb *pcb);
+uint32_t lwip_sim_recved(const struct tcp_pcb *pcb);
+// Limit the send buffer of one connection (defaults to TCP_SND_BUF)
+void lwip_sim_set_sndbuf(struct tcp_pcb *pcb, uint16_t bytes);
+
+// Shared heap: its size (defaults to MEM_SIZE) and what is in use right now
+void lwip_sim_set_heap(uint32_t bytes);
+uint32_t lwip_sim_heap_used(void);
+// pbufs allocated and not freed yet (received chains included)
+int lwip_sim_pbufs_live(void);
+// Make the next `count` pbuf_alloc calls fail
+void lwip_sim_fail_pbuf_alloc(int count);
+
+// Every UDP datagram sent is passed to the hook (payload, length, destination port)
+void lwip_sim_set_udp_hook(void (*hook)(const uint8_t *data, uint16_t len, uint16_t port));
+
+#endif
@@ -0,0 +1,609 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico_sim.h"
+#include "hardware/pwm.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+
+#define SIM_GPIO_COUNT 30
+#define SIM_PWM_SLICES 8
+#define SIM_IRQ_COUNT 32
+#define SIM_IRQ_HANDLERS 4
+#define SIM_SPIN_LOCKS 32
+#define SIM_NEVER UINT64_MAX
+
+// -----------------------------------------------------------------------------
+// Simulated state
+// -----------------------------------------------------------------------------
+
+static uint64_t now_ns = 0;
+static uint32_t spin_cost_ns = 1000;
+static uint64_t spin_total_ns = 0;
+static uint32_t irq_latency_ns = 0;
+
+static bool gpio_out[SIM_GPIO_COUNT];
+static uint32_t gpio_irq_events[SIM_GPIO_COUNT];
+static gpio_irq_callback_t gpio_callback = NULL;
+static void (*gpio_put_hook)(uint gpio, bool value) = NULL;
+
+static bool irq_enabled[SIM_IRQ_COUNT];
+static irq_handler_t irq_handlers[SIM_IRQ_COUNT][SIM_IRQ_HANDLERS];
+
+static spin_lock_t spin_locks[SIM_SPIN_LOCKS];
+static int spin_locks_claimed = 0;
+
+// Square wave source
+static int signal_gpio = -1;
+static double signal_hz = 0.0;
+static uint64_t signal_base_ns = 0;
+static double signal_base_cycles = 0.5; // Starts mid-period, low
+
+// PWM slices (only edge counting on channel B is modelled)
+typedef struct
+{
+    bool running;
+    pwm_config config;
+    uint64_t start_edges;
+    uint64_t wraps_flagged;
+} sim_slice_t;
+static sim_slice_t slices[SIM_PWM_SLICES];
+static uint32_t pwm_irq_enable_mask = 0;
+static uint32_t pwm_irq_status = 0;
+
+static repeating_timer_t *timers = NULL;
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+static double signal_cycles(uint64_t t_ns)
+{
+    return signal_base_cycles + (double)(t_ns - signal_base_ns) * signal_hz / 1e9;
+}
+
+static uint64_t signal_edges_at(uint64_t t_ns)
+{
+    if (signal_gpio < 0)
+        return 0;
+    return (uint64_t)floor(signal_cycles(t_ns));
+}
+
+// Time of rising edge number `edge` (edges are counted from the attach time)
+static uint64_t signal_edge_time(uint64_t edge)
+{
+    if (signal_gpio < 0 || signal_hz <= 0.0)
+        return SIM_NEVER;
+    uint64_t t = (uint64_t)ceil((double)signal_base_ns + ((double)edge - signal_base_cycles) * 1e9 / signal_hz);
+    while (signal_cycles(t) < (double)edge)
+        t++; // Rounding: the edge must have happened at the returned time
+    return t;
+}
+
+static uint64_t signal_next_edge_time(uint64_t after_ns)
+{
+    return signal_edge_time(signal_edges_at(after_ns) + 1u);
+}
+
+static sim_slice_t *counting_slice(void)
+{
+    if (signal_gpio < 0 || pwm_gpio_to_channel((uint)signal_gpio) != 1u)
+        return NULL;
+    sim_slice_t *s = &slices[pwm_gpio_to_slice_num((uint)signal_gpio)];
+    if (!s->running || s->config.mode != PWM_DIV_B_RISING)
+        return NULL;
+    return s;
+}
+
+static uint64_t slice_period(const sim_slice_t *s)
+{
+    return (uint64_t)s->config.wrap + 1u;
+}
+
+static void run_irq(uint num)
+{
+    if (num >= SIM_IRQ_COUNT || !irq_enabled[num])
+        return;
+    for (int i = 0; i < SIM_IRQ_HANDLERS; i++)
+    {
+        if (irq_handlers[num][i])
+            irq_handlers[num][i]();
+    }
+}
+
+// Next time something asynchronous happens, and what it is
+typedef enum
+{
+    SIM_EVENT_NONE,
+    SIM_EVENT_EDGE_IRQ,
+    SIM_EVENT_PWM_WRAP,
+    SIM_EVENT_TIMER
+} sim_event_t;
+
+static sim_event_t next_event(uint64_t *at_ns, repeating_timer_t **timer)
+{
+    sim_event_t event = SIM_EVENT_NONE;
+    uint64_t best = SIM_NEVER;
+
+    if (signal_gpio >= 0 && (gpio_irq_events[signal_gpio] & GPIO_IRQ_EDGE_RISE) && gpio_callback &&
+        irq_enabled[IO_IRQ_BANK0])
+    {
+        const uint64_t t = signal_next_edge_time(now_ns);
+        if (t != SIM_NEVER && t + irq_latency_ns < best)
+        {
+            best = t + irq_latency_ns;
+            event = SIM_EVENT_EDGE_IRQ;
+        }
+    }
+
+    const sim_slice_t *s = counting_slice();
+    if (s)
+    {
+        const uint64_t wrap_edge = s->start_edges + (s->wraps_flagged + 1u) * slice_period(s);
+        const uint64_t t = signal_edge_time(wrap_edge);
+        if (t < best)
+        {
+            best = t;
+            event = SIM_EVENT_PWM_WRAP;
+        }
+    }
+
+    for (repeating_timer_t *rt = timers; rt; rt = rt->next)
+    {
+        if (rt->active && rt->next_ns < best)
+        {
+            best = rt->next_ns;
+            event = SIM_EVENT_TIMER;
+            *timer = rt;
+        }
+    }
+
+    *at_ns = best;
+    return event;
+}
+
+static void timer_remove(repeating_timer_t *timer)
+{
+    for (repeating_timer_t **p = &timers; *p; p = &(*p)->next)
+    {
+        if (*p == timer)
+        {
+            *p = timer->next;
+            break;
+        }
+    }
+    timer->active = false;
+    timer->next = NULL;
+}
+
+// -----------------------------------------------------------------------------
+// Simulation control
+// -----------------------------------------------------------------------------
+
+void sim_reset(void)
+{
+    now_ns = 0;
+    spin_total_ns = 0;
+    memset(gpio_out, 0, sizeof(gpio_out));
+    memset(gpio_irq_events, 0, sizeof(gpio_irq_events));
+    gpio_put_hook = NULL;
+    signal_gpio = -1;
+    signal_hz = 0.0;
+    signal_base_ns = 0;
+    signal_base_cycles = 0.5;
+    memset(slices, 0, sizeof(slices));
+    pwm_irq_enable_mask = 0;
+    pwm_irq_status = 0;
+    while (timers)
+        timer_remove(timers);
+}
+
+uint64_t sim_now_ns(void)
+{
+    return now_ns;
+}
+
+void sim_advance_ns(uint64_t ns)
+{
+    const uint64_t target = now_ns + ns;
+
+    while (now_ns < target)
+    {
+        uint64_t at_ns;
+        repeating_timer_t *timer = NULL;
+        const sim_event_t event = next_event(&at_ns, &timer);
+
+        if (event == SIM_EVENT_NONE || at_ns > target)
+        {
+            now_ns = target;
+            break;
+        }
+        if (at_ns > now_ns)
+            now_ns = at_ns;
+
+        switch (event)
+        {
+        case SIM_EVENT_EDGE_IRQ:
+            gpio_callback((uint)signal_gpio, GPIO_IRQ_EDGE_RISE);
+            break;
+
+        case SIM_EVENT_PWM_WRAP:
+        {
+            sim_slice_t *s = counting_slice();
+            const uint slice = (uint)(s - slices);
+            s->wraps_flagged++;
+            pwm_irq_status |= 1u << slice;
+            if (pwm_irq_enable_mask & (1u << slice))
+                run_irq(PWM_IRQ_WRAP);
+            break;
+        }
+
+        case SIM_EVENT_TIMER:
+        {
+            const uint64_t scheduled = timer->next_ns;
+            if (!timer->callback(timer))
+            {
+                timer_remove(timer);
+                break;
+            }
+            if (!timer->active)
+                break; // Cancelled from its own callback
+            // Negative delay: fixed rate from the scheduled time, positive: from callback return
+            if (timer->delay_us < 0)
+                timer->next_ns = scheduled + (uint64_t)(-timer->delay_us) * 1000u;
+            else
+                timer->next_ns = now_ns + (uint64_t)timer->delay_us * 1000u;
+            break;
+        }
+
+        case SIM_EVENT_NONE:
+        default:
+            break;
+        }
+    }
+}
+
+void sim_set_spin_cost_ns(uint32_t ns)
+{
+    spin_cost_ns = ns;
+}
+
+uint64_t sim_spin_ns(void)
+{
+    return spin_total_ns;
+}
+
+void sim_set_irq_latency_ns(uint32_t ns)
+{
+    irq_latency_ns = ns;
+}
+
+bool sim_gpio_output(uint gpio)
+{
+    return gpio < SIM_GPIO_COUNT && gpio_out[gpio];
+}
+
+void sim_set_gpio_put_hook(void (*hook)(uint gpio, bool value))
+{
+    gpio_put_hook = hook;
+}
+
+void sim_signal_attach(uint gpio)
+{
+    signal_gpio = (int)gpio;
+    signal_hz = 0.0;
+    signal_base_ns = now_ns;
+    signal_base_cycles = 0.5;
+}
+
+void sim_signal_set_hz(double hz)
+{
+    signal_base_cycles = signal_cycles(now_ns);
+    signal_base_ns = now_ns;
+    signal_hz = hz;
+}
+
+uint64_t sim_signal_edges(void)
+{
+    return signal_edges_at(now_ns);
+}
+
+// -----------------------------------------------------------------------------
+// SDK: GPIO
+// -----------------------------------------------------------------------------
+
+void gpio_init(uint gpio)
+{
+    if (gpio < SIM_GPIO_COUNT)
+        gpio_out[gpio] = false;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    (void)gpio;
+    (void)out;
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    if (gpio < SIM_GPIO_COUNT)
+        gpio_out[gpio] = value;
+    if (gpio_put_hook)
+        gpio_put_hook(gpio, value);
+}
+
+bool gpio_get(uint gpio)
+{
+    if ((int)gpio == signal_gpio)
+    {
+        const double c = signal_cycles(now_ns);
+        return (c - floor(c)) < 0.5;
+    }
+    return sim_gpio_output(gpio);
+}
+
+void gpio_pull_up(uint gpio)
+{
+    (void)gpio;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled)
+{
+    if (gpio >= SIM_GPIO_COUNT)
+        return;
+    if (enabled)
+        gpio_irq_events[gpio] |= events;
+    else
+        gpio_irq_events[gpio] &= ~events;
+}
+
+void gpio_set_irq_callback(gpio_irq_callback_t callback)
+{
+    gpio_callback = callback;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback)
+{
+    gpio_set_irq_callback(callback);
+    gpio_set_irq_enabled(gpio, events, enabled);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+
+// -----------------------------------------------------------------------------
+// SDK: IRQ and PWM
+// -----------------------------------------------------------------------------
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority)
+{
+    (void)order_priority;
+    if (num >= SIM_IRQ_COUNT)
+        return;
+    for (int i = 0; i < SIM_IRQ_HANDLERS; i++)
+    {
+        if (!irq_handlers[num][i] || irq_handlers[num][i] == handler)
+        {
+            irq_handlers[num][i] = handler;
+            return;
+        }
+    }
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    if (num < SIM_IRQ_COUNT)
+        irq_enabled[num] = enabled;
+}
+
+pwm_config pwm_get_default_config(void)
+{
+    pwm_config c = {PWM_DIV_FREE_RUNNING, 1.0f, 0xFFFF};
+    return c;
+}
+
+void pwm_config_set_clkdiv_mode(pwm_config *c, enum pwm_clkdiv_mode mode)
+{
+    c->mode = mode;
+}
+
+void pwm_config_set_clkdiv(pwm_config *c, float div)
+{
+    c->clkdiv = div;
+}
+
+void pwm_config_set_wrap(pwm_config *c, uint16_t wrap)
+{
+    c->wrap = wrap;
+}
+
+void pwm_init(uint slice_num, pwm_config *c, bool start)
+{
+    sim_slice_t *s = &slices[slice_num & 7u];
+    s->config = *c;
+    s->start_edges = signal_edges_at(now_ns);
+    s->wraps_flagged = 0;
+    s->running = start;
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled)
+{
+    slices[slice_num & 7u].running = enabled;
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level)
+{
+    (void)gpio;
+    (void)level;
+}
+
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level)
+{
+    (void)slice_num;
+    (void)chan;
+    (void)level;
+}
+
+uint16_t pwm_get_counter(uint slice_num)
+{
+    const sim_slice_t *s = &slices[slice_num & 7u];
+    if (s != counting_slice())
+        return 0;
+    return (uint16_t)((signal_edges_at(now_ns) - s->start_edges) % slice_period(s));
+}
+
+void pwm_clear_irq(uint slice_num)
+{
+    pwm_irq_status &= ~(1u << slice_num);
+}
+
+void pwm_set_irq_enabled(uint slice_num, bool enabled)
+{
+    if (enabled)
+        pwm_irq_enable_mask |= 1u << slice_num;
+    else
+        pwm_irq_enable_mask &= ~(1u << slice_num);
+}
+
+uint32_t pwm_get_irq_status_mask(void)
+{
+    return pwm_irq_status;
+}
+
+// -----------------------------------------------------------------------------
+// SDK: time, timers and CPU
+// -----------------------------------------------------------------------------
+
+uint32_t time_us_32(void)
+{
+    return (uint32_t)(now_ns / 1000u);
+}
+
+uint64_t time_us_64(void)
+{
+    return now_ns / 1000u;
+}
+
+absolute_time_t get_absolute_time(void)
+{
+    return now_ns / 1000u;
+}
+
+uint32_t to_ms_since_boot(absolute_time_t t)
+{
+    return (uint32_t)(t / 1000u);
+}
+
+uint64_t to_us_since_boot(absolute_time_t t)
+{
+    return t;
+}
+
+void sleep_us(uint64_t us)
+{
+    sim_advance_ns(us * 1000u);
+}
+
+void sleep_ms(uint32_t ms)
+{
+    sim_advance_ns((uint64_t)ms * 1000000u);
+}
+
+void tight_loop_contents(void)
+{
+    spin_total_ns += spin_cost_ns;
+    sim_advance_ns(spin_cost_ns);
+}
+
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data,
+                            repeating_timer_t *out)
+{
+    const uint64_t period_ns = (uint64_t)(delay_us < 0 ? -delay_us : delay_us) * 1000u;
+    if (out->active)
+        timer_remove(out);
+    out->delay_us = delay_us;
+    out->next_ns = now_ns + period_ns;
+    out->callback = callback;
+    out->user_data = user_data;
+    out->active = true;
+    out->next = timers;
+    timers = out;
+    return true;
+}
+
+bool cancel_repeating_timer(repeating_timer_t *timer)
+{
+    if (!timer->active)
+        return false;
+    timer_remove(timer);
+    return true;
+}
+
+uint32_t save_and_disable_interrupts(void)
+{
+    return 0;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    (void)status;
+}
+
+void __dmb(void)
+{
+    // Real fence: the SPSC ring and seqlock tests run producer and consumer on host threads
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// Real locks as well: a test may run each "core" on its own host thread
+int spin_lock_claim_unused(bool required)
+{
+    if (spin_locks_claimed < SIM_SPIN_LOCKS)
+        return spin_locks_claimed++;
+    if (required)
+        abort();
+    return -1;
+}
+
+spin_lock_t *spin_lock_init(uint lock_num)
+{
+    spin_locks[lock_num] = 0;
+    return &spin_locks[lock_num];
+}
+
+uint32_t spin_lock_blocking(spin_lock_t *lock)
+{
+    const uint32_t saved_irq = save_and_disable_interrupts();
+    while (__atomic_exchange_n(lock, 1u, __ATOMIC_ACQUIRE))
+        ;
+    return saved_irq;
+}
+
+void spin_unlock(spin_lock_t *lock, uint32_t saved_irq)
+{
+    __atomic_store_n(lock, 0u, __ATOMIC_RELEASE);
+    restore_interrupts(saved_irq);
+}
+
+void __wfe(void)
+{
+}
+
+void __sev(void)
+{
+}
+
+bool stdio_init_all(void)
+{
+    return true;
+}
+
+int getchar_timeout_us(uint32_t timeout_us)
+{
+    sim_advance_ns((uint64_t)timeout_us * 1000u);
+    return PICO_ERROR_TIMEOUT;
+}
@@ -0,0 +1,38 @@
+#ifndef PICO_SIM_H
+#define PICO_SIM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+
+// -----------------------------------------------------------------------------
+// Virtual Pico for host tests
+// -----------------------------------------------------------------------------
+// Time only moves when the code under test sleeps, spins in tight_loop_contents()
+// or when a test calls sim_advance_ns(). Edge interrupts, PWM wraps and repeating
+// timers fire in time order while the clock is advanced, so runs are deterministic.
+
+// Back to t = 0 with all pins low, no signal and no timers (IRQ handlers are kept)
+void sim_reset(void);
+
+uint64_t sim_now_ns(void);
+void sim_advance_ns(uint64_t ns);
+
+// Time charged for each tight_loop_contents() call, and the total spent spinning
+void sim_set_spin_cost_ns(uint32_t ns);
+uint64_t sim_spin_ns(void);
+
+// Delay between an edge and the start of its GPIO interrupt handler
+void sim_set_irq_latency_ns(uint32_t ns);
+
+// Level last written with gpio_put(), and the hook called on every write
+bool sim_gpio_output(uint gpio);
+void sim_set_gpio_put_hook(void (*hook)(uint gpio, bool value));
+
+// Square wave on `gpio`: its rising edges drive gpio_get(), the GPIO edge IRQ and a
+// PWM slice in PWM_DIV_B_RISING mode. Changing the frequency keeps the phase continuous.
+void sim_signal_attach(uint gpio);
+void sim_signal_set_hz(double hz);
+uint64_t sim_signal_edges(void); // Rising edges so far
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <stdio.h>
+
+// Minimal check macros for the host tests: a failed check is reported and counted,
+// the test keeps going, and main() returns TEST_RESULT() to ctest.
+
+static int test_failures = 0;
+
+#define TEST_CHECK(cond)                                                             \
+    do                                                                               \
+    {                                                                                \
+        if (!(cond))                                                                 \
+        {                                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++;                                                         \
+        }                                                                            \
+    } while (0)
+
+#define TEST_CHECK_MSG(cond, ...)                                                    \
+    do                                                                               \
+    {                                                                                \
+        if (!(cond))                                                                 \
+        {                                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s: ", __FILE__, __LINE__, #cond); \
+            fprintf(stderr, __VA_ARGS__);                                            \
+            fprintf(stderr, "\n");                                                   \
+            test_failures++;                                                         \
+        }                                                                            \
+    } while (0)
+
+#define TEST_RESULT() (test_failures ? 1 : 0)
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HOST_HARDWARE_GPIO_H
+#define HOST_HARDWARE_GPIO_H
+
+// The GPIO API is declared with the rest of the simulated SDK in pico/stdlib.h
+#include "pico/stdlib.h"
+
+#endif
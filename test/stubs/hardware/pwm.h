@@ -0,0 +1,45 @@
+#ifndef HOST_HARDWARE_PWM_H
+#define HOST_HARDWARE_PWM_H
+
+#include "pico/stdlib.h"
+#include "hardware/irq.h"
+
+enum pwm_clkdiv_mode
+{
+    PWM_DIV_FREE_RUNNING,
+    PWM_DIV_B_HIGH,
+    PWM_DIV_B_RISING,
+    PWM_DIV_B_FALLING
+};
+
+typedef struct
+{
+    enum pwm_clkdiv_mode mode;
+    float clkdiv;
+    uint16_t wrap;
+} pwm_config;
+
+static inline uint pwm_gpio_to_slice_num(uint gpio)
+{
+    return (gpio >> 1u) & 7u;
+}
+
+static inline uint pwm_gpio_to_channel(uint gpio)
+{
+    return gpio & 1u;
+}
+
+pwm_config pwm_get_default_config(void);
+void pwm_config_set_clkdiv_mode(pwm_config *c, enum pwm_clkdiv_mode mode);
+void pwm_config_set_clkdiv(pwm_config *c, float div);
+void pwm_config_set_wrap(pwm_config *c, uint16_t wrap);
+void pwm_init(uint slice_num, pwm_config *c, bool start);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
+void pwm_set_chan_level(uint slice_num, uint chan, uint16_t level);
+void pwm_set_enabled(uint slice_num, bool enabled);
+uint16_t pwm_get_counter(uint slice_num);
+void pwm_clear_irq(uint slice_num);
+void pwm_set_irq_enabled(uint slice_num, bool enabled);
+uint32_t pwm_get_irq_status_mask(void);
+
+#endif
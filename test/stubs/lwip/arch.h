@@ -0,0 +1,17 @@
+#ifndef HOST_LWIP_ARCH_H
+#define HOST_LWIP_ARCH_H
+
+// Host stand-in for the lwIP headers used by the firmware (raw TCP/UDP API only).
+// test/host/lwip_sim.c implements them as a scripted peer; see lwip_sim.h.
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint8_t u8_t;
+typedef int8_t s8_t;
+typedef uint16_t u16_t;
+typedef int16_t s16_t;
+typedef uint32_t u32_t;
+typedef int32_t s32_t;
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef HOST_LWIP_IP_ADDR_H
+#define HOST_LWIP_IP_ADDR_H
+
+#include "lwip/arch.h"
+
+typedef struct
+{
+    u32_t addr; // Network byte order
+} ip4_addr_t;
+typedef ip4_addr_t ip_addr_t;
+
+#define IP4_ADDR(ipaddr, a, b, c, d) \
+    ((ipaddr)->addr = (u32_t)(a) | ((u32_t)(b) << 8) | ((u32_t)(c) << 16) | ((u32_t)(d) << 24))
+#define ip_2_ip4(ipaddr) (ipaddr)
+#define ip4_addr_get_u32(ipaddr) ((ipaddr)->addr)
+
+extern const ip_addr_t ip_addr_any;
+#define IP_ADDR_ANY (&ip_addr_any)
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_LWIP_NETIF_H
+#define HOST_LWIP_NETIF_H
+
+#include "lwip/ip_addr.h"
+
+struct netif
+{
+    ip4_addr_t ip_addr;
+    ip4_addr_t netmask;
+    u8_t up;
+};
+
+void netif_set_ipaddr(struct netif *netif, const ip4_addr_t *ipaddr);
+void netif_set_netmask(struct netif *netif, const ip4_addr_t *netmask);
+void netif_set_up(struct netif *netif);
+
+#endif
@@ -0,0 +1,14 @@
+#ifndef HOST_LWIP_OPT_H
+#define HOST_LWIP_OPT_H
+
+// The firmware's own settings, plus the lwIP defaults it relies on
+#include "lwipopts.h"
+
+#ifndef TCP_SND_QUEUELEN
+#define TCP_SND_QUEUELEN ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS))
+#endif
+#ifndef IP_SOF_BROADCAST
+#define IP_SOF_BROADCAST 0
+#endif
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef HOST_LWIP_STATS_H
+#define HOST_LWIP_STATS_H
+
+#include "lwip/arch.h"
+#include "lwip/opt.h"
+#include "lwip/memp.h"
+
+struct stats_mem
+{
+    u16_t err;
+    u16_t avail;
+    u16_t used;
+    u16_t max;
+    u16_t illegal;
+};
+
+struct stats_
+{
+    struct stats_mem mem;
+    struct stats_mem *memp[MEMP_MAX];
+};
+
+extern struct stats_ lwip_stats;
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef HOST_LWIP_UDP_H
+#define HOST_LWIP_UDP_H
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+
+struct udp_pcb;
+
+struct udp_pcb *udp_new(void);
+err_t udp_sendto_if(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *dst_ip, u16_t dst_port,
+                    struct netif *netif);
+
+#endif
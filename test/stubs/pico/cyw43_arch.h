@@ -0,0 +1,23 @@
+#ifndef HOST_PICO_CYW43_ARCH_H
+#define HOST_PICO_CYW43_ARCH_H
+
+#include "pico/stdlib.h"
+#include "lwip/netif.h"
+
+#define CYW43_ITF_STA 0
+#define CYW43_ITF_AP 1
+#define CYW43_AUTH_WPA2_AES_PSK 0x00400004
+
+typedef struct
+{
+    struct netif netif[2];
+} cyw43_t;
+extern cyw43_t cyw43_state;
+
+int cyw43_arch_init(void);
+void cyw43_arch_enable_ap_mode(const char *ssid, const char *password, uint32_t auth);
+void cyw43_arch_poll(void);
+void cyw43_arch_lwip_begin(void);
+void cyw43_arch_lwip_end(void);
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+// Host stand-in for the Pico SDK headers used by the firmware.
+// Only the declarations are here; test/host/pico_sim.c implements them on a virtual clock.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+// --- GPIO ---
+#define GPIO_OUT 1
+#define GPIO_IN 0
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+#define IO_IRQ_BANK0 13
+
+enum gpio_function
+{
+    GPIO_FUNC_PWM = 4,
+    GPIO_FUNC_SIO = 5,
+    GPIO_FUNC_NULL = 0x1f
+};
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_pull_up(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled);
+void gpio_set_irq_callback(gpio_irq_callback_t callback);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
+
+// --- TIME ---
+uint32_t time_us_32(void);
+uint64_t time_us_64(void);
+absolute_time_t get_absolute_time(void);
+uint32_t to_ms_since_boot(absolute_time_t t);
+uint64_t to_us_since_boot(absolute_time_t t);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void tight_loop_contents(void);
+
+typedef struct repeating_timer repeating_timer_t;
+typedef bool (*repeating_timer_callback_t)(repeating_timer_t *rt);
+struct repeating_timer
+{
+    int64_t delay_us;
+    uint64_t next_ns;
+    repeating_timer_callback_t callback;
+    void *user_data;
+    bool active;
+    repeating_timer_t *next;
+};
+bool add_repeating_timer_us(int64_t delay_us, repeating_timer_callback_t callback, void *user_data,
+                            repeating_timer_t *out);
+bool cancel_repeating_timer(repeating_timer_t *timer);
+
+// --- CPU ---
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+void __dmb(void);
+void __wfe(void);
+void __sev(void);
+
+// --- STDIO ---
+#define PICO_ERROR_TIMEOUT (-1)
+bool stdio_init_all(void);
+int getchar_timeout_us(uint32_t timeout_us);
+
+#endif
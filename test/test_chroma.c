@@ -0,0 +1,160 @@
+// Ambient-compensated (chromaticity) scoring: correctness_compute_chroma against a
+// double-precision reference of the same metric, its invariance to overall brightness
+// compared with the absolute scorer, and its cost per call.
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include "correctness.h"
+#include "host/test_common.h"
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Same metric on channel / clear ratios (saturating at 4.0 like the Q14 kernel)
+static int reference(const uint32_t target[4], uint32_t r, uint32_t g, uint32_t b, uint32_t c)
+{
+    if (c == 0 || target[3] == 0)
+        return 0;
+
+    const uint32_t reading[3] = {r, g, b};
+    double error = 0.0;
+    for (int i = 0; i < 3; i++)
+    {
+        const double t = fmin((double)target[i] / target[3], 4.0);
+        const double x = fmin((double)reading[i] / c, 4.0);
+        if (t == 0.0)
+            return 0;
+        error += fabs(x - t) / t;
+    }
+
+    double accuracy = CORRECTNESS_MAX * (1.0 - error / 3.0);
+    if (accuracy < 0.0)
+        accuracy = 0.0;
+    return (int)(accuracy + 0.5);
+}
+
+// Deterministic readings spread over the sensor range
+static uint32_t rng_state = 2024u;
+static uint32_t rng_next(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+static void test_against_reference(void)
+{
+    static const uint32_t targets[][4] = {
+        {1200, 1000, 1600, 3800}, // The treasure color
+        {300, 250, 400, 950},     // Same color in a dim room
+        {9000, 400, 700, 10500},  // Saturated red
+    };
+    int worst = 0;
+    uint64_t points = 0;
+
+    for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++)
+    {
+        correctness_target_t target;
+        correctness_chroma_target_init(&target, targets[t][0], targets[t][1], targets[t][2], targets[t][3]);
+
+        for (int i = 0; i < 2000000; i++)
+        {
+            // Mostly near the target, some anywhere
+            uint32_t r, g, b, c;
+            if (i & 1)
+            {
+                const double k = 0.2 + (rng_next() % 1000u) / 250.0; // Ambient 0.2x .. 4.2x
+                r = (uint32_t)(targets[t][0] * k * (0.9 + (rng_next() % 200u) / 1000.0));
+                g = (uint32_t)(targets[t][1] * k * (0.9 + (rng_next() % 200u) / 1000.0));
+                b = (uint32_t)(targets[t][2] * k * (0.9 + (rng_next() % 200u) / 1000.0));
+                c = (uint32_t)(targets[t][3] * k);
+            }
+            else
+            {
+                r = rng_next() % 20000u;
+                g = rng_next() % 20000u;
+                b = rng_next() % 20000u;
+                c = rng_next() % 40000u;
+            }
+
+            const int diff =
+                abs((int)correctness_compute_chroma(&target, r, g, b, c) - reference(targets[t], r, g, b, c));
+            if (diff > worst)
+                worst = diff;
+            points++;
+        }
+    }
+
+    printf("chroma vs reference: %llu readings, max difference %d tenth(s)\n", (unsigned long long)points, worst);
+    TEST_CHECK(worst <= 1);
+}
+
+// Dimming or brightening the room scales R, G, B and CLEAR together
+static void test_ambient_invariance(void)
+{
+    correctness_target_t chroma, absolute;
+    correctness_chroma_target_init(&chroma, 1200, 1000, 1600, 3800);
+    correctness_target_init(&absolute, 1200, 1000, 1600);
+
+    printf("ambient  absolute  chroma\n");
+    for (double k = 0.25; k <= 4.0; k *= 2.0)
+    {
+        const uint32_t r = (uint32_t)(1200 * k), g = (uint32_t)(1000 * k), b = (uint32_t)(1600 * k),
+                       c = (uint32_t)(3800 * k);
+        const uint16_t abs_score = correctness_compute(&absolute, r, g, b);
+        const uint16_t chroma_score = correctness_compute_chroma(&chroma, r, g, b, c);
+        printf("  x%-5.2f  %5.1f %%  %5.1f %%\n", k, abs_score / 10.0, chroma_score / 10.0);
+        TEST_CHECK(chroma_score >= CORRECTNESS_MAX - 1);
+    }
+
+    // A different hue at the same brightness is still penalised
+    TEST_CHECK(correctness_compute_chroma(&chroma, 1600, 1000, 1200, 3800) < CORRECTNESS_SUCCESS);
+}
+
+static void test_edges(void)
+{
+    correctness_target_t target;
+
+    // No CLEAR reading: nothing to divide by
+    correctness_chroma_target_init(&target, 1200, 1000, 1600, 3800);
+    TEST_CHECK(correctness_compute_chroma(&target, 1200, 1000, 1600, 0) == 0);
+
+    // Uncalibrated target (CLEAR 0) never scores
+    correctness_chroma_target_init(&target, 1200, 1000, 1600, 0);
+    TEST_CHECK(correctness_compute_chroma(&target, 1200, 1000, 1600, 3800) == 0);
+
+    // Channels far brighter than CLEAR saturate instead of overflowing the Q14 shift
+    correctness_chroma_target_init(&target, 1200, 1000, 1600, 3800);
+    TEST_CHECK(correctness_compute_chroma(&target, 4000000, 4000000, 4000000, 1) == 0);
+}
+
+static void bench(void)
+{
+    correctness_target_t target;
+    correctness_chroma_target_init(&target, 1200, 1000, 1600, 3800);
+    volatile uint32_t sink = 0;
+    const int iterations = 20000000;
+
+    const double t0 = now_s();
+    for (int i = 0; i < iterations; i++)
+        sink += correctness_compute_chroma(&target, 1100u + (i & 255), 1000u, 1500u + (i & 127), 3700u + (i & 63));
+    const double elapsed = now_s() - t0;
+
+    printf("bench: %.2f ns per chroma score on the host (three divides + the shared kernel)\n",
+           elapsed * 1e9 / iterations);
+    (void)sink;
+}
+
+int main(void)
+{
+    test_against_reference();
+    test_ambient_invariance();
+    test_edges();
+    bench();
+
+    return TEST_RESULT();
+}
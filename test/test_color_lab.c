@@ -0,0 +1,223 @@
+// Integer CIELAB conversion (Q12 matrix + companding LUT) against a double-precision
+// sRGB/D65 reference, the LUT regenerated from its formula, Delta-E against floating
+// sqrt, and the cost per call next to the Hz scorer (correctness_compute).
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include "color_lab.h"
+#include "correctness.h"
+#include "host/test_common.h"
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// -----------------------------------------------------------------------------
+// Reference conversion
+// -----------------------------------------------------------------------------
+
+static double lab_f_ref(double t)
+{
+    const double d = 6.0 / 29.0;
+    return t > d * d * d ? cbrt(t) : t / (3.0 * d * d) + 4.0 / 29.0;
+}
+
+static void lab_ref(uint32_t r_hz, uint32_t g_hz, uint32_t b_hz, double lab[3])
+{
+    static const double m[3][3] = {
+        {0.4124, 0.3576, 0.1805},
+        {0.2126, 0.7152, 0.0722},
+        {0.0193, 0.1192, 0.9505},
+    };
+    const double white[3] = {COLOR_LAB_WHITE_R_HZ, COLOR_LAB_WHITE_G_HZ, COLOR_LAB_WHITE_B_HZ};
+    const double hz[3] = {r_hz, g_hz, b_hz};
+    double rgb[3], f[3];
+
+    for (int i = 0; i < 3; i++)
+        rgb[i] = fmin(hz[i] / white[i], 1.0);
+    for (int i = 0; i < 3; i++)
+    {
+        // Row sums are the D65 white point, so dividing by them gives X/Xn, Y/Yn, Z/Zn
+        const double row = m[i][0] + m[i][1] + m[i][2];
+        f[i] = lab_f_ref((m[i][0] * rgb[0] + m[i][1] * rgb[1] + m[i][2] * rgb[2]) / row);
+    }
+
+    lab[0] = 116.0 * f[1] - 16.0;
+    lab[1] = 500.0 * (f[0] - f[1]);
+    lab[2] = 200.0 * (f[1] - f[2]);
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+// The companding table, regenerated as its comment says: round(f(i / 256) * 32768)
+static void test_lab_f_table(void)
+{
+    int wrong = 0;
+    for (int i = 0; i <= 256; i++)
+    {
+        const int32_t expected = (int32_t)lround(lab_f_ref(i / 256.0) * 32768.0);
+        if (color_lab_f(i * 128) != expected)
+        {
+            printf("lab_f_lut[%d] = %ld, formula gives %ld\n", i, (long)color_lab_f(i * 128), (long)expected);
+            wrong++;
+        }
+    }
+    TEST_CHECK_MSG(wrong == 0, "%d table entries differ from the formula", wrong);
+
+    // Clamped outside 0..1, and interpolation stays close to the curve in between
+    TEST_CHECK(color_lab_f(-5) == color_lab_f(0) && color_lab_f(40000) == color_lab_f(32768));
+    double worst = 0.0;
+    for (int32_t t = 0; t <= 32768; t++)
+    {
+        const double err = fabs(color_lab_f(t) - lab_f_ref(t / 32768.0) * 32768.0);
+        if (err > worst)
+            worst = err;
+    }
+    printf("lab_f interpolation: worst error %.1f Q15 (%.4f)\n", worst, worst / 32768.0);
+    // The steep start of t^(1/3) is where linear interpolation is worst
+    TEST_CHECK(worst < 40.0);
+}
+
+// Conversion error over the whole normalised range, in Delta-E units
+static void test_conversion_accuracy(void)
+{
+    double worst = 0.0, total = 0.0;
+    uint64_t points = 0;
+    uint32_t worst_at[3] = {0, 0, 0};
+
+    for (uint32_t r = 0; r <= COLOR_LAB_WHITE_R_HZ; r += 25)
+    {
+        for (uint32_t g = 0; g <= COLOR_LAB_WHITE_G_HZ; g += 25)
+        {
+            for (uint32_t b = 0; b <= COLOR_LAB_WHITE_B_HZ; b += 25)
+            {
+                color_lab_t lab;
+                double ref[3];
+                color_lab_from_hz(r, g, b, &lab);
+                lab_ref(r, g, b, ref);
+
+                const double dl = lab.l / 16.0 - ref[0], da = lab.a / 16.0 - ref[1], db = lab.b / 16.0 - ref[2];
+                const double error = sqrt(dl * dl + da * da + db * db);
+                total += error;
+                points++;
+                if (error > worst)
+                {
+                    worst = error;
+                    worst_at[0] = r;
+                    worst_at[1] = g;
+                    worst_at[2] = b;
+                }
+            }
+        }
+    }
+
+    printf("Lab conversion: %llu points, mean error %.3f, max %.3f Delta-E at %u/%u/%u\n",
+           (unsigned long long)points, total / (double)points, worst, (unsigned)worst_at[0],
+           (unsigned)worst_at[1], (unsigned)worst_at[2]);
+    // Well under the 3.0 Delta-E success margin
+    TEST_CHECK(worst < 1.0);
+
+    // White maps to L = 100, a = b = 0; black to L = 0
+    color_lab_t lab;
+    color_lab_from_hz(COLOR_LAB_WHITE_R_HZ, COLOR_LAB_WHITE_G_HZ, COLOR_LAB_WHITE_B_HZ, &lab);
+    TEST_CHECK(abs(lab.l - 100 * 16) <= 1 && abs(lab.a) <= 1 && abs(lab.b) <= 1);
+    color_lab_from_hz(0, 0, 0, &lab);
+    TEST_CHECK(abs(lab.l) <= 1 && abs(lab.a) <= 1 && abs(lab.b) <= 1);
+
+    // Brighter than white saturates rather than wrapping
+    color_lab_t over;
+    color_lab_from_hz(4 * COLOR_LAB_WHITE_R_HZ, 100000, 0xFFFFFFFFu, &over);
+    color_lab_from_hz(COLOR_LAB_WHITE_R_HZ, COLOR_LAB_WHITE_G_HZ, COLOR_LAB_WHITE_B_HZ, &lab);
+    TEST_CHECK(over.l == lab.l && over.a == lab.a && over.b == lab.b);
+}
+
+// Integer sqrt of the Q4 sum of squares is the floor of the exact distance
+static void test_delta_e(void)
+{
+    int worst = 0;
+    for (int i = 0; i < 200000; i++)
+    {
+        const color_lab_t x = {(i * 37) % 1601, (i * 53) % 4001 - 2000, (i * 71) % 4001 - 2000};
+        const color_lab_t y = {(i * 11) % 1601, (i * 29) % 4001 - 2000, (i * 13) % 4001 - 2000};
+        const double exact = sqrt((double)(x.l - y.l) * (x.l - y.l) + (double)(x.a - y.a) * (x.a - y.a) +
+                                  (double)(x.b - y.b) * (x.b - y.b));
+        const int diff = abs((int)color_lab_delta_e(&x, &y) - (int)floor(exact));
+        if (diff > worst)
+            worst = diff;
+    }
+    TEST_CHECK(worst == 0);
+
+    // Score: linear from 100 % at Delta-E 0 to 0 % at COLOR_LAB_DELTA_E_ZERO
+    color_lab_t target;
+    color_lab_from_hz(1200, 1000, 1600, &target);
+    TEST_CHECK(color_lab_correctness(&target, 1200, 1000, 1600) == CORRECTNESS_MAX);
+    TEST_CHECK(color_lab_correctness(&target, 5000, 0, 0) == 0);
+
+    const uint16_t near = color_lab_correctness(&target, 1250, 1000, 1600);
+    double ref_t[3], ref_r[3];
+    lab_ref(1200, 1000, 1600, ref_t);
+    lab_ref(1250, 1000, 1600, ref_r);
+    const double de = sqrt(pow(ref_t[0] - ref_r[0], 2) + pow(ref_t[1] - ref_r[1], 2) + pow(ref_t[2] - ref_r[2], 2));
+    const double expected = CORRECTNESS_MAX * (1.0 - de / COLOR_LAB_DELTA_E_ZERO);
+    printf("4 %% red step: Delta-E %.2f, score %u (reference %.1f)\n", de, (unsigned)near, expected);
+    TEST_CHECK(fabs(near - expected) <= 3.0);
+}
+
+static void bench(void)
+{
+    color_lab_t target, lab;
+    color_lab_from_hz(1200, 1000, 1600, &target);
+    volatile uint32_t sink = 0;
+    const int iterations = 5000000;
+
+    double t0 = now_s();
+    for (int i = 0; i < iterations; i++)
+    {
+        color_lab_from_hz(1000u + (i & 1023), 900u + (i & 511), 1500u + (i & 255), &lab);
+        sink += (uint32_t)lab.l;
+    }
+    const double convert_ns = (now_s() - t0) * 1e9 / iterations;
+
+    t0 = now_s();
+    for (int i = 0; i < iterations; i++)
+        sink += color_lab_correctness(&target, 1000u + (i & 1023), 900u + (i & 511), 1500u + (i & 255));
+    const double score_ns = (now_s() - t0) * 1e9 / iterations;
+
+    // The Hz scorer the Lab one stands in for, on the same readings
+    correctness_target_t hz_target;
+    correctness_target_init(&hz_target, 1200, 1000, 1600);
+    t0 = now_s();
+    for (int i = 0; i < iterations; i++)
+        sink += correctness_compute(&hz_target, 1000u + (i & 1023), 900u + (i & 511), 1500u + (i & 255));
+    const double hz_ns = (now_s() - t0) * 1e9 / iterations;
+
+    double ref[3];
+    t0 = now_s();
+    for (int i = 0; i < iterations; i++)
+    {
+        lab_ref(1000u + (i & 1023), 900u + (i & 511), 1500u + (i & 255), ref);
+        sink += (uint32_t)ref[0];
+    }
+    const double ref_ns = (now_s() - t0) * 1e9 / iterations;
+
+    printf("bench (host ns per call): integer Lab %.1f, Lab score %.1f, Hz score (correctness_compute) %.1f, "
+           "double cbrt reference %.1f\n",
+           convert_ns, score_ns, hz_ns, ref_ns);
+    (void)sink;
+}
+
+int main(void)
+{
+    test_lab_f_table();
+    test_conversion_accuracy();
+    test_delta_e();
+    bench();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,207 @@
+// Gate-count, reciprocal and auto-ranging acquisition of color_sensor.c against a
+// simulated TCS3200: S0..S3 select the OUT frequency, edges are counted by the
+// simulated PWM slice and timestamped by the simulated GPIO interrupt.
+
+#include <stdlib.h>
+#include "color_sensor.h"
+#include "host/pico_sim.h"
+#include "host/test_common.h"
+
+// -----------------------------------------------------------------------------
+// TCS3200 model
+// -----------------------------------------------------------------------------
+
+// OUT frequency at 100 % scale, indexed by tcs3200_filter_t
+static double model_hz_100[4];
+
+static const uint8_t model_scale_percent[4] = {0, 2, 20, 100};
+
+static void model_update(uint gpio, bool value)
+{
+    (void)value;
+    if (gpio != TCS3200_S0_PIN && gpio != TCS3200_S1_PIN && gpio != TCS3200_S2_PIN && gpio != TCS3200_S3_PIN)
+        return;
+
+    // Same encodings as tcs3200_set_s0_s1 / tcs3200_set_s2_s3
+    const bool s0 = sim_gpio_output(TCS3200_S0_PIN), s1 = sim_gpio_output(TCS3200_S1_PIN);
+    const bool s2 = sim_gpio_output(TCS3200_S2_PIN), s3 = sim_gpio_output(TCS3200_S3_PIN);
+    const tcs3200_scale_t scale = s0 ? (s1 ? TCS3200_SCALE_100_PERCENT : TCS3200_SCALE_20_PERCENT)
+                                     : (s1 ? TCS3200_SCALE_2_PERCENT : TCS3200_SCALE_POWER_DOWN);
+    const tcs3200_filter_t filter = s2 ? (s3 ? TCS3200_FILTER_GREEN : TCS3200_FILTER_CLEAR)
+                                       : (s3 ? TCS3200_FILTER_BLUE : TCS3200_FILTER_RED);
+
+    sim_signal_set_hz(model_hz_100[filter] * model_scale_percent[scale] / 100.0);
+}
+
+static void model_set(double red, double green, double blue, double clear)
+{
+    model_hz_100[TCS3200_FILTER_RED] = red;
+    model_hz_100[TCS3200_FILTER_GREEN] = green;
+    model_hz_100[TCS3200_FILTER_BLUE] = blue;
+    model_hz_100[TCS3200_FILTER_CLEAR] = clear;
+    model_update(TCS3200_S0_PIN, false);
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+// Gate counting is good to one count per gate and leaves the CPU asleep
+static void test_gate_count(void)
+{
+    static const double freqs[] = {0.0, 480.0, 3000.0, 12345.0, 47000.0, 180000.0};
+    const uint32_t gate_ms = 10;
+
+    TCS3200_SetMeasureMode(TCS3200_MODE_GATE_COUNT);
+    TCS3200_SetFrequencyScaling(TCS3200_SCALE_20_PERCENT);
+    TCS3200_SetFilter(TCS3200_FILTER_CLEAR);
+
+    printf("gate count, %u ms gate\n", (unsigned)gate_ms);
+    for (size_t i = 0; i < sizeof(freqs) / sizeof(freqs[0]); i++)
+    {
+        const double f = freqs[i];
+        model_set(0, 0, 0, f * 5.0); // 20 % scale
+        sleep_ms(TCS3200_SETTLE_MS);
+
+        const uint64_t spin_before = sim_spin_ns();
+        const uint64_t t0 = sim_now_ns();
+        const uint32_t hz = TCS3200_ReadFrequencyHz(gate_ms);
+        const uint64_t busy_us = (sim_spin_ns() - spin_before) / 1000u;
+        const uint64_t took_us = (sim_now_ns() - t0) / 1000u;
+
+        printf("  %9.1f Hz -> %6u Hz  took %llu us, busy %llu us\n", f, (unsigned)hz,
+               (unsigned long long)took_us, (unsigned long long)busy_us);
+        TEST_CHECK_MSG(abs((int)hz - (int)f) <= (int)(1000u / gate_ms) + 1, "%.1f Hz read as %u", f, (unsigned)hz);
+        TEST_CHECK(busy_us <= 10);
+        TEST_CHECK(took_us <= gate_ms * 1000u + 10u);
+    }
+}
+
+// Gates longer than 65536 edges go through the 16-bit counter wrap interrupt
+static void test_counter_wrap(void)
+{
+    TCS3200_SetMeasureMode(TCS3200_MODE_GATE_COUNT);
+    TCS3200_SetFrequencyScaling(TCS3200_SCALE_100_PERCENT);
+    TCS3200_SetFilter(TCS3200_FILTER_CLEAR);
+    model_set(0, 0, 0, 480000.0);
+    sleep_ms(TCS3200_SETTLE_MS);
+
+    const uint64_t edges_before = sim_signal_edges();
+    const uint32_t hz = TCS3200_ReadFrequencyHz(300);
+    const uint64_t edges = sim_signal_edges() - edges_before;
+
+    printf("counter wrap: %llu edges in 300 ms -> %u Hz\n", (unsigned long long)edges, (unsigned)hz);
+    TEST_CHECK(edges > 2u * 65536u);
+    TEST_CHECK(abs((int)hz - 480000) <= 4);
+}
+
+// Reciprocal mode reaches TCS3200_RECIP_PRECISION_PPM whatever the frequency
+static void test_reciprocal(void)
+{
+    static const double freqs[] = {150.0, 999.0, 7777.7, 50000.0, 333333.3};
+
+    TCS3200_SetMeasureMode(TCS3200_MODE_RECIPROCAL);
+    TCS3200_SetFrequencyScaling(TCS3200_SCALE_100_PERCENT);
+    TCS3200_SetFilter(TCS3200_FILTER_CLEAR);
+
+    printf("reciprocal, %u ppm target\n", (unsigned)TCS3200_RECIP_PRECISION_PPM);
+    for (size_t i = 0; i < sizeof(freqs) / sizeof(freqs[0]); i++)
+    {
+        const double f = freqs[i];
+        model_set(0, 0, 0, f);
+        sleep_ms(TCS3200_SETTLE_MS);
+
+        const uint64_t spin_before = sim_spin_ns();
+        const uint64_t t0 = sim_now_ns();
+        const uint32_t hz = TCS3200_ReadFrequencyHz(0);
+        const uint64_t busy_us = (sim_spin_ns() - spin_before) / 1000u;
+        const uint64_t took_us = (sim_now_ns() - t0) / 1000u;
+        const double error_ppm = (hz - f) / f * 1e6;
+
+        printf("  %9.1f Hz -> %6u Hz  %+6.0f ppm  took %llu us, busy %llu us\n", f, (unsigned)hz, error_ppm,
+               (unsigned long long)took_us, (unsigned long long)busy_us);
+        // One extra count of rounding on top of the timestamp error
+        TEST_CHECK_MSG(error_ppm <= TCS3200_RECIP_PRECISION_PPM + 1e6 / f &&
+                           error_ppm >= -(TCS3200_RECIP_PRECISION_PPM + 1e6 / f),
+                       "%.1f Hz read as %u", f, (unsigned)hz);
+    }
+
+    // No light: gives up after the timeout instead of hanging
+    model_set(0, 0, 0, 0.0);
+    const uint64_t t0 = sim_now_ns();
+    const uint32_t hz = TCS3200_ReadFrequencyHz(0);
+    const uint64_t took_us = (sim_now_ns() - t0) / 1000u;
+    printf("  dark -> %u Hz after %llu us\n", (unsigned)hz, (unsigned long long)took_us);
+    TEST_CHECK(hz == 0);
+    TEST_CHECK(took_us >= TCS3200_RECIP_TIMEOUT_MS * 1000u && took_us <= TCS3200_RECIP_TIMEOUT_MS * 1000u + 100u);
+
+    TCS3200_SetMeasureMode(TCS3200_MODE_GATE_COUNT);
+}
+
+static uint32_t scale_tolerance_hz(tcs3200_scale_t scale, uint32_t gate_us, uint32_t expected)
+{
+    // One count per gate at the measured scale, seen at the 20 % reference scale
+    return (uint32_t)(1e6 / gate_us * 20.0 / model_scale_percent[scale]) + expected / 1000u + 1u;
+}
+
+// Auto-ranging picks scale and gate per channel from the previous reading
+static void test_autorange(void)
+{
+    // Bright red, mid green, dim blue (100 % scale frequencies)
+    const double red = 2000000.0, green = 40000.0, blue = 1500.0;
+    uint32_t r, g, b;
+    tcs3200_scale_t rs, gs, bs;
+
+    TCS3200_SetMeasureMode(TCS3200_MODE_GATE_COUNT);
+    TCS3200_SetFrequencyScaling(TCS3200_SCALE_20_PERCENT);
+    TCS3200_SetAutoRange(true);
+    model_set(red, green, blue, red + green + blue);
+
+    // First acquisition has no history: longest gate at full scale
+    TCS3200_ReadRGB(0, &r, &g, &b);
+    TCS3200_GetRGBScale(&rs, &gs, &bs);
+    TEST_CHECK(rs == TCS3200_SCALE_100_PERCENT && gs == TCS3200_SCALE_100_PERCENT && bs == TCS3200_SCALE_100_PERCENT);
+
+    const uint64_t t0 = sim_now_ns();
+    TCS3200_ReadRGB(0, &r, &g, &b);
+    const uint64_t took_us = (sim_now_ns() - t0) / 1000u;
+    TCS3200_GetRGBScale(&rs, &gs, &bs);
+
+    // Red would exceed TCS3200_AUTORANGE_MAX_HZ at 100 %, the others stay at full scale
+    TEST_CHECK(rs == TCS3200_SCALE_20_PERCENT);
+    TEST_CHECK(gs == TCS3200_SCALE_100_PERCENT);
+    TEST_CHECK(bs == TCS3200_SCALE_100_PERCENT);
+
+    // Gates: 100 counts at 400 kHz -> clamped to the minimum, 2.5 ms at 40 kHz, 66 ms at 1.5 kHz -> maximum
+    const uint32_t r_gate = TCS3200_AUTORANGE_MIN_GATE_US, g_gate = 2500, b_gate = TCS3200_AUTORANGE_MAX_GATE_US;
+    const uint32_t r_ref = (uint32_t)(red / 5.0), g_ref = (uint32_t)(green / 5.0), b_ref = (uint32_t)(blue / 5.0);
+    printf("autorange: r %u (%u) g %u (%u) b %u (%u) Hz at the 20 %% reference, acquisition %llu us\n",
+           (unsigned)r, (unsigned)r_ref, (unsigned)g, (unsigned)g_ref, (unsigned)b, (unsigned)b_ref,
+           (unsigned long long)took_us);
+    TEST_CHECK(abs((int)r - (int)r_ref) <= (int)scale_tolerance_hz(rs, r_gate, r_ref));
+    TEST_CHECK(abs((int)g - (int)g_ref) <= (int)scale_tolerance_hz(gs, g_gate, g_ref));
+    TEST_CHECK(abs((int)b - (int)b_ref) <= (int)scale_tolerance_hz(bs, b_gate, b_ref));
+
+    // Three settles plus the three chosen gates, polled every microsecond
+    const uint64_t expected_us = 3u * TCS3200_SETTLE_MS * 1000u + r_gate + g_gate + b_gate;
+    TEST_CHECK(took_us >= expected_us && took_us <= expected_us + 10u);
+
+    // Switching auto-ranging off restores the caller's scale on S0/S1
+    TCS3200_SetAutoRange(false);
+    TEST_CHECK(sim_gpio_output(TCS3200_S0_PIN) && !sim_gpio_output(TCS3200_S1_PIN));
+}
+
+int main(void)
+{
+    sim_reset();
+    sim_signal_attach(TCS3200_OUT_PIN);
+    TCS3200_Init();
+    sim_set_gpio_put_hook(model_update);
+
+    test_gate_count();
+    test_counter_wrap();
+    test_reciprocal();
+    test_autorange();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,127 @@
+// correctness_compute against a double-precision reference of the original float
+// metric over a dense grid of readings, plus its cost per call. Built twice: with
+// the default Q16.16 kernel and with CORRECTNESS_USE_FLOAT=1.
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include "correctness.h"
+#include "host/test_common.h"
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// The original metric, evaluated in double and rounded like the kernels
+static int reference(uint32_t tr, uint32_t tg, uint32_t tb, uint32_t r, uint32_t g, uint32_t b)
+{
+    if (tr == 0 || tg == 0 || tb == 0)
+        return 0;
+    const double error = (fabs((double)r - tr) / tr + fabs((double)g - tg) / tg + fabs((double)b - tb) / tb) / 3.0;
+    double accuracy = CORRECTNESS_MAX * (1.0 - error);
+    if (accuracy < 0.0)
+        accuracy = 0.0;
+    if (accuracy > CORRECTNESS_MAX)
+        accuracy = CORRECTNESS_MAX;
+    return (int)(accuracy + 0.5);
+}
+
+// Every reading on the grid [0, max] x [0, max] x [0, max]
+static void check_grid(uint32_t tr, uint32_t tg, uint32_t tb, uint32_t max, uint32_t step)
+{
+    correctness_target_t target;
+    correctness_target_init(&target, tr, tg, tb);
+
+    uint64_t points = 0, exact = 0;
+    int worst = 0;
+    uint32_t worst_at[3] = {0, 0, 0};
+
+    for (uint32_t r = 0; r <= max; r += step)
+    {
+        for (uint32_t g = 0; g <= max; g += step)
+        {
+            for (uint32_t b = 0; b <= max; b += step)
+            {
+                const int diff = abs((int)correctness_compute(&target, r, g, b) - reference(tr, tg, tb, r, g, b));
+                points++;
+                exact += diff == 0;
+                if (diff > worst)
+                {
+                    worst = diff;
+                    worst_at[0] = r;
+                    worst_at[1] = g;
+                    worst_at[2] = b;
+                }
+            }
+        }
+    }
+
+    printf("target %u/%u/%u: %llu points, %.4f %% exact, max difference %d tenth(s) at %u/%u/%u\n", (unsigned)tr,
+           (unsigned)tg, (unsigned)tb, (unsigned long long)points, 100.0 * (double)exact / (double)points, worst,
+           (unsigned)worst_at[0], (unsigned)worst_at[1], (unsigned)worst_at[2]);
+    TEST_CHECK(worst <= 1);
+}
+
+static void check_edges(void)
+{
+    correctness_target_t target;
+
+    // Exact match, far off, and a 0 Hz target
+    correctness_target_init(&target, 1200, 1000, 1600);
+    TEST_CHECK(correctness_compute(&target, 1200, 1000, 1600) == CORRECTNESS_MAX);
+    TEST_CHECK(correctness_compute(&target, 100000, 100000, 100000) == 0);
+    TEST_CHECK(correctness_compute(&target, UINT32_MAX, UINT32_MAX, UINT32_MAX) == 0);
+
+    correctness_target_init(&target, 0, 1000, 1600);
+    TEST_CHECK(correctness_compute(&target, 0, 1000, 1600) == 0);
+
+    // Success threshold sits where the reference puts it
+    correctness_target_init(&target, 1000, 1000, 1000);
+    TEST_CHECK(correctness_compute(&target, 1030, 1000, 1000) == 990);
+    TEST_CHECK(correctness_compute(&target, 1090, 1000, 1000) == CORRECTNESS_SUCCESS);
+}
+
+static void bench(void)
+{
+    correctness_target_t target;
+    correctness_target_init(&target, 1200, 1000, 1600);
+    volatile uint32_t sink = 0;
+    uint64_t calls = 0;
+
+    const double t0 = now_s();
+    for (uint32_t r = 0; r <= 5000; r += 10)
+    {
+        for (uint32_t g = 0; g <= 5000; g += 10)
+        {
+            for (uint32_t b = 0; b <= 5000; b += 50)
+            {
+                sink += correctness_compute(&target, r, g, b);
+                calls++;
+            }
+        }
+    }
+    const double elapsed = now_s() - t0;
+
+    printf("bench (%s kernel): %.2f ns per call on the host\n", CORRECTNESS_USE_FLOAT ? "float" : "Q16.16",
+           elapsed * 1e9 / (double)calls);
+    (void)sink;
+}
+
+int main(void)
+{
+    check_edges();
+
+    // The treasure target over the sensor's working range (501^3 points)
+    check_grid(1200, 1000, 1600, 5000, 10);
+    // Bright targets (auto-ranged readings reach hundreds of kHz)
+    check_grid(400000, 8000, 250000, 500000, 2500);
+    // Tiny targets, where the reciprocal is coarsest
+    check_grid(3, 7, 1, 40, 1);
+
+    bench();
+
+    return TEST_RESULT();
+}
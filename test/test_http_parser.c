@@ -0,0 +1,318 @@
+// http_parser: every request of a corpus (and thousands of mutations of it) must parse
+// to the same result whichever way the bytes are cut into pieces, pipelined requests
+// must stop at the end of the first head, and the limits hold. Ends with the cost per
+// byte for a typical browser request fed whole, per TCP segment and one byte at a time.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "http_parser.h"
+#include "host/test_common.h"
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint32_t rng_state = 4711u;
+static uint32_t rng_next(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+static const char browser_request[] =
+    "GET /data HTTP/1.1\r\n"
+    "Host: 192.168.4.1\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (Linux; Android 14; Pixel 8) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/126.0 Mobile "
+    "Safari/537.36\r\n"
+    "Accept: */*\r\n"
+    "Referer: http://192.168.4.1/\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: en-GB,en;q=0.9\r\n"
+    "If-None-Match: \"89ac16b0388e97d3\"\r\n"
+    "\r\n";
+
+static const char *const corpus[] = {
+    browser_request,
+    "GET / HTTP/1.1\r\n\r\n",
+    "GET / HTTP/1.0\r\n\r\n",
+    "GET / HTTP/1.0\r\nConnection: keep-alive\r\n\r\n",
+    "GET /success HTTP/1.1\r\nConnection: close\r\n\r\n",
+    "GET /history?since=120&format=bin HTTP/1.1\r\nHost: x\r\n\r\n",
+    "HEAD /stats HTTP/1.1\r\nHost: x\r\n\r\n",
+    "POST /data HTTP/1.1\r\nContent-Length: 0\r\n\r\n",
+    "GET /ws HTTP/1.1\r\nHost: x\r\nUpgrade: WebSocket\r\nConnection: keep-alive, Upgrade\r\n"
+    "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n",
+    "GET / HTTP/1.1\nHost: bare-lf\n\n",
+    "\r\n\r\nGET / HTTP/1.1\r\n\r\n",
+    "GET / HTTP/1.1\r\nIf-None-Match:   W/\"abc\"  \r\n\r\n",
+    "GET / HTTP/2.0\r\n\r\n",
+    "GET  HTTP/1.1\r\n\r\n",
+    "GET /\r\n\r\n",
+    "GET / HTTP/1.1\r\nNo colon here\r\n\r\n",
+    "GET / HTTP/1.1\r\nX: y\rZ\r\n\r\n",
+    "GET /a-path-that-is-longer-than-the-forty-eight-byte-limit HTTP/1.1\r\n\r\n",
+    "GET / HTTP/1.1\r\nAccept-Encoding: br;q=1.0, GZIP ; q=0.000, *\r\n\r\n",
+};
+#define CORPUS_SIZE (sizeof(corpus) / sizeof(corpus[0]))
+
+typedef struct
+{
+    http_parse_result_t result;
+    uint32_t consumed;
+    http_parser_t parser;
+} parse_t;
+
+// Feed `len` bytes in pieces; cuts[] holds the piece sizes in turn (NULL: all at once)
+static void parse(const char *data, uint32_t len, const uint16_t *cuts, int cut_count, parse_t *out)
+{
+    http_parser_reset(&out->parser);
+    out->result = HTTP_PARSE_INCOMPLETE;
+    out->consumed = 0;
+
+    for (int k = 0; out->consumed < len && out->result == HTTP_PARSE_INCOMPLETE; k++)
+    {
+        uint16_t piece = (cuts && cut_count) ? cuts[k % cut_count] : (uint16_t)(len - out->consumed);
+        if (piece > len - out->consumed)
+            piece = (uint16_t)(len - out->consumed);
+        uint16_t used = 0;
+        out->result = http_parser_feed(&out->parser, data + out->consumed, piece, &used);
+        out->consumed += used;
+        if (used > piece || (out->result == HTTP_PARSE_INCOMPLETE && used != piece))
+        {
+            out->result = (http_parse_result_t)-1; // Contract broken
+            return;
+        }
+    }
+}
+
+static bool same_fields(const http_parser_t *a, const http_parser_t *b)
+{
+    return a->method == b->method && a->minor_version == b->minor_version && a->keep_alive == b->keep_alive &&
+           a->upgrade_websocket == b->upgrade_websocket && a->accept_gzip == b->accept_gzip &&
+           a->ws_version == b->ws_version &&
+           strcmp(a->path, b->path) == 0 && strcmp(a->query, b->query) == 0 &&
+           strcmp(a->if_none_match, b->if_none_match) == 0 && strcmp(a->ws_key, b->ws_key) == 0;
+}
+
+static bool same_parse(const parse_t *a, const parse_t *b)
+{
+    if (a->result != b->result || a->consumed != b->consumed)
+        return false;
+    return a->result != HTTP_PARSE_DONE || same_fields(&a->parser, &b->parser);
+}
+
+// Results are NUL-terminated within their buffers
+static bool fields_bounded(const http_parser_t *p)
+{
+    return memchr(p->path, '\0', sizeof(p->path)) && memchr(p->query, '\0', sizeof(p->query)) &&
+           memchr(p->if_none_match, '\0', sizeof(p->if_none_match)) && memchr(p->ws_key, '\0', sizeof(p->ws_key));
+}
+
+// Whole vs. 1-byte pieces vs. random cuts
+static int check_fragmentation(const char *data, uint32_t len, int rounds)
+{
+    parse_t whole, cut;
+    uint16_t cuts[16];
+    int mismatches = 0;
+
+    parse(data, len, NULL, 0, &whole);
+    if (whole.result == HTTP_PARSE_DONE && !fields_bounded(&whole.parser))
+        mismatches++;
+
+    cuts[0] = 1;
+    parse(data, len, cuts, 1, &cut);
+    mismatches += !same_parse(&whole, &cut);
+
+    for (int r = 0; r < rounds; r++)
+    {
+        const int count = 1 + (int)(rng_next() % 16u);
+        for (int k = 0; k < count; k++)
+            cuts[k] = (uint16_t)(1u + rng_next() % ((rng_next() & 1) ? 8u : 200u));
+        parse(data, len, cuts, count, &cut);
+        mismatches += !same_parse(&whole, &cut);
+    }
+    return mismatches;
+}
+
+static void test_corpus(void)
+{
+    parse_t p;
+
+    parse(browser_request, sizeof(browser_request) - 1, NULL, 0, &p);
+    TEST_CHECK(p.result == HTTP_PARSE_DONE && p.consumed == sizeof(browser_request) - 1);
+    TEST_CHECK(p.parser.method == HTTP_METHOD_GET && strcmp(p.parser.path, "/data") == 0 && p.parser.keep_alive);
+    TEST_CHECK(strcmp(p.parser.if_none_match, "\"89ac16b0388e97d3\"") == 0);
+    TEST_CHECK(p.parser.accept_gzip);
+
+    parse(corpus[5], (uint32_t)strlen(corpus[5]), NULL, 0, &p);
+    TEST_CHECK(strcmp(p.parser.path, "/history") == 0 && strcmp(p.parser.query, "since=120&format=bin") == 0);
+    parse(corpus[6], (uint32_t)strlen(corpus[6]), NULL, 0, &p);
+    TEST_CHECK(p.result == HTTP_PARSE_DONE && p.parser.method == HTTP_METHOD_HEAD);
+    parse(corpus[8], (uint32_t)strlen(corpus[8]), NULL, 0, &p);
+    TEST_CHECK(p.parser.upgrade_websocket && p.parser.ws_version == 13 && p.parser.keep_alive);
+    TEST_CHECK(strcmp(p.parser.ws_key, "dGhlIHNhbXBsZSBub25jZQ==") == 0);
+    parse(corpus[12], (uint32_t)strlen(corpus[12]), NULL, 0, &p);
+    TEST_CHECK(p.result == HTTP_PARSE_ERROR);
+    // No Accept-Encoding: gzip is not assumed; refused by name it stays refused despite "*"
+    parse(corpus[1], (uint32_t)strlen(corpus[1]), NULL, 0, &p);
+    TEST_CHECK(p.result == HTTP_PARSE_DONE && !p.parser.accept_gzip);
+    parse(corpus[CORPUS_SIZE - 1], (uint32_t)strlen(corpus[CORPUS_SIZE - 1]), NULL, 0, &p);
+    TEST_CHECK(p.result == HTTP_PARSE_DONE && !p.parser.accept_gzip);
+
+    int mismatches = 0;
+    for (size_t i = 0; i < CORPUS_SIZE; i++)
+        mismatches += check_fragmentation(corpus[i], (uint32_t)strlen(corpus[i]), 200);
+    TEST_CHECK_MSG(mismatches == 0, "%d fragmentations parsed differently", mismatches);
+}
+
+// Two heads back to back: the first parse stops exactly at the blank line
+static void test_pipelined(void)
+{
+    int failures = 0;
+    for (size_t a = 0; a < CORPUS_SIZE; a++)
+    {
+        for (size_t b = 0; b < CORPUS_SIZE; b++)
+        {
+            char both[1024];
+            const int len_a = (int)strlen(corpus[a]);
+            const int len = snprintf(both, sizeof(both), "%s%s", corpus[a], corpus[b]);
+
+            parse_t first, alone;
+            parse(corpus[a], (uint32_t)len_a, NULL, 0, &alone);
+            if (alone.result != HTTP_PARSE_DONE)
+                continue;
+            parse(both, (uint32_t)len, NULL, 0, &first);
+            failures += !same_parse(&alone, &first) || first.consumed != (uint32_t)len_a;
+            failures += check_fragmentation(both, (uint32_t)len, 20);
+        }
+    }
+    TEST_CHECK_MSG(failures == 0, "%d pipelined pairs mis-split", failures);
+}
+
+// Random damage to the corpus: flipped, inserted and deleted bytes, truncation
+static void test_mutations(void)
+{
+    static const char interesting[] = "\r\n :?/\t\0\x80\xff";
+    char buf[1024];
+    int mismatches = 0, done = 0, errors = 0, incomplete = 0;
+    const int cases = 60000;
+
+    for (int n = 0; n < cases; n++)
+    {
+        const char *seed = corpus[rng_next() % CORPUS_SIZE];
+        int len = (int)strlen(seed);
+        memcpy(buf, seed, len);
+
+        const int edits = 1 + (int)(rng_next() % 4u);
+        for (int e = 0; e < edits && len > 1; e++)
+        {
+            const int at = (int)(rng_next() % (uint32_t)len);
+            const char c = (rng_next() & 1) ? interesting[rng_next() % (sizeof(interesting) - 1)] : (char)rng_next();
+            switch (rng_next() % 4u)
+            {
+            case 0:
+                buf[at] = c;
+                break;
+            case 1:
+                if (len < (int)sizeof(buf) - 1)
+                {
+                    memmove(buf + at + 1, buf + at, len - at);
+                    buf[at] = c;
+                    len++;
+                }
+                break;
+            case 2:
+                memmove(buf + at, buf + at + 1, len - at - 1);
+                len--;
+                break;
+            default:
+                len = at + 1;
+                break;
+            }
+        }
+
+        mismatches += check_fragmentation(buf, (uint32_t)len, 3);
+        parse_t p;
+        parse(buf, (uint32_t)len, NULL, 0, &p);
+        done += p.result == HTTP_PARSE_DONE;
+        errors += p.result == HTTP_PARSE_ERROR;
+        incomplete += p.result == HTTP_PARSE_INCOMPLETE;
+    }
+
+    printf("mutations: %d cases, %d done, %d errors, %d incomplete\n", cases, done, errors, incomplete);
+    TEST_CHECK_MSG(mismatches == 0, "%d mutated requests parsed differently when fragmented", mismatches);
+    TEST_CHECK(done + errors + incomplete == cases);
+}
+
+static void test_limits(void)
+{
+    static char big[HTTP_PARSER_HEADER_MAX + 64];
+    parse_t p;
+
+    // Exactly at the limit is accepted, one byte over is rejected
+    for (int over = 0; over <= 1; over++)
+    {
+        const char head[] = "GET / HTTP/1.1\r\nX-Pad: ";
+        const int total = HTTP_PARSER_HEADER_MAX + over;
+        int len = snprintf(big, sizeof(big), "%s", head);
+        while (len < total - 4)
+            big[len++] = 'a';
+        memcpy(big + len, "\r\n\r\n", 4);
+        len += 4;
+        parse(big, (uint32_t)len, NULL, 0, &p);
+        TEST_CHECK_MSG(p.result == (over ? HTTP_PARSE_ERROR : HTTP_PARSE_DONE), "%d bytes", len);
+    }
+
+    // Over-long values of headers we keep: If-None-Match is truncated, a key is dropped
+    char value[HTTP_PARSER_VALUE_MAX + 40];
+    memset(value, 'k', sizeof(value) - 1);
+    value[sizeof(value) - 1] = '\0';
+    int len = snprintf(big, sizeof(big), "GET / HTTP/1.1\r\nIf-None-Match: %s\r\nSec-WebSocket-Key: %s\r\n\r\n", value,
+                       value);
+    parse(big, (uint32_t)len, NULL, 0, &p);
+    TEST_CHECK(p.result == HTTP_PARSE_DONE && strlen(p.parser.if_none_match) == HTTP_PARSER_VALUE_MAX);
+    TEST_CHECK(p.parser.ws_key[0] == '\0');
+    TEST_CHECK(check_fragmentation(big, (uint32_t)len, 50) == 0);
+}
+
+static void bench(void)
+{
+    const uint32_t len = sizeof(browser_request) - 1;
+    const int iterations = 200000;
+    static const uint16_t one_byte[1] = {1};
+    static const uint16_t segments[1] = {536}; // Default TCP MSS
+    const uint16_t *modes[3] = {NULL, segments, one_byte};
+    static const char *const names[3] = {"whole", "536-byte pieces", "1-byte pieces"};
+    volatile uint32_t sink = 0;
+
+    for (int m = 0; m < 3; m++)
+    {
+        parse_t p;
+        const double t0 = now_s();
+        for (int i = 0; i < iterations; i++)
+        {
+            parse(browser_request, len, modes[m], modes[m] ? 1 : 0, &p);
+            sink += p.consumed;
+        }
+        const double elapsed = now_s() - t0;
+        printf("bench (%s): %.0f ns per %u-byte request, %.2f ns per byte\n", names[m], elapsed * 1e9 / iterations,
+               (unsigned)len, elapsed * 1e9 / iterations / len);
+    }
+    (void)sink;
+}
+
+int main(void)
+{
+    test_corpus();
+    test_pipelined();
+    test_mutations();
+    test_limits();
+    bench();
+
+    return TEST_RESULT();
+}
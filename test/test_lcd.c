@@ -0,0 +1,389 @@
+// LCD driver against a model HD44780 on the simulated GPIO pins: the controller
+// decodes the 4-bit bus (init in 8-bit mode, then nibble pairs on each Enable fall)
+// into its DDRAM, and checks the timing it is given: execution time before the next
+// Enable (37 us, 1.52 ms for clear / home), pulse width, data stable while Enable is
+// high. The tests diff what the display shows against the framebuffer that was drawn,
+// count the bytes each flush costs on the bus, and check the 25 us queue tick.
+
+#include <string.h>
+#include "lcd.h"
+#include "host/pico_sim.h"
+#include "host/test_common.h"
+
+#define HD44780_EXEC_NS 37000u
+#define HD44780_SLOW_EXEC_NS 1520000u
+#define HD44780_POWER_ON_NS 40000000u // Vcc to the first instruction
+#define HD44780_FIRST_SET_NS 4100000u // After the first 8-bit function set
+#define HD44780_SECOND_SET_NS 100000u // After the second
+#define HD44780_PULSE_MIN_NS 450u
+#define HD44780_DDRAM_SIZE 0x80
+
+// -----------------------------------------------------------------------------
+// HD44780 model
+// -----------------------------------------------------------------------------
+
+typedef struct
+{
+    bool pins[32];
+    bool four_bit;
+    int init_sets;         // 8-bit function sets seen (0x3 nibbles)
+    bool high_nibble_done; // 4-bit mode: the first half of a byte has been latched
+    uint8_t high_nibble;
+    uint64_t en_rise_ns;
+    uint64_t busy_until_ns;
+    uint64_t exec_start_ns; // When the last instruction was latched
+    bool last_slow;
+
+    uint8_t ddram[HD44780_DDRAM_SIZE];
+    uint8_t address;
+    bool display_on;
+    uint8_t function_set;
+    uint8_t entry_mode;
+
+    // What went over the bus
+    uint32_t bytes;
+    uint32_t commands;
+    uint32_t enable_pulses;
+
+    // Timing
+    uint32_t busy_violations; // Enable rose while the controller was still executing
+    uint32_t unstable_data;   // RS / D4-D7 changed while Enable was high
+    uint32_t short_pulses;    // Enable high for less than 450 ns
+    uint64_t min_gap_ns;      // Shortest execution time granted after an ordinary instruction
+    uint64_t min_slow_gap_ns; // ... after clear / home
+} hd44780_t;
+
+static hd44780_t lcd_model;
+
+static void model_reset(void)
+{
+    memset(&lcd_model, 0, sizeof(lcd_model));
+    memset(lcd_model.ddram, '?', sizeof(lcd_model.ddram)); // Power-on garbage
+    lcd_model.busy_until_ns = HD44780_POWER_ON_NS;
+    lcd_model.min_gap_ns = UINT64_MAX;
+    lcd_model.min_slow_gap_ns = UINT64_MAX;
+}
+
+// Two lines: 0x00-0x27, then 0x40-0x67
+static uint8_t model_next_address(uint8_t address)
+{
+    if (address == 0x27)
+        return 0x40;
+    if (address == 0x67)
+        return 0x00;
+    return (uint8_t)(address + 1);
+}
+
+static void model_execute(uint8_t value, bool data, uint64_t now_ns)
+{
+    bool slow = false;
+
+    lcd_model.bytes++;
+    if (data)
+    {
+        lcd_model.ddram[lcd_model.address] = value;
+        lcd_model.address = model_next_address(lcd_model.address);
+    }
+    else
+    {
+        lcd_model.commands++;
+        if (value == 0x01)
+        {
+            memset(lcd_model.ddram, ' ', sizeof(lcd_model.ddram));
+            lcd_model.address = 0;
+            slow = true;
+        }
+        else if ((value & 0xFE) == 0x02)
+        {
+            lcd_model.address = 0;
+            slow = true;
+        }
+        else if (value & 0x80)
+            lcd_model.address = value & 0x7F;
+        else if (value & 0x20)
+            lcd_model.function_set = value;
+        else if (value & 0x08)
+            lcd_model.display_on = (value & 0x04) != 0;
+        else if (value & 0x04)
+            lcd_model.entry_mode = value;
+    }
+    lcd_model.exec_start_ns = now_ns;
+    lcd_model.last_slow = slow;
+    lcd_model.busy_until_ns = now_ns + (slow ? HD44780_SLOW_EXEC_NS : HD44780_EXEC_NS);
+}
+
+// 8-bit mode during the reset sequence: only D7-D4 are wired, one nibble per instruction
+static void model_execute_init(uint8_t nibble, uint64_t now_ns)
+{
+    if (nibble == 0x3)
+    {
+        lcd_model.init_sets++;
+        lcd_model.busy_until_ns = now_ns + (lcd_model.init_sets == 1 ? HD44780_FIRST_SET_NS : HD44780_SECOND_SET_NS);
+    }
+    else if (nibble == 0x2)
+    {
+        lcd_model.four_bit = true;
+        lcd_model.busy_until_ns = now_ns + HD44780_EXEC_NS;
+    }
+    lcd_model.exec_start_ns = now_ns;
+    lcd_model.last_slow = false;
+}
+
+static void model_gpio_put(uint gpio, bool value)
+{
+    const uint64_t now = sim_now_ns();
+    const bool was = lcd_model.pins[gpio];
+    lcd_model.pins[gpio] = value;
+
+    if (gpio != LCD_PIN_EN)
+    {
+        if (lcd_model.pins[LCD_PIN_EN] && was != value && gpio <= LCD_PIN_D7)
+            lcd_model.unstable_data++;
+        return;
+    }
+
+    if (value && !was)
+    {
+        lcd_model.en_rise_ns = now;
+        lcd_model.enable_pulses++;
+        if (now < lcd_model.busy_until_ns)
+            lcd_model.busy_violations++;
+        // A new instruction starts: how long did the last one get?
+        if (!lcd_model.high_nibble_done && lcd_model.four_bit && lcd_model.exec_start_ns)
+        {
+            const uint64_t gap = now - lcd_model.exec_start_ns;
+            uint64_t *min = lcd_model.last_slow ? &lcd_model.min_slow_gap_ns : &lcd_model.min_gap_ns;
+            if (gap < *min)
+                *min = gap;
+        }
+    }
+    else if (!value && was)
+    {
+        if (now - lcd_model.en_rise_ns < HD44780_PULSE_MIN_NS)
+            lcd_model.short_pulses++;
+
+        const uint8_t nibble = (uint8_t)(lcd_model.pins[LCD_PIN_D4] | (lcd_model.pins[LCD_PIN_D5] << 1) |
+                                         (lcd_model.pins[LCD_PIN_D6] << 2) | (lcd_model.pins[LCD_PIN_D7] << 3));
+        if (!lcd_model.four_bit)
+            model_execute_init(nibble, now);
+        else if (!lcd_model.high_nibble_done)
+        {
+            lcd_model.high_nibble = nibble;
+            lcd_model.high_nibble_done = true;
+        }
+        else
+        {
+            lcd_model.high_nibble_done = false;
+            model_execute((uint8_t)((lcd_model.high_nibble << 4) | nibble), lcd_model.pins[LCD_PIN_RS], now);
+        }
+    }
+}
+
+// What the 16x2 window shows
+static void model_screen(char out[LCD_ROWS][LCD_COLS])
+{
+    for (int row = 0; row < LCD_ROWS; row++)
+        memcpy(out[row], &lcd_model.ddram[row ? 0x40 : 0x00], LCD_COLS);
+}
+
+// -----------------------------------------------------------------------------
+// Expected screen, drawn alongside the driver's framebuffer
+// -----------------------------------------------------------------------------
+
+static char expected[LCD_ROWS][LCD_COLS];
+
+static void draw(int row, int col, const char *s)
+{
+    lcd_set_cursor(row, col);
+    lcd_string(s);
+    for (; *s && col < LCD_COLS; s++, col++)
+        expected[row][col] = *s;
+}
+
+static void draw_clear(void)
+{
+    lcd_clear();
+    memset(expected, ' ', sizeof(expected));
+}
+
+// Cells where the display differs from what was drawn
+static int screen_diff(void)
+{
+    char shown[LCD_ROWS][LCD_COLS];
+    int cells = 0;
+
+    model_screen(shown);
+    for (int row = 0; row < LCD_ROWS; row++)
+        for (int col = 0; col < LCD_COLS; col++)
+            cells += shown[row][col] != expected[row][col];
+    return cells;
+}
+
+// Flush and let the queue drain; returns the bytes that went over the bus
+static uint32_t flush_and_wait(int *queued)
+{
+    const uint32_t before = lcd_model.bytes;
+    *queued = lcd_flush();
+    lcd_wait();
+    return lcd_model.bytes - before;
+}
+
+static uint32_t rng_state = 4242u;
+static uint32_t rng_next(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+static void test_init(void)
+{
+    lcd_init();
+
+    TEST_CHECK(lcd_model.four_bit && lcd_model.init_sets == 3);
+    TEST_CHECK(lcd_model.function_set == 0x28 && lcd_model.entry_mode == 0x06 && lcd_model.display_on);
+    TEST_CHECK(lcd_model.address == 0x00);
+    // The hardware clear wiped the power-on garbage, and the framebuffer agrees
+    memset(expected, ' ', sizeof(expected));
+    TEST_CHECK(screen_diff() == 0);
+    TEST_CHECK(lcd_model.min_slow_gap_ns >= HD44780_SLOW_EXEC_NS);
+    TEST_CHECK(!lcd_busy());
+}
+
+// Only changed cells go out, with an address command only where the cursor is not already
+static void test_framebuffer_diff(void)
+{
+    int queued;
+
+    draw_clear();
+    draw(0, 0, "Treasure");
+    draw(1, 0, "Acc:  45.3%");
+    TEST_CHECK(flush_and_wait(&queued) == (uint32_t)queued);
+    // Row 0 starts where the cursor already is; the blanks in row 1 are already shown,
+    // so it is two runs with an address each: 8 + (1 + 4) + (1 + 5)
+    TEST_CHECK_MSG(queued == 19, "%d", queued);
+    TEST_CHECK(screen_diff() == 0);
+
+    // Same screen again: nothing on the bus at all
+    const uint32_t pulses = lcd_model.enable_pulses;
+    draw(0, 0, "Treasure");
+    draw(1, 0, "Acc:  45.3%");
+    TEST_CHECK(flush_and_wait(&queued) == 0 && queued == 0);
+    TEST_CHECK(lcd_model.enable_pulses == pulses);
+
+    // One digit: its address and the character
+    draw(1, 9, "4");
+    TEST_CHECK(flush_and_wait(&queued) == 2 && queued == 2);
+    TEST_CHECK(screen_diff() == 0);
+
+    // Two adjacent digits share one address command
+    draw(1, 7, "60");
+    TEST_CHECK(flush_and_wait(&queued) == 3);
+    TEST_CHECK(screen_diff() == 0);
+
+    // Characters past the last column are dropped, not written to the hidden DDRAM
+    draw(1, 14, "xyz");
+    TEST_CHECK(flush_and_wait(&queued) == 3 && screen_diff() == 0);
+    TEST_CHECK(lcd_model.ddram[0x50] == ' ');
+
+    // Random edits: the display always matches, at a fraction of full redraws
+    uint32_t bus_bytes = 0, full_redraw_bytes = 0;
+    int mismatches = 0, miscounted = 0;
+    for (int frame = 0; frame < 500; frame++)
+    {
+        if (rng_next() % 50u == 0)
+            draw_clear();
+        const int edits = (int)(rng_next() % 4u);
+        for (int i = 0; i < edits; i++)
+        {
+            char text[2] = {(char)(' ' + rng_next() % 95u), '\0'};
+            draw((int)(rng_next() % LCD_ROWS), (int)(rng_next() % LCD_COLS), text);
+        }
+        const uint32_t bytes = flush_and_wait(&queued);
+        miscounted += bytes != (uint32_t)queued;
+        mismatches += screen_diff() != 0;
+        bus_bytes += bytes;
+        full_redraw_bytes += LCD_ROWS * (LCD_COLS + 1);
+    }
+    printf("500 frames: %u bytes on the bus (a full redraw every frame: %u)\n", (unsigned)bus_bytes,
+           (unsigned)full_redraw_bytes);
+    TEST_CHECK(mismatches == 0 && miscounted == 0);
+    TEST_CHECK(bus_bytes * 4 < full_redraw_bytes);
+}
+
+// A full queue defers the rest to the next flush instead of waiting; nothing is lost
+static void test_queue_full(void)
+{
+    int queued, first, second;
+    const uint32_t deferred = lcd_deferred_count();
+
+    draw_clear();
+    flush_and_wait(&queued);
+    draw(0, 0, "0123456789abcdef");
+    draw(1, 0, "0123456789abcdef");
+    first = lcd_flush();
+    draw(0, 0, "ABCDEFGHIJKLMNOP");
+    draw(1, 0, "ABCDEFGHIJKLMNOP");
+    second = lcd_flush(); // Without waiting: the queue still holds most of the first
+    TEST_CHECK_MSG(first >= 33 && second > 0 && second < 33, "%d then %d", first, second);
+    TEST_CHECK(lcd_deferred_count() == deferred + 1);
+
+    lcd_wait();
+    TEST_CHECK(screen_diff() != 0); // The deferred cells are still in the framebuffer only
+    flush_and_wait(&queued);
+    TEST_CHECK(queued > 0 && screen_diff() == 0);
+}
+
+// lcd_flush never sleeps; the 25 us tick clocks each byte out in 6 ticks, giving every
+// instruction more than its 37 us and never touching the data lines while Enable is high
+static void test_timing(void)
+{
+    draw_clear();
+    draw(0, 0, "Timing 1234");
+    draw(1, 0, "Tick 25us");
+
+    const uint64_t t0 = sim_now_ns();
+    const uint32_t bytes0 = lcd_model.bytes;
+    const int queued = lcd_flush();
+    TEST_CHECK(sim_now_ns() == t0);
+    TEST_CHECK(lcd_busy());
+
+    lcd_wait();
+    const uint64_t drained_ns = sim_now_ns() - t0;
+    const uint32_t bytes = lcd_model.bytes - bytes0;
+    printf("%u bytes drained in %llu us (%llu us per byte); shortest execution time granted %llu us, "
+           "after clear %llu us\n",
+           (unsigned)bytes, (unsigned long long)(drained_ns / 1000u),
+           (unsigned long long)(drained_ns / 1000u / (bytes ? bytes : 1)),
+           (unsigned long long)(lcd_model.min_gap_ns / 1000u), (unsigned long long)(lcd_model.min_slow_gap_ns / 1000u));
+    TEST_CHECK(bytes == (uint32_t)queued && screen_diff() == 0);
+    // Four bus steps per byte, then Enable rises again once 37 us (at least two ticks) have passed
+    uint32_t exec_ticks = (HD44780_EXEC_NS / 1000u + LCD_QUEUE_TICK_US - 1) / LCD_QUEUE_TICK_US;
+    if (exec_ticks < 2)
+        exec_ticks = 2;
+    TEST_CHECK(drained_ns <= ((uint64_t)bytes * (4u + exec_ticks) + 2u) * LCD_QUEUE_TICK_US * 1000u);
+
+    TEST_CHECK(lcd_model.min_gap_ns >= HD44780_EXEC_NS);
+    TEST_CHECK(lcd_model.min_slow_gap_ns >= HD44780_SLOW_EXEC_NS);
+    TEST_CHECK(lcd_model.busy_violations == 0);
+    TEST_CHECK(lcd_model.unstable_data == 0);
+    TEST_CHECK(lcd_model.short_pulses == 0);
+    TEST_CHECK(!lcd_model.high_nibble_done); // Never left half a byte on the bus
+}
+
+int main(void)
+{
+    sim_reset();
+    model_reset();
+    sim_set_gpio_put_hook(model_gpio_put);
+
+    test_init();
+    test_framebuffer_diff();
+    test_queue_full();
+    test_timing();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,120 @@
+// Stage timing (loop_stats.c): histogram buckets and the /stats JSON, then a second
+// thread recording a stage while this one formats it, as core 1 records POTS and
+// SENSOR while /stats runs on core 0. Every snapshot has to be one whole update:
+// count, total and histogram from the same moment.
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "loop_stats.h"
+#include "host/test_common.h"
+
+#define CONCURRENT_RECORDS 2000000u
+// Every concurrent run takes exactly this long, so any consistent snapshot averages it
+#define CONCURRENT_US 1000u
+
+static volatile bool writer_done = false;
+
+static unsigned long json_field(const char *json, const char *stage, const char *field)
+{
+    char key[32];
+    snprintf(key, sizeof(key), "\"%s\":{", stage);
+    const char *at = strstr(json, key);
+    if (!at)
+        return (unsigned long)-1;
+    snprintf(key, sizeof(key), "\"%s\":", field);
+    at = strstr(at, key);
+    return at ? strtoul(at + strlen(key), NULL, 10) : (unsigned long)-1;
+}
+
+// Sum of one stage's histogram
+static unsigned long json_hist_sum(const char *json, const char *stage)
+{
+    char key[32];
+    snprintf(key, sizeof(key), "\"%s\":{", stage);
+    const char *at = strstr(json, key);
+    at = at ? strstr(at, "\"hist\":[") : NULL;
+    if (!at)
+        return (unsigned long)-1;
+
+    unsigned long sum = 0;
+    char *end = (char *)at + 8;
+    for (int i = 0; i < LOOP_STATS_BUCKETS; i++)
+    {
+        sum += strtoul(end, &end, 10);
+        if (*end == ',')
+            end++;
+    }
+    return sum;
+}
+
+static void test_buckets(void)
+{
+    static char json[2048];
+
+    loop_stats_init();
+    TEST_CHECK(loop_stats_bucket_limit_us(0) == LOOP_STATS_FIRST_BUCKET_US);
+    TEST_CHECK(loop_stats_bucket_limit_us(1) == 2 * LOOP_STATS_FIRST_BUCKET_US);
+    TEST_CHECK(loop_stats_bucket_limit_us(LOOP_STATS_BUCKETS - 1) == 0);
+
+    // Each run lands in the bucket whose limit it is below
+    loop_stats_record(LOOP_STAGE_MOTOR, 0);
+    loop_stats_record(LOOP_STAGE_MOTOR, 15);
+    loop_stats_record(LOOP_STAGE_MOTOR, 16);
+    loop_stats_record(LOOP_STAGE_MOTOR, 250);
+    loop_stats_record(LOOP_STAGE_MOTOR, 4000000000u);
+    loop_stats_format_json(json, sizeof(json));
+    TEST_CHECK(strstr(json, "\"motor\":{\"count\":5,") != NULL);
+    TEST_CHECK(strstr(json, "\"hist\":[2,1,0,0,1,0,0,0,0,0,0,1]") != NULL);
+    TEST_CHECK(json_field(json, "motor", "max_us") == 4000000000ul);
+    TEST_CHECK(json_field(json, "motor", "overruns") == 2);
+    TEST_CHECK(json_field(json, "lcd", "count") == 0);
+
+    loop_stats_init();
+    loop_stats_format_json(json, sizeof(json));
+    TEST_CHECK(json_field(json, "motor", "count") == 0);
+}
+
+static void *writer_main(void *arg)
+{
+    (void)arg;
+    for (uint32_t i = 0; i < CONCURRENT_RECORDS; i++)
+        loop_stats_record(LOOP_STAGE_POTS, CONCURRENT_US);
+    writer_done = true;
+    return NULL;
+}
+
+static void test_concurrent_format(void)
+{
+    static char json[2048];
+    pthread_t writer;
+    uint32_t snapshots = 0, torn = 0;
+
+    loop_stats_init();
+    pthread_create(&writer, NULL, writer_main, NULL);
+    while (!writer_done)
+    {
+        loop_stats_format_json(json, sizeof(json));
+        snapshots++;
+
+        const unsigned long count = json_field(json, "pots", "count");
+        const unsigned long avg = json_field(json, "pots", "avg_us");
+        if ((count != 0 && avg != CONCURRENT_US) || json_hist_sum(json, "pots") != count)
+            torn++;
+    }
+    pthread_join(writer, NULL);
+
+    loop_stats_format_json(json, sizeof(json));
+    printf("/stats read %u times while a stage was recorded: %u torn\n", (unsigned)snapshots, (unsigned)torn);
+    TEST_CHECK(snapshots > 0 && torn == 0);
+    TEST_CHECK(json_field(json, "pots", "count") == CONCURRENT_RECORDS);
+    TEST_CHECK(json_field(json, "pots", "avg_us") == CONCURRENT_US);
+}
+
+int main(void)
+{
+    test_buckets();
+    test_concurrent_format();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,184 @@
+// pot_model (recursive least squares from knob positions to sensor Hz): convergence on
+// a simulated LED/sensor plant, the readiness gate at POT_MODEL_MAX_ERROR_HZ, and
+// prediction error when the knobs move between samples, and a long run that must not
+// lose the fit to float rounding. The host time per update is
+// printed for reference; on the board, /stats reports it as the "model" stage.
+
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+#include "pot_model.h"
+#include "potentiometer_led.h"
+#include "host/test_common.h"
+
+static uint32_t rng_state = 7u;
+static uint32_t rng_next(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+// Symmetric noise of up to +/- `amplitude`
+static double noise(double amplitude)
+{
+    return amplitude * ((double)(rng_next() % 2001u) / 1000.0 - 1.0);
+}
+
+// Plant: each LED mostly drives its own channel, with some crosstalk and ambient light.
+// `noise_frac` is the reading noise as a fraction of the reading.
+static void plant(const uint16_t pots[3], double noise_frac, uint32_t hz[3])
+{
+    const double p[3] = {pots[0] / 4096.0, pots[1] / 4096.0, pots[2] / 4096.0};
+    const double clean[3] = {
+        300.0 + 1800.0 * p[0] + 150.0 * p[1] + 60.0 * p[2],
+        250.0 + 120.0 * p[0] + 1500.0 * p[1] + 90.0 * p[2],
+        400.0 + 80.0 * p[0] + 110.0 * p[1] + 2000.0 * p[2],
+    };
+    for (int c = 0; c < 3; c++)
+        hz[c] = (uint32_t)fmax(0.0, clean[c] * (1.0 + noise(noise_frac)));
+}
+
+// The player turning the knobs: a random walk clamped to the ADC range
+static void turn_knobs(uint16_t pots[3], int step)
+{
+    for (int i = 0; i < 3; i++)
+    {
+        int v = (int)pots[i] + (int)(rng_next() % (2u * step + 1u)) - step;
+        pots[i] = (uint16_t)(v < 0 ? 0 : (v > ADC_MAX_VALUE ? ADC_MAX_VALUE : v));
+    }
+}
+
+static void test_convergence(void)
+{
+    uint16_t pots[3] = {1000, 2000, 3000};
+    uint32_t hz[3];
+    int ready_at = -1;
+
+    pot_model_init();
+    TEST_CHECK(!pot_model_ready());
+
+    for (int n = 0; n < 300; n++)
+    {
+        turn_knobs(pots, 300);
+        plant(pots, 0.005, hz);
+        pot_model_update(pots, hz);
+        if (ready_at < 0 && pot_model_ready())
+            ready_at = n + 1;
+    }
+    printf("convergence: ready after %d samples, running error %u Hz (limit %u)\n", ready_at,
+           (unsigned)pot_model_error_hz(), (unsigned)POT_MODEL_MAX_ERROR_HZ);
+    TEST_CHECK(ready_at >= POT_MODEL_MIN_UPDATES && ready_at <= 100);
+    TEST_CHECK(pot_model_ready());
+
+    // Between samples: predict readings for knob positions the model has not seen yet
+    double worst = 0.0, total = 0.0;
+    for (int n = 0; n < 1000; n++)
+    {
+        uint16_t moved[3] = {pots[0], pots[1], pots[2]};
+        uint32_t predicted[3], actual[3];
+        turn_knobs(moved, 400);
+        pot_model_predict(moved, predicted);
+        plant(moved, 0.0, actual);
+        for (int c = 0; c < 3; c++)
+        {
+            const double rel = fabs((double)predicted[c] - actual[c]) / actual[c];
+            total += rel;
+            if (rel > worst)
+                worst = rel;
+        }
+    }
+    printf("prediction: mean %.2f %%, worst %.2f %% off the noise-free reading\n", 100.0 * total / 3000.0,
+           100.0 * worst);
+    // Inside the 3 % success margin the estimate is steering the player through
+    TEST_CHECK(worst < 0.03);
+}
+
+// A plant the linear model cannot follow (noisy, non-linear) must not be trusted
+static void test_untrusted_model(void)
+{
+    uint16_t pots[3] = {2000, 2000, 2000};
+    uint32_t hz[3];
+
+    pot_model_init();
+    for (int n = 0; n < 300; n++)
+    {
+        turn_knobs(pots, 600);
+        plant(pots, 0.08, hz); // 8 % reading noise
+        pot_model_update(pots, hz);
+    }
+    printf("noisy plant: running error %u Hz -> %s\n", (unsigned)pot_model_error_hz(),
+           pot_model_ready() ? "trusted" : "not trusted");
+    TEST_CHECK(!pot_model_ready());
+
+    // Nothing learned yet: nothing predicted
+    pot_model_init();
+    uint32_t predicted[3];
+    pot_model_predict(pots, predicted);
+    TEST_CHECK(predicted[0] == 0 && predicted[1] == 0 && predicted[2] == 0);
+}
+
+// Minutes of play: once trusted, the model stays trusted (the covariance stays sane)
+static void test_long_run(void)
+{
+    uint16_t pots[3] = {1000, 2000, 3000};
+    uint32_t hz[3];
+    int ready_at = -1, lost_at = -1;
+
+    pot_model_init();
+    for (int n = 0; n < 50000 && lost_at < 0; n++)
+    {
+        turn_knobs(pots, 300);
+        plant(pots, 0.005, hz);
+        pot_model_update(pots, hz);
+        if (pot_model_ready() && ready_at < 0)
+            ready_at = n;
+        else if (!pot_model_ready() && ready_at >= 0)
+            lost_at = n;
+    }
+    printf("long run: ready after %d samples, %s\n", ready_at, lost_at < 0 ? "never lost" : "lost");
+    TEST_CHECK_MSG(ready_at >= 0 && lost_at < 0, "lost at sample %d", lost_at);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void bench(void)
+{
+    enum { SAMPLES = 1024, ROUNDS = 1000 };
+    static uint16_t pots[SAMPLES][3];
+    static uint32_t hz[SAMPLES][3];
+    uint16_t knobs[3] = {1000, 2000, 3000};
+
+    for (int n = 0; n < SAMPLES; n++)
+    {
+        turn_knobs(knobs, 300);
+        plant(knobs, 0.005, hz[n]);
+        for (int i = 0; i < 3; i++)
+            pots[n][i] = knobs[i];
+    }
+
+    pot_model_init();
+    const double t0 = now_s();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        for (int n = 0; n < SAMPLES; n++)
+            pot_model_update(pots[n], hz[n]);
+    }
+    const double update_ns = (now_s() - t0) * 1e9 / ((double)SAMPLES * ROUNDS);
+    printf("bench (host): %.1f ns per update\n", update_ns);
+    TEST_CHECK(pot_model_ready());
+}
+
+int main(void)
+{
+    test_convergence();
+    test_untrusted_model();
+    test_long_run();
+    bench();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,283 @@
+// sample_ring (SPSC hand-off from core 1) and sample_filter (median + EMA + variance):
+// behaviour checks, a two-thread ring stress test and per-call timings.
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sample_filter.h"
+#include "sample_ring.h"
+#include "host/test_common.h"
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Deterministic noise for the filter inputs
+static uint32_t rng_state = 12345u;
+static uint32_t rng_next(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+// -----------------------------------------------------------------------------
+// sample_filter
+// -----------------------------------------------------------------------------
+
+static void test_filter_median_and_ema(void)
+{
+    sample_filter_t f;
+    sample_filter_init(&f);
+
+    // One wild gate among steady readings never reaches the output
+    static const uint32_t readings[] = {1000, 1010, 5000, 990, 1005, 1000, 20, 1002, 998};
+    for (size_t i = 0; i < sizeof(readings) / sizeof(readings[0]); i++)
+    {
+        sample_filter_update(&f, readings[i]);
+        TEST_CHECK(sample_filter_value(&f) >= 990 && sample_filter_value(&f) <= 1010);
+    }
+    TEST_CHECK(sample_filter_median(&f) == 1000);
+
+    // A step is followed within a few time constants of the EMA
+    for (int i = 0; i < 40; i++)
+        sample_filter_update(&f, 2000);
+    TEST_CHECK(sample_filter_value(&f) >= 1995 && sample_filter_value(&f) <= 2000);
+}
+
+// Running sums agree with a two-pass computation over the same window
+static void test_filter_variance(void)
+{
+    sample_filter_t f;
+    sample_filter_init(&f);
+    uint32_t window[SAMPLE_FILTER_WINDOW];
+    unsigned worst = 0;
+
+    for (int i = 0; i < 100000; i++)
+    {
+        const uint32_t hz = (i % 1000 < 500) ? 1000u + rng_next() % 64u : 300000u + rng_next() % 20000u;
+        window[i % SAMPLE_FILTER_WINDOW] = hz;
+        sample_filter_update(&f, hz);
+        if (i + 1 < SAMPLE_FILTER_WINDOW)
+            continue;
+
+        double mean = 0.0, var = 0.0;
+        for (int k = 0; k < SAMPLE_FILTER_WINDOW; k++)
+            mean += window[k];
+        mean /= SAMPLE_FILTER_WINDOW;
+        for (int k = 0; k < SAMPLE_FILTER_WINDOW; k++)
+            var += (window[k] - mean) * (window[k] - mean);
+        var /= SAMPLE_FILTER_WINDOW - 1;
+
+        const double expected = var > UINT32_MAX ? (double)UINT32_MAX : var;
+        const double diff = fabs((double)sample_filter_variance(&f) - expected);
+        if (diff > worst)
+            worst = (unsigned)diff;
+        TEST_CHECK_MSG(diff <= 1.0, "variance %u vs %.1f", (unsigned)sample_filter_variance(&f), expected);
+    }
+    printf("filter variance: worst difference from two-pass %u Hz^2\n", worst);
+}
+
+static void test_filter_settled(void)
+{
+    sample_filter_t f;
+    sample_filter_init(&f);
+
+    // Not settled until the window is full, even if perfectly steady
+    for (int i = 0; i < SAMPLE_FILTER_WINDOW - 1; i++)
+    {
+        sample_filter_update(&f, 1200);
+        TEST_CHECK(!sample_filter_settled(&f));
+    }
+    sample_filter_update(&f, 1200);
+    TEST_CHECK(sample_filter_settled(&f));
+
+    // +/- 1 % noise is settled, a knob sweep is not
+    for (int i = 0; i < 20; i++)
+        sample_filter_update(&f, 1188u + rng_next() % 25u);
+    TEST_CHECK(sample_filter_settled(&f));
+
+    for (uint32_t hz = 800; hz < 1600; hz += 80)
+        sample_filter_update(&f, hz);
+    TEST_CHECK(!sample_filter_settled(&f));
+
+    // A dark window (median 0) only settles with no spread at all
+    sample_filter_init(&f);
+    for (int i = 0; i < SAMPLE_FILTER_WINDOW; i++)
+        sample_filter_update(&f, 0);
+    TEST_CHECK(sample_filter_settled(&f));
+}
+
+// -----------------------------------------------------------------------------
+// sample_ring
+// -----------------------------------------------------------------------------
+
+static color_sample_t make_sample(uint32_t seq)
+{
+    color_sample_t s = {0};
+    s.timestamp_us = seq;
+    s.r_hz = seq * 3u;
+    s.g_hz = seq * 5u;
+    s.b_hz = seq * 7u;
+    s.pots[0] = (uint16_t)seq;
+    return s;
+}
+
+static bool sample_consistent(const color_sample_t *s)
+{
+    const uint32_t seq = s->timestamp_us;
+    return s->r_hz == seq * 3u && s->g_hz == seq * 5u && s->b_hz == seq * 7u && s->pots[0] == (uint16_t)seq;
+}
+
+static void test_ring_basic(void)
+{
+    static sample_ring_t ring;
+    color_sample_t out;
+    sample_ring_init(&ring);
+
+    TEST_CHECK(!sample_ring_pop(&ring, &out));
+
+    // Fill, overflow, drain in order
+    for (uint32_t i = 0; i < SAMPLE_RING_SIZE; i++)
+    {
+        const color_sample_t s = make_sample(i);
+        TEST_CHECK(sample_ring_push(&ring, &s));
+    }
+    const color_sample_t extra = make_sample(99);
+    TEST_CHECK(!sample_ring_push(&ring, &extra));
+    TEST_CHECK(ring.dropped == 1);
+    TEST_CHECK(sample_ring_count(&ring) == SAMPLE_RING_SIZE);
+
+    for (uint32_t i = 0; i < SAMPLE_RING_SIZE; i++)
+    {
+        TEST_CHECK(sample_ring_pop(&ring, &out));
+        TEST_CHECK(out.timestamp_us == i && sample_consistent(&out));
+    }
+    TEST_CHECK(sample_ring_count(&ring) == 0);
+
+    // Free-running indices wrap through UINT32_MAX without losing the count
+    ring.head = ring.tail = UINT32_MAX - 3u;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        const color_sample_t s = make_sample(i);
+        TEST_CHECK(sample_ring_push(&ring, &s));
+    }
+    TEST_CHECK(sample_ring_count(&ring) == 8);
+    for (uint32_t i = 0; i < 8; i++)
+        TEST_CHECK(sample_ring_pop(&ring, &out) && out.timestamp_us == i);
+}
+
+// One producer and one consumer thread, as core 1 and core 0 use it
+#define STRESS_SAMPLES 200000u
+
+static sample_ring_t stress_ring;
+
+static void *stress_producer(void *arg)
+{
+    (void)arg;
+    for (uint32_t seq = 1; seq <= STRESS_SAMPLES; seq++)
+    {
+        const color_sample_t s = make_sample(seq);
+        while (!sample_ring_push(&stress_ring, &s))
+            sched_yield(); // Full: retry (the firmware drops instead)
+    }
+    return NULL;
+}
+
+static void test_ring_threads(void)
+{
+    pthread_t producer;
+    color_sample_t out;
+    uint32_t expected = 1, torn = 0, out_of_order = 0;
+
+    sample_ring_init(&stress_ring);
+    const double t0 = now_s();
+    pthread_create(&producer, NULL, stress_producer, NULL);
+
+    while (expected <= STRESS_SAMPLES)
+    {
+        if (!sample_ring_pop(&stress_ring, &out))
+        {
+            sched_yield();
+            continue;
+        }
+        if (!sample_consistent(&out))
+            torn++;
+        if (out.timestamp_us != expected)
+            out_of_order++;
+        expected = out.timestamp_us + 1u;
+    }
+    pthread_join(producer, NULL);
+    const double elapsed = now_s() - t0;
+
+    printf("ring threads: %u samples, %u torn, %u out of order, %u full retries, %.0f ns per hand-off\n",
+           STRESS_SAMPLES, (unsigned)torn, (unsigned)out_of_order, (unsigned)stress_ring.dropped,
+           elapsed * 1e9 / STRESS_SAMPLES);
+    TEST_CHECK(torn == 0);
+    TEST_CHECK(out_of_order == 0);
+    TEST_CHECK(sample_ring_count(&stress_ring) == 0);
+}
+
+// -----------------------------------------------------------------------------
+// Timings
+// -----------------------------------------------------------------------------
+
+static void bench(void)
+{
+    const int iterations = 2000000;
+    static sample_filter_t filters[4];
+    static sample_ring_t ring;
+    color_sample_t s = make_sample(1), out;
+    volatile uint32_t sink = 0;
+
+    for (int c = 0; c < 4; c++)
+        sample_filter_init(&filters[c]);
+    double t0 = now_s();
+    for (int i = 0; i < iterations; i++)
+    {
+        const uint32_t hz = 1000u + rng_next() % 100u;
+        for (int c = 0; c < 4; c++)
+            sample_filter_update(&filters[c], hz + (uint32_t)c);
+        sink += sample_filter_value(&filters[0]);
+    }
+    const double filter_ns = (now_s() - t0) * 1e9 / iterations;
+
+    t0 = now_s();
+    for (int i = 0; i < iterations; i++)
+    {
+        for (int c = 0; c < 3; c++)
+            sink += sample_filter_settled(&filters[c]);
+    }
+    const double settled_ns = (now_s() - t0) * 1e9 / iterations;
+
+    sample_ring_init(&ring);
+    t0 = now_s();
+    for (int i = 0; i < iterations; i++)
+    {
+        s.timestamp_us = (uint32_t)i;
+        sample_ring_push(&ring, &s);
+        sample_ring_pop(&ring, &out);
+        sink += out.timestamp_us;
+    }
+    const double ring_ns = (now_s() - t0) * 1e9 / iterations;
+
+    printf("bench (host ns per sample): 4-channel filter update %.1f, settled check %.1f, ring push+pop %.1f\n",
+           filter_ns, settled_ns, ring_ns);
+    (void)sink;
+}
+
+int main(void)
+{
+    test_filter_median_and_ema();
+    test_filter_variance();
+    test_filter_settled();
+    test_ring_basic();
+    test_ring_threads();
+    bench();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,364 @@
+// Scheduler on a virtual clock: deadline order (ties in insertion order), no drift,
+// skipped periods after an overrun, the clock wrapping, one-shots and cancels from a
+// running task, idle time and the /stats JSON. Built a second time against the SDK
+// stubs, where a second thread reads /stats while the scheduler runs, as core 0 does
+// for core 1's scheduler.
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+#include "scheduler.h"
+#include "host/test_common.h"
+
+#ifndef SCHEDULER_HOST
+#include <pthread.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// Virtual clock: time only moves when a task "works" or the scheduler sleeps
+// -----------------------------------------------------------------------------
+
+static volatile uint32_t clock_us = 0;
+static uint32_t sleep_limit_us = 0; // scheduler_run returns (longjmp) at the first sleep past this
+static jmp_buf sleep_exit;
+
+static uint32_t virtual_now_us(void)
+{
+    return clock_us;
+}
+
+static void virtual_sleep_until_us(uint32_t deadline_us)
+{
+    if ((int32_t)(deadline_us - sleep_limit_us) > 0)
+        longjmp(sleep_exit, 1);
+    clock_us = deadline_us;
+}
+
+static const scheduler_clock_t virtual_clock = {virtual_now_us, virtual_sleep_until_us};
+
+// Run due tasks, jumping the clock to each next deadline, until `until_us` (wrap-safe)
+static void run_until(scheduler_t *sched, uint32_t until_us)
+{
+    while ((int32_t)(clock_us - until_us) < 0)
+    {
+        scheduler_run_due(sched);
+        const uint32_t next = sched->queue ? sched->queue->deadline_us : until_us;
+        if ((int32_t)(next - until_us) > 0)
+            clock_us = until_us;
+        else if ((int32_t)(next - clock_us) > 0)
+            clock_us = next;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Tasks: each appends its letter (and start time) to the trace and works for `cost`
+// -----------------------------------------------------------------------------
+
+typedef struct
+{
+    char letter;
+    uint32_t cost_us;
+    uint32_t starts[64];
+    int runs;
+} probe_t;
+
+static char trace[256];
+static int trace_len = 0;
+
+static void trace_reset(void)
+{
+    trace_len = 0;
+    trace[0] = '\0';
+}
+
+static void probe_run(void *arg)
+{
+    probe_t *probe = (probe_t *)arg;
+    if (probe->runs < 64)
+        probe->starts[probe->runs] = clock_us;
+    probe->runs++;
+    if (trace_len < (int)sizeof(trace) - 1)
+    {
+        trace[trace_len++] = probe->letter;
+        trace[trace_len] = '\0';
+    }
+    clock_us += probe->cost_us;
+}
+
+static scheduler_t sched;
+static scheduler_task_t task_a, task_b, task_c;
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+// Earliest deadline first; tasks due together run in the order they were added
+static void ordering_trace(uint32_t start_us, char *out, int size)
+{
+    probe_t a = {'a', 0, {0}, 0}, b = {'b', 0, {0}, 0}, c = {'c', 0, {0}, 0};
+
+    clock_us = start_us;
+    trace_reset();
+    scheduler_init(&sched, "test", &virtual_clock);
+    scheduler_add_periodic(&sched, &task_a, "a", probe_run, &a, 1000, 0);
+    scheduler_add_periodic(&sched, &task_b, "b", probe_run, &b, 1000, 0);
+    scheduler_add_periodic(&sched, &task_c, "c", probe_run, &c, 500, 250);
+    run_until(&sched, start_us + 3000);
+
+    snprintf(out, size, "%s", trace);
+    TEST_CHECK(task_a.max_jitter_us == 0 && task_b.max_jitter_us == 0 && task_c.max_jitter_us == 0);
+    TEST_CHECK(c.starts[0] == start_us + 250 && c.starts[1] == start_us + 750);
+}
+
+static void test_ordering(void)
+{
+    char plain[64], wrapped[64];
+
+    ordering_trace(0, plain, sizeof(plain));
+    TEST_CHECK_MSG(strcmp(plain, "abccabccabcc") == 0, "%s", plain);
+
+    // The same across the 32-bit wrap
+    ordering_trace(0xFFFFFC00u, wrapped, sizeof(wrapped));
+    TEST_CHECK_MSG(strcmp(wrapped, plain) == 0, "%s vs %s", wrapped, plain);
+}
+
+// Work delays the next task, never the grid: deadlines stay on multiples of the period
+static void test_no_drift(void)
+{
+    probe_t w = {'w', 300, {0}, 0}, x = {'x', 200, {0}, 0};
+
+    clock_us = 0;
+    scheduler_init(&sched, "test", &virtual_clock);
+    scheduler_add_periodic(&sched, &task_a, "w", probe_run, &w, 1000, 0);
+    scheduler_add_periodic(&sched, &task_b, "x", probe_run, &x, 1000, 0);
+    run_until(&sched, 50000);
+
+    bool on_grid = true;
+    for (int i = 0; i < 50; i++)
+        on_grid = on_grid && w.starts[i] == 1000u * i && x.starts[i] == 1000u * i + 300;
+    TEST_CHECK(on_grid);
+    TEST_CHECK(w.runs == 50 && x.runs == 50);
+    TEST_CHECK(task_b.max_jitter_us == 300 && task_b.total_jitter_us == 50 * 300);
+    TEST_CHECK(task_a.overruns == 0 && task_b.overruns == 0);
+    TEST_CHECK(task_a.deadline_us == 50000);
+}
+
+// A run that takes 2.5 periods: the task runs once, late, and the period that went by
+// entirely is skipped (and counted) so it is back on its grid straight after
+static void stall_run(void *arg)
+{
+    probe_t *probe = (probe_t *)arg;
+    probe->cost_us = (probe->runs == 2) ? 2500 : 10;
+    probe_run(arg);
+}
+
+static void test_overrun(void)
+{
+    probe_t s = {'s', 10, {0}, 0};
+
+    clock_us = 0;
+    scheduler_init(&sched, "test", &virtual_clock);
+    scheduler_add_periodic(&sched, &task_a, "s", stall_run, &s, 1000, 0);
+    run_until(&sched, 7000);
+
+    TEST_CHECK_MSG(s.runs == 6 && s.starts[2] == 2000 && s.starts[3] == 4500 && s.starts[4] == 5000 &&
+                       s.starts[5] == 6000,
+                   "%d runs, starts %u %u %u", s.runs, (unsigned)s.starts[3], (unsigned)s.starts[4],
+                   (unsigned)s.starts[5]);
+    TEST_CHECK(task_a.overruns == 1);
+    TEST_CHECK(task_a.max_jitter_us == 1500);
+
+    // One call only runs what was due when it started, however far behind a task is
+    probe_t slow = {'t', 250, {0}, 0};
+    clock_us = 0;
+    scheduler_init(&sched, "test", &virtual_clock);
+    scheduler_add_periodic(&sched, &task_a, "t", probe_run, &slow, 100, 0);
+    TEST_CHECK(scheduler_run_due(&sched) == 1);
+    TEST_CHECK(scheduler_run_due(&sched) == 1 && task_a.overruns == 1);
+}
+
+// One-shots run once; a task may cancel another, or re-arm itself, while it runs
+static probe_t canceller_probe = {'k', 0, {0}, 0};
+
+static void canceller_run(void *arg)
+{
+    probe_run(arg);
+    if (canceller_probe.runs == 3)
+        scheduler_cancel(&sched, &task_a);
+}
+
+static int rearms = 0;
+static void rearm_run(void *arg)
+{
+    (void)arg;
+    if (++rearms < 3)
+        scheduler_add_oneshot(&sched, &task_c, "r", rearm_run, NULL, 400);
+}
+
+static void test_oneshot_and_cancel(void)
+{
+    probe_t p = {'p', 0, {0}, 0}, o = {'o', 0, {0}, 0};
+
+    clock_us = 0;
+    canceller_probe.runs = 0;
+    trace_reset();
+    scheduler_init(&sched, "test", &virtual_clock);
+    scheduler_add_periodic(&sched, &task_a, "p", probe_run, &p, 100, 0);
+    scheduler_add_periodic(&sched, &task_b, "k", canceller_run, &canceller_probe, 100, 50);
+    run_until(&sched, 1000);
+    TEST_CHECK_MSG(strcmp(trace, "pkpkpkkkkkkkk") == 0, "%s", trace);
+    TEST_CHECK(!task_a.queued && p.runs == 3);
+
+    clock_us = 0;
+    scheduler_init(&sched, "test", &virtual_clock);
+    scheduler_add_oneshot(&sched, &task_a, "o", probe_run, &o, 500);
+    scheduler_add_oneshot(&sched, &task_c, "r", rearm_run, NULL, 100);
+    run_until(&sched, 5000);
+    TEST_CHECK(o.runs == 1 && o.starts[0] == 500 && !task_a.queued);
+    TEST_CHECK(rearms == 3 && !task_c.queued && sched.queue == NULL);
+
+    // Re-adding a queued one-shot moves it instead of queueing it twice
+    scheduler_add_oneshot(&sched, &task_a, "o", probe_run, &o, 100);
+    scheduler_add_oneshot(&sched, &task_a, "o", probe_run, &o, 300);
+    TEST_CHECK(sched.queue == &task_a && task_a.next == NULL && task_a.deadline_us == clock_us + 300);
+}
+
+// scheduler_run sleeps exactly to the next deadline and counts it as idle
+static void test_idle(void)
+{
+    probe_t w = {'w', 300, {0}, 0};
+
+    clock_us = 0;
+    scheduler_init(&sched, "test", &virtual_clock);
+    scheduler_add_periodic(&sched, &task_a, "w", probe_run, &w, 1000, 0);
+    sleep_limit_us = 9999;
+    if (!setjmp(sleep_exit))
+        scheduler_run(&sched);
+
+    // Ten runs; the sleeps between them are the other 700 us of each period but the last
+    TEST_CHECK(w.runs == 10);
+    TEST_CHECK_MSG(sched.idle_us == 9 * 700, "%u", (unsigned)sched.idle_us);
+}
+
+// Every task ever added is listed in the order it was added, finished one-shots included
+static void test_json(void)
+{
+    probe_t a = {'a', 100, {0}, 0}, b = {'b', 0, {0}, 0}, o = {'o', 0, {0}, 0};
+    char json[1024];
+
+    clock_us = 0;
+    scheduler_init(&sched, "test", &virtual_clock);
+    scheduler_add_periodic(&sched, &task_a, "a", probe_run, &a, 1000, 0);
+    scheduler_add_periodic(&sched, &task_b, "b", probe_run, &b, 1000, 0);
+    scheduler_add_oneshot(&sched, &task_c, "o", probe_run, &o, 10);
+    run_until(&sched, 10000);
+
+    const int len = scheduler_format_json(json, sizeof(json));
+    TEST_CHECK(len == (int)strlen(json));
+    TEST_CHECK_MSG(strstr(json, "\"test\":{\"uptime_us\":10000,\"idle_us\":0,\"tasks\":{"
+                                "\"a\":{\"period_us\":1000,\"runs\":10,\"avg_jitter_us\":0,\"max_jitter_us\":0,\"overruns\":0},"
+                                "\"b\":{\"period_us\":1000,\"runs\":10,\"avg_jitter_us\":100,\"max_jitter_us\":100,\"overruns\":0},"
+                                "\"o\":{\"period_us\":0,\"runs\":1,\"avg_jitter_us\":90,\"max_jitter_us\":90,\"overruns\":0}}}") != NULL,
+                   "%s", json);
+
+    // Truncation: never more than asked for, snprintf-style length
+    char small[24];
+    const int wanted = scheduler_format_json(small, sizeof(small));
+    TEST_CHECK(wanted >= (int)sizeof(small) && strlen(small) == sizeof(small) - 1);
+}
+
+#ifndef SCHEDULER_HOST
+// -----------------------------------------------------------------------------
+// /stats from another core
+// -----------------------------------------------------------------------------
+
+#define CONCURRENT_RUNS 400000
+
+static scheduler_t worker_sched;
+static scheduler_task_t worker_tasks[4];
+static volatile bool worker_done = false;
+
+static void worker_run(void *arg)
+{
+    const uint32_t cost = (uint32_t)(uintptr_t)arg;
+    clock_us += cost;
+    // A one-shot re-armed on every run keeps relinking the queue
+    scheduler_add_oneshot(&worker_sched, &worker_tasks[3], "oneshot", worker_run, (void *)(uintptr_t)1, 7);
+}
+
+static void *worker_main(void *arg)
+{
+    (void)arg;
+    for (uint32_t i = 0; i < CONCURRENT_RUNS; i++)
+    {
+        scheduler_run_due(&worker_sched);
+        if (worker_sched.queue && (int32_t)(worker_sched.queue->deadline_us - clock_us) > 0)
+            clock_us = worker_sched.queue->deadline_us;
+    }
+    worker_done = true;
+    return NULL;
+}
+
+static void test_concurrent_stats(void)
+{
+    static char json[2048];
+    pthread_t worker;
+    uint32_t snapshots = 0, missing = 0, inconsistent = 0;
+
+    clock_us = 0;
+    scheduler_init(&worker_sched, "worker", &virtual_clock);
+    scheduler_add_periodic(&worker_sched, &worker_tasks[0], "fast", worker_run, (void *)(uintptr_t)3, 10, 0);
+    scheduler_add_periodic(&worker_sched, &worker_tasks[1], "slow", worker_run, (void *)(uintptr_t)40, 50, 5);
+    scheduler_add_periodic(&worker_sched, &worker_tasks[2], "late", worker_run, (void *)(uintptr_t)25, 20, 0);
+    scheduler_add_oneshot(&worker_sched, &worker_tasks[3], "oneshot", worker_run, (void *)(uintptr_t)1, 7);
+    pthread_create(&worker, NULL, worker_main, NULL);
+
+    while (!worker_done)
+    {
+        scheduler_format_json(json, sizeof(json));
+        snapshots++;
+
+        // All four tasks, in the order they were added, every time
+        const char *worker_json = strstr(json, "\"worker\":");
+        const char *names[4] = {"\"fast\":", "\"slow\":", "\"late\":", "\"oneshot\":"};
+        const char *at = worker_json;
+        for (int i = 0; i < 4 && at; i++)
+            at = strstr(at, names[i]);
+        if (!worker_json || !at)
+        {
+            missing++;
+            continue;
+        }
+
+        // Each task copied in one piece: the average never exceeds the maximum
+        for (const char *p = strstr(worker_json, "\"avg_jitter_us\":"); p; p = strstr(p + 1, "\"avg_jitter_us\":"))
+        {
+            const unsigned long avg = strtoul(p + 16, NULL, 10);
+            const char *max = strstr(p, "\"max_jitter_us\":");
+            if (!max || avg > strtoul(max + 16, NULL, 10))
+                inconsistent++;
+        }
+    }
+    pthread_join(worker, NULL);
+
+    printf("/stats read %u times while the scheduler ran: %u missing tasks, %u inconsistent\n", (unsigned)snapshots,
+           (unsigned)missing, (unsigned)inconsistent);
+    TEST_CHECK(snapshots > 0 && missing == 0 && inconsistent == 0);
+    TEST_CHECK(worker_tasks[0].runs > 0 && worker_tasks[2].overruns > 0);
+}
+#endif
+
+int main(void)
+{
+    test_ordering();
+    test_no_drift();
+    test_overrun();
+    test_oneshot_and_cancel();
+    test_idle();
+    test_json();
+#ifndef SCHEDULER_HOST
+    test_concurrent_stats();
+#endif
+
+    return TEST_RESULT();
+}
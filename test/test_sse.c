@@ -0,0 +1,317 @@
+// /events on the simulated lwIP: pushes only on a change past the thresholds, at most
+// one per SSE_MIN_INTERVAL_MS, a subscriber that fell behind gets the latest state from
+// tcp_sent, a reader that stops ACKing is capped at SSE_MAX_UNACKED while others keep
+// streaming, and bytes on air and update latency against the 500 ms /data polling.
+
+#include <stdlib.h>
+#include <string.h>
+#include "wifi_server.h"
+#include "host/lwip_sim.h"
+#include "host/pico_sim.h"
+#include "host/test_common.h"
+
+// Mirrors of the /events settings in wifi_server.c
+#define SSE_MIN_DELTA_HZ 10
+#define SSE_MIN_DELTA_CORRECTNESS 5
+#define SSE_MIN_INTERVAL_MS 100
+#define SSE_MAX_UNACKED 512
+// Largest single event (wifi_server.c sse_send_event buffer)
+#define SSE_EVENT_MAX 224
+
+static int count(const char *haystack, const char *needle)
+{
+    int n = 0;
+    for (const char *p = haystack; (p = strstr(p, needle)) != NULL; p++)
+        n++;
+    return n;
+}
+
+static void advance_ms(uint32_t ms)
+{
+    sim_advance_ns((uint64_t)ms * 1000000ull);
+}
+
+static void ack_all(struct tcp_pcb *pcb)
+{
+    while (lwip_sim_state(pcb) == LWIP_SIM_OPEN && lwip_sim_unacked(pcb))
+        lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+}
+
+// Red channel of the last event (or JSON document) in the output, -1 if there is none
+static int last_r(const struct tcp_pcb *pcb)
+{
+    const char *out = lwip_sim_output(pcb, NULL);
+    const char *last = NULL;
+    for (const char *p = out; (p = strstr(p, "{\"r\":")) != NULL; p++)
+        last = p;
+    return last ? atoi(last + 5) : -1;
+}
+
+// Open /events and read the response header and the first event
+static struct tcp_pcb *subscribe(void)
+{
+    struct tcp_pcb *pcb = lwip_sim_connect();
+    lwip_sim_recv_str(pcb, "GET /events HTTP/1.1\r\nAccept: text/event-stream\r\n\r\n", 0);
+    const char *out = lwip_sim_output(pcb, NULL);
+    TEST_CHECK(strstr(out, "Content-Type: text/event-stream\r\n") != NULL);
+    TEST_CHECK(strstr(out, "retry: 2000\n\n") != NULL);
+    TEST_CHECK(count(out, "data: ") == 1);
+    ack_all(pcb);
+    lwip_sim_clear_output(pcb);
+    return pcb;
+}
+
+// One sensor update, then how many events the subscriber got from it
+static int push(struct tcp_pcb *pcb, uint16_t r, uint16_t g, uint16_t b, uint16_t correctness)
+{
+    lwip_sim_clear_output(pcb);
+    wifi_update_data(r, g, b, correctness);
+    ack_all(pcb);
+    return count(lwip_sim_output(pcb, NULL), "data: ");
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+static void test_thresholds(void)
+{
+    lwip_sim_reset();
+    struct tcp_pcb *pcb = subscribe();
+    advance_ms(1000);
+    push(pcb, 1000, 2000, 3000, 500); // Baseline
+
+    // Each channel only counts once it moved SSE_MIN_DELTA_HZ from what was last pushed
+    advance_ms(200);
+    TEST_CHECK(push(pcb, 1000 + SSE_MIN_DELTA_HZ - 1, 2000, 3000, 500) == 0);
+    advance_ms(200);
+    TEST_CHECK(push(pcb, 1000, 2000 - SSE_MIN_DELTA_HZ + 1, 3000 + SSE_MIN_DELTA_HZ - 1, 500) == 0);
+    advance_ms(200);
+    TEST_CHECK(push(pcb, 1000, 2000, 3000 - SSE_MIN_DELTA_HZ, 500) == 1);
+    TEST_CHECK(strstr(lwip_sim_output(pcb, NULL), "\"b\":2990") != NULL);
+
+    // Correctness in tenths of a percent
+    advance_ms(200);
+    TEST_CHECK(push(pcb, 1000, 2000, 2990, 500 + SSE_MIN_DELTA_CORRECTNESS - 1) == 0);
+    advance_ms(200);
+    TEST_CHECK(push(pcb, 1000, 2000, 2990, 500 + SSE_MIN_DELTA_CORRECTNESS) == 1);
+
+    // Slow drift adds up against the last pushed value, not the previous sample
+    advance_ms(200);
+    TEST_CHECK(push(pcb, 1006, 2000, 2990, 505) == 0);
+    advance_ms(200);
+    TEST_CHECK(push(pcb, 1012, 2000, 2990, 505) == 1 && last_r(pcb) == 1012);
+}
+
+static void test_rate_limit(void)
+{
+    lwip_sim_reset();
+    struct tcp_pcb *pcb = subscribe();
+    advance_ms(1000);
+
+    // A sweep updating every 10 ms with a big change each time
+    int events = 0, shown = -1;
+    uint16_t r = 1000;
+    for (int i = 0; i < 100; i++)
+    {
+        r += 20;
+        if (push(pcb, r, 2000, 3000, 500) > 0)
+        {
+            events++;
+            shown = last_r(pcb);
+        }
+        advance_ms(10);
+    }
+    printf("1 s sweep, an update every 10 ms: %d events\n", events);
+    TEST_CHECK(events >= 1000 / SSE_MIN_INTERVAL_MS - 1 && events <= 1000 / SSE_MIN_INTERVAL_MS + 1);
+
+    // The sweep stops: the last value is pushed with the next sample after the interval
+    TEST_CHECK(shown != r);
+    advance_ms(SSE_MIN_INTERVAL_MS);
+    TEST_CHECK(push(pcb, r, 2000, 3000, 500) == 1 && last_r(pcb) == r);
+}
+
+// A subscriber that is behind is skipped; its tcp_sent delivers the latest state, once
+static void test_pending_from_sent(void)
+{
+    lwip_sim_reset();
+    struct tcp_pcb *pcb = subscribe();
+    uint16_t r = 1000;
+
+    // Fill the window without ACKing until the next event is held back
+    int written = 0;
+    while (lwip_sim_unacked(pcb) <= SSE_MAX_UNACKED && written < 20)
+    {
+        advance_ms(200);
+        r += 50;
+        wifi_update_data(r, 2000, 3000, 500);
+        written++;
+    }
+    const uint32_t unacked = lwip_sim_unacked(pcb);
+    TEST_CHECK(unacked > SSE_MAX_UNACKED && unacked <= SSE_MAX_UNACKED + SSE_EVENT_MAX);
+
+    // More changes while behind: nothing is written, nothing piles up
+    for (int i = 0; i < 10; i++)
+    {
+        advance_ms(200);
+        r += 50;
+        wifi_update_data(r, 2000, 3000, 500);
+    }
+    TEST_CHECK(lwip_sim_unacked(pcb) == unacked);
+
+    // The ACK brings exactly one event with the newest state
+    lwip_sim_clear_output(pcb);
+    lwip_sim_ack(pcb, unacked);
+    TEST_CHECK(count(lwip_sim_output(pcb, NULL), "data: ") == 1);
+    TEST_CHECK(last_r(pcb) == r);
+    ack_all(pcb);
+    lwip_sim_clear_output(pcb);
+    lwip_sim_ack(pcb, 0);
+    TEST_CHECK(lwip_sim_output(pcb, NULL)[0] == '\0');
+}
+
+// A reader that stops ACKing holds at most SSE_MAX_UNACKED (+ one event) of the lwIP
+// heap, which stops growing, and the other subscriber keeps getting every event
+static void test_back_pressure(void)
+{
+    lwip_sim_reset();
+    struct tcp_pcb *stalled = subscribe();
+    struct tcp_pcb *live = subscribe();
+    uint32_t stalled_max = 0, heap_max = 0, heap_early = 0;
+    int live_events = 0;
+    uint16_t r = 1000;
+
+    for (int i = 0; i < 200; i++)
+    {
+        advance_ms(200);
+        r = (uint16_t)(r == 1000 ? 1500 : 1000);
+        lwip_sim_clear_output(live);
+        wifi_update_data(r, 2000, 3000, 500);
+        live_events += count(lwip_sim_output(live, NULL), "data: ");
+        ack_all(live);
+        if (lwip_sim_unacked(stalled) > stalled_max)
+            stalled_max = lwip_sim_unacked(stalled);
+        if (lwip_sim_heap_used() > heap_max)
+            heap_max = lwip_sim_heap_used();
+        if (i % 5 == 0)
+            lwip_sim_poll(stalled);
+        if (i == 19)
+            heap_early = heap_max;
+    }
+    printf("stalled subscriber: %u bytes unacked at most, heap %u bytes at most; live one got %d of 200 events\n",
+           (unsigned)stalled_max, (unsigned)heap_max, live_events);
+    TEST_CHECK(stalled_max <= SSE_MAX_UNACKED + SSE_EVENT_MAX);
+    TEST_CHECK(heap_max == heap_early); // Reached within a few events, then flat
+    TEST_CHECK(live_events == 200);
+    TEST_CHECK(lwip_sim_state(stalled) == LWIP_SIM_OPEN); // Streams never time out
+
+    // Once it reads again it is one event away from the current state
+    lwip_sim_clear_output(stalled);
+    lwip_sim_ack(stalled, lwip_sim_unacked(stalled));
+    TEST_CHECK(last_r(stalled) == r);
+}
+
+// A 60 s session with the sensor at 20 Hz: the knob jumps to a new color every ~2 s and
+// rests there with a few Hz of noise. An /events subscriber against a page polling /data
+// every 500 ms (the index.html fallback): payload bytes both ways and how long after
+// each jump the page shows the new color.
+static void test_against_polling(void)
+{
+    static const char poll_request[] = "GET /data?t=1700000000000 HTTP/1.1\r\nHost: 192.168.4.1\r\n"
+                                       "Accept: */*\r\nConnection: keep-alive\r\n\r\n";
+    lwip_sim_reset();
+    advance_ms(1000);
+    wifi_update_data(1000, 2000, 3000, 500);
+
+    struct tcp_pcb *sse = lwip_sim_connect();
+    struct tcp_pcb *poll = lwip_sim_connect();
+    uint32_t sse_bytes = sizeof("GET /events HTTP/1.1\r\nHost: 192.168.4.1\r\nAccept: text/event-stream\r\n\r\n") - 1;
+    uint32_t poll_bytes = 0;
+    lwip_sim_recv_str(sse, "GET /events HTTP/1.1\r\nHost: 192.168.4.1\r\nAccept: text/event-stream\r\n\r\n", 0);
+
+    uint32_t rng = 7u;
+    uint16_t level = 1000;
+    uint32_t jump_ms = 0, sse_latency_sum = 0, poll_latency_sum = 0, sse_worst = 0, poll_worst = 0;
+    bool sse_seen = true, poll_seen = true;
+    int jumps = 0;
+
+    for (uint32_t t = 0; t < 60000; t += 50)
+    {
+        if (t % 2050 == 0)
+        {
+            level = (uint16_t)(level == 1000 ? 1400 : 1000);
+            jump_ms = t;
+            sse_seen = poll_seen = false;
+            jumps++;
+        }
+        rng = rng * 1664525u + 1013904223u;
+        wifi_update_data((uint16_t)(level + (rng >> 29)), 2000, 3000, 500); // 0..7 Hz of noise
+
+        uint32_t len;
+        lwip_sim_output(sse, &len);
+        sse_bytes += len;
+        if (!sse_seen && abs(last_r(sse) - level) < SSE_MIN_DELTA_HZ)
+        {
+            sse_seen = true;
+            sse_latency_sum += t - jump_ms;
+            sse_worst = (t - jump_ms > sse_worst) ? t - jump_ms : sse_worst;
+        }
+        lwip_sim_clear_output(sse);
+        ack_all(sse);
+
+        if (t % 500 == 0)
+        {
+            lwip_sim_recv_str(poll, poll_request, 0);
+            ack_all(poll);
+            lwip_sim_output(poll, &len);
+            poll_bytes += sizeof(poll_request) - 1 + len;
+            if (!poll_seen && abs(last_r(poll) - level) < SSE_MIN_DELTA_HZ)
+            {
+                poll_seen = true;
+                poll_latency_sum += t - jump_ms;
+                poll_worst = (t - jump_ms > poll_worst) ? t - jump_ms : poll_worst;
+            }
+            lwip_sim_clear_output(poll);
+        }
+        if (t % 1000 == 0)
+        {
+            lwip_sim_poll(sse);
+            lwip_sim_poll(poll);
+        }
+        advance_ms(50);
+    }
+
+    printf("60 s, %d color changes: /events %u bytes, mean latency %u ms (worst %u); "
+           "/data polling %u bytes, mean latency %u ms (worst %u)\n",
+           jumps, (unsigned)sse_bytes, (unsigned)(sse_latency_sum / jumps), (unsigned)sse_worst,
+           (unsigned)poll_bytes, (unsigned)(poll_latency_sum / jumps), (unsigned)poll_worst);
+    TEST_CHECK(lwip_sim_state(sse) == LWIP_SIM_OPEN && lwip_sim_state(poll) == LWIP_SIM_OPEN);
+    TEST_CHECK(sse_bytes * 4 < poll_bytes);
+    TEST_CHECK(sse_worst <= SSE_MIN_INTERVAL_MS && sse_latency_sum < poll_latency_sum);
+}
+
+// Success is delivered at once, even inside the rate limit window
+static void test_success_immediate(void)
+{
+    lwip_sim_reset();
+    struct tcp_pcb *pcb = subscribe();
+    advance_ms(1000);
+    TEST_CHECK(push(pcb, 1100, 2000, 3000, 900) == 1);
+    advance_ms(10);
+    TEST_CHECK(push(pcb, 1100, 2000, 3000, 990) == 1);
+    TEST_CHECK(strstr(lwip_sim_output(pcb, NULL), "\"success\":true") != NULL);
+}
+
+int main(void)
+{
+    wifi_init_ap("test", "password");
+
+    test_thresholds();
+    test_rate_limit();
+    test_pending_from_sent();
+    test_back_pressure();
+    test_against_polling();
+    test_success_immediate(); // Last: success freezes the state for good
+
+    return TEST_RESULT();
+}
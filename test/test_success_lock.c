@@ -0,0 +1,153 @@
+// The success decision from main.c samples_task_run: readings go through the sample
+// filters, are scored, and correctness_settled() holds the score below success until the
+// filters have settled. That one value drives both the motor and the web server, so a
+// lone spike, or the filter sweeping through the target while the knobs are still turning,
+// locks neither; holding still on the target locks both.
+
+#include <stdlib.h>
+#include "correctness.h"
+#include "sample_filter.h"
+#include "hbridge.h"
+#include "wifi_server.h"
+#include "host/lwip_sim.h"
+#include "host/pico_sim.h"
+#include "host/test_common.h"
+
+// Treasure color, as in main.c
+#define TARGET_R_HZ 1200
+#define TARGET_G_HZ 1000
+#define TARGET_B_HZ 1600
+// One acquisition per SAMPLE_MS, the motor task runs every millisecond in between
+#define SAMPLE_MS 50
+// The success rotation drives forward for this long (hbridge.c)
+#define FULL_ROTATION_TIME_MS 2000
+
+static correctness_target_t target;
+static sample_filter_t filter_r, filter_g, filter_b;
+static uint16_t raw_max = 0;   // Best score before the settle gate
+static uint16_t gated_max = 0; // Best score the motor and the web server were given
+
+// Longest continuous forward drive of the motor, and whether it ever reversed
+static uint64_t forward_since_ns = 0;
+static uint64_t forward_longest_ns = 0;
+static bool reversed = false;
+
+static void on_gpio_put(uint gpio, bool value)
+{
+    (void)value;
+    if (gpio != HBRIDGE_IN1_PIN && gpio != HBRIDGE_IN2_PIN)
+        return;
+    const bool in1 = sim_gpio_output(HBRIDGE_IN1_PIN);
+    const bool in2 = sim_gpio_output(HBRIDGE_IN2_PIN);
+    if (in2 && !in1)
+        reversed = true;
+    if (in1 && !in2)
+    {
+        if (forward_since_ns == 0)
+            forward_since_ns = sim_now_ns() + 1;
+    }
+    else if (forward_since_ns != 0)
+    {
+        const uint64_t run = sim_now_ns() + 1 - forward_since_ns;
+        if (run > forward_longest_ns)
+            forward_longest_ns = run;
+        forward_since_ns = 0;
+    }
+}
+
+// One pass of samples_task_run with a fresh reading, then SAMPLE_MS of motor task
+static void feed(uint32_t r_hz, uint32_t g_hz, uint32_t b_hz)
+{
+    sample_filter_update(&filter_r, r_hz);
+    sample_filter_update(&filter_g, g_hz);
+    sample_filter_update(&filter_b, b_hz);
+
+    const uint32_t r = sample_filter_value(&filter_r);
+    const uint32_t g = sample_filter_value(&filter_g);
+    const uint32_t b = sample_filter_value(&filter_b);
+    const uint16_t raw = correctness_compute(&target, r, g, b);
+    const bool settled =
+        sample_filter_settled(&filter_r) && sample_filter_settled(&filter_g) && sample_filter_settled(&filter_b);
+    const uint16_t correctness = correctness_settled(raw, settled);
+
+    if (raw > raw_max)
+        raw_max = raw;
+    if (correctness > gated_max)
+        gated_max = correctness;
+
+    wifi_update_data((uint16_t)r, (uint16_t)g, (uint16_t)b, correctness);
+    for (int ms = 0; ms < SAMPLE_MS; ms++)
+    {
+        Motor_UpdateActuation(correctness);
+        sim_advance_ns(1000000ull);
+    }
+}
+
+static void test_gate(void)
+{
+    TEST_CHECK(correctness_settled(CORRECTNESS_MAX, false) == CORRECTNESS_SUCCESS - 1);
+    TEST_CHECK(correctness_settled(CORRECTNESS_SUCCESS, true) == CORRECTNESS_SUCCESS);
+    TEST_CHECK(correctness_settled(500, false) == 500);
+}
+
+static void test_spike_and_sweep(void)
+{
+    // Settled on a color well away from the target
+    for (int i = 0; i < 20; i++)
+        feed(1800, TARGET_G_HZ, TARGET_B_HZ);
+
+    // A lone reading right on the target
+    feed(TARGET_R_HZ, TARGET_G_HZ, TARGET_B_HZ);
+    for (int i = 0; i < 5; i++)
+        feed(1800, TARGET_G_HZ, TARGET_B_HZ);
+
+    // The red knob swept through the target and on to the other side
+    for (uint32_t hz = 1800; hz >= 600; hz -= 40)
+        feed(hz, TARGET_G_HZ, TARGET_B_HZ);
+    for (int i = 0; i < 60; i++)
+        feed(600, TARGET_G_HZ, TARGET_B_HZ);
+
+    printf("sweep: best score %u.%u%% filtered, %u.%u%% after the settle gate, longest forward drive %u ms\n",
+           raw_max / 10u, raw_max % 10u, gated_max / 10u, gated_max % 10u,
+           (unsigned)(forward_longest_ns / 1000000ull));
+    // The filtered reading really passed through success on the way
+    TEST_CHECK(raw_max >= CORRECTNESS_SUCCESS);
+    TEST_CHECK(gated_max < CORRECTNESS_SUCCESS);
+    TEST_CHECK(!wifi_is_success_locked());
+    // No success rotation, and the motor still follows the score back down
+    TEST_CHECK(forward_longest_ns < FULL_ROTATION_TIME_MS * 1000000ull);
+    TEST_CHECK(reversed);
+}
+
+static void test_settled_locks_both(void)
+{
+    for (int i = 0; i < 60; i++)
+        feed(TARGET_R_HZ, TARGET_G_HZ, TARGET_B_HZ);
+    TEST_CHECK(gated_max >= CORRECTNESS_SUCCESS);
+    TEST_CHECK(wifi_is_success_locked());
+    TEST_CHECK(forward_longest_ns >= FULL_ROTATION_TIME_MS * 1000000ull);
+
+    // Locked: moving away again no longer drives the motor back
+    reversed = false;
+    for (int i = 0; i < 40; i++)
+        feed(600, TARGET_G_HZ, TARGET_B_HZ);
+    TEST_CHECK(!reversed);
+    TEST_CHECK(wifi_is_success_locked());
+}
+
+int main(void)
+{
+    correctness_target_init(&target, TARGET_R_HZ, TARGET_G_HZ, TARGET_B_HZ);
+    sample_filter_init(&filter_r);
+    sample_filter_init(&filter_g);
+    sample_filter_init(&filter_b);
+    sim_set_gpio_put_hook(on_gpio_put);
+    Motor_Init();
+    wifi_init_ap("test", "password");
+
+    test_gate();
+    test_spike_and_sweep();
+    test_settled_locks_both();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,183 @@
+// target_set: the grid search against a brute-force nearest target, and matching in
+// the absolute / chroma / CIELAB scorers against brute-force best scores.
+
+#include <stdlib.h>
+#include "target_set.h"
+#include "host/test_common.h"
+
+static uint32_t rng_state = 99u;
+static uint32_t rng_next(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+static uint32_t l1(uint32_t r, uint32_t g, uint32_t b, const color_target_t *t)
+{
+    return (uint32_t)(abs((int)r - (int)t->r_hz) + abs((int)g - (int)t->g_hz) + abs((int)b - (int)t->b_hz));
+}
+
+static void fill_random(uint16_t count)
+{
+    target_set_clear();
+    for (uint16_t i = 0; i < count; i++)
+    {
+        const uint32_t r = 100u + rng_next() % 6000u, g = 100u + rng_next() % 6000u, b = 100u + rng_next() % 6000u;
+        TEST_CHECK(target_set_add("t", r, g, b, r + g + b + rng_next() % 1000u) == i);
+    }
+}
+
+// The shell search finds a target as close as the exhaustive one
+static void test_grid_matches_brute_force(void)
+{
+    static const uint16_t sizes[] = {1, 2, 17, 100, TARGET_SET_MAX};
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        fill_random(sizes[s]);
+        for (int i = 0; i < 20000; i++)
+        {
+            const uint32_t r = rng_next() % 7000u, g = rng_next() % 7000u, b = rng_next() % 7000u;
+            uint32_t best = UINT32_MAX;
+            for (uint16_t k = 0; k < target_set_count(); k++)
+            {
+                const uint32_t d = l1(r, g, b, target_set_get(k));
+                if (d < best)
+                    best = d;
+            }
+
+            target_match_t match;
+            TEST_CHECK(target_set_match(r, g, b, &match));
+            TEST_CHECK_MSG(match.distance == best, "%u targets: %u vs %u", (unsigned)sizes[s],
+                           (unsigned)match.distance, (unsigned)best);
+            TEST_CHECK(match.score == correctness_compute(&target_set_get(match.index)->absolute, r, g, b));
+        }
+    }
+
+    // The full set refuses more
+    TEST_CHECK(target_set_add("extra", 1, 1, 1, 3) == -1);
+}
+
+// ABSOLUTE picks the best correctness_compute() score, which is not always the Hz-nearest target
+static void test_absolute_metric(void)
+{
+    target_match_t match;
+    target_set_clear();
+    target_set_add("Dim", 200, 200, 200, 600);
+    target_set_add("Bright", 2000, 2000, 2000, 6000);
+
+    // 1200 Hz from Dim (200 % off on every channel), 4200 Hz from Bright (70 % off)
+    TEST_CHECK(target_set_match(600, 600, 600, &match) && match.index == 0 && match.score == 0);
+    TEST_CHECK(target_set_match_metric(TARGET_METRIC_ABSOLUTE, 600, 600, 600, 0, &match));
+    TEST_CHECK(match.index == 1 && match.distance == 4200);
+    TEST_CHECK(match.score == correctness_compute(&target_set_get(1)->absolute, 600, 600, 600));
+    TEST_CHECK(match.score == 300);
+
+    // Random sets: the match is the best score, whatever the grid pruned
+    static const uint16_t sizes[] = {1, 17, 100, TARGET_SET_MAX};
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        fill_random(sizes[s]);
+        int nearest_differs = 0;
+        for (int i = 0; i < 20000; i++)
+        {
+            const uint32_t r = rng_next() % 7000u, g = rng_next() % 7000u, b = rng_next() % 7000u;
+            uint16_t best = 0;
+            for (uint16_t k = 0; k < target_set_count(); k++)
+            {
+                const uint16_t score = correctness_compute(&target_set_get(k)->absolute, r, g, b);
+                if (score > best)
+                    best = score;
+            }
+
+            target_match_t nearest;
+            TEST_CHECK(target_set_match_metric(TARGET_METRIC_ABSOLUTE, r, g, b, 0, &match));
+            TEST_CHECK_MSG(match.score == best, "%u targets: %u vs %u", (unsigned)sizes[s], (unsigned)match.score,
+                           (unsigned)best);
+            TEST_CHECK(match.distance == l1(r, g, b, target_set_get(match.index)));
+            TEST_CHECK(target_set_match(r, g, b, &nearest) && nearest.score <= match.score);
+            if (nearest.score < match.score)
+                nearest_differs++;
+        }
+        printf("%u targets: the Hz-nearest target scored lower for %d of 20000 readings\n", (unsigned)sizes[s],
+               nearest_differs);
+    }
+}
+
+// In a dimmer room the Hz-nearest target is the wrong one; the chroma match is not fooled
+static void test_chroma_metric(void)
+{
+    target_match_t match;
+    target_set_clear();
+    target_set_add("Treasure", 1200, 1000, 1600, 3800);
+    target_set_add("Teal", 500, 450, 700, 1400);
+
+    // Treasure at 40 % brightness sits next to Teal in Hz
+    const uint32_t r = 480, g = 400, b = 640, c = 1520;
+    TEST_CHECK(target_set_match(r, g, b, &match) && match.index == 1);
+
+    TEST_CHECK(target_set_match_metric(TARGET_METRIC_CHROMA, r, g, b, c, &match));
+    TEST_CHECK(match.index == 0);
+    TEST_CHECK(match.score >= CORRECTNESS_MAX - 1);
+    TEST_CHECK(match.score == correctness_compute_chroma(&target_set_get(0)->chroma, r, g, b, c));
+
+    // No CLEAR reading: falls back to the Hz match and scores 0
+    TEST_CHECK(target_set_match_metric(TARGET_METRIC_CHROMA, r, g, b, 0, &match));
+    TEST_CHECK(match.index == 1 && match.score == 0);
+
+    // Random sets: the match is the best chroma score
+    fill_random(64);
+    for (int i = 0; i < 20000; i++)
+    {
+        const uint32_t rr = rng_next() % 7000u, gg = rng_next() % 7000u, bb = rng_next() % 7000u;
+        const uint32_t cc = 1u + rr + gg + bb + rng_next() % 2000u;
+        uint16_t best = 0;
+        for (uint16_t k = 0; k < target_set_count(); k++)
+        {
+            const uint16_t score = correctness_compute_chroma(&target_set_get(k)->chroma, rr, gg, bb, cc);
+            if (score > best)
+                best = score;
+        }
+        TEST_CHECK(target_set_match_metric(TARGET_METRIC_CHROMA, rr, gg, bb, cc, &match));
+        TEST_CHECK(match.score == best);
+    }
+}
+
+// Delta-E matching picks the perceptually nearest target, not the Hz-nearest one
+static void test_delta_e_metric(void)
+{
+    target_match_t match;
+
+    fill_random(64);
+    for (int i = 0; i < 20000; i++)
+    {
+        const uint32_t r = rng_next() % 6000u, g = rng_next() % 6000u, b = rng_next() % 6000u;
+        color_lab_t reading;
+        color_lab_from_hz(r, g, b, &reading);
+
+        uint32_t best = UINT32_MAX;
+        for (uint16_t k = 0; k < target_set_count(); k++)
+        {
+            const uint32_t d = color_lab_delta_e(&target_set_get(k)->lab, &reading);
+            if (d < best)
+                best = d;
+        }
+        TEST_CHECK(target_set_match_metric(TARGET_METRIC_DELTA_E, r, g, b, 0, &match));
+        TEST_CHECK(match.distance == best);
+        TEST_CHECK(match.score == color_lab_correctness(&target_set_get(match.index)->lab, r, g, b));
+    }
+
+    // Empty set
+    target_set_clear();
+    TEST_CHECK(!target_set_match_metric(TARGET_METRIC_DELTA_E, 1, 2, 3, 4, &match));
+}
+
+int main(void)
+{
+    test_grid_matches_brute_force();
+    test_absolute_metric();
+    test_chroma_metric();
+    test_delta_e_metric();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,304 @@
+// UDP telemetry seen from a receiver: every datagram decodes to the reading that was
+// published, and a loss checker built on the sequence numbers accounts for every
+// reading that never arrived: dropped on the device (no pbuf) or in the air, with
+// reordering and duplicates told apart from loss. The receiver also tracks the spread
+// of arrival time minus the packet's time_ms (RFC 3550 interarrival jitter).
+
+#include <stdlib.h>
+#include <string.h>
+#include "udp_telemetry.h"
+#include "host/lwip_sim.h"
+#include "host/test_common.h"
+
+#define READINGS 20000
+// One reading every PUBLISH_MS; the network delays each datagram by
+// DELAY_MIN_MS + [0, DELAY_SPREAD_MS) ms
+#define PUBLISH_MS 100
+#define DELAY_MIN_MS 2
+#define DELAY_SPREAD_MS 10
+
+// -----------------------------------------------------------------------------
+// Receiver / loss checker
+// -----------------------------------------------------------------------------
+
+typedef struct
+{
+    uint32_t seq;
+    uint32_t time_ms;
+    uint16_t r, g, b, correctness;
+    bool success;
+} telemetry_packet_t;
+
+typedef struct
+{
+    bool started;
+    uint32_t next_seq; // Highest sequence number seen + 1
+    uint32_t received;
+    uint32_t malformed;
+    uint32_t gaps;      // Sequence numbers skipped over when they were first expected
+    uint32_t late;      // Arrived after a higher number (filled a gap)
+    uint32_t duplicate; // Seen before
+    uint8_t seen[READINGS + 64];
+    // Transit = arrival - time_ms (the two clocks' offset cancels out of the spread).
+    // In-order packets only; late ones are counted above.
+    bool transit_started;
+    int32_t transit_last, transit_min, transit_max;
+    uint64_t transit_diff_sum; // Sum of |D| between consecutive packets
+    uint32_t transit_diffs;
+    uint32_t jitter_q4; // RFC 3550 estimate J += (|D| - J) / 16, 1/16 ms
+    int32_t late_transit_min;
+} telemetry_receiver_t;
+
+static uint16_t get_u16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+static bool telemetry_decode(const uint8_t *data, uint16_t len, telemetry_packet_t *out)
+{
+    if (len != UDP_TELEMETRY_PACKET_SIZE || data[0] != UDP_TELEMETRY_MAGIC || data[1] != UDP_TELEMETRY_VERSION)
+        return false;
+    out->success = (get_u16(data + 2) & UDP_TELEMETRY_FLAG_SUCCESS) != 0;
+    out->seq = get_u32(data + 4);
+    out->time_ms = get_u32(data + 8);
+    out->r = get_u16(data + 12);
+    out->g = get_u16(data + 14);
+    out->b = get_u16(data + 16);
+    out->correctness = get_u16(data + 18);
+    return true;
+}
+
+static void receiver_transit(telemetry_receiver_t *rx, int32_t transit)
+{
+    if (!rx->transit_started)
+    {
+        rx->transit_started = true;
+        rx->transit_min = rx->transit_max = transit;
+    }
+    else
+    {
+        const uint32_t d = (uint32_t)abs(transit - rx->transit_last);
+        rx->transit_diff_sum += d;
+        rx->transit_diffs++;
+        rx->jitter_q4 = rx->jitter_q4 + d - ((rx->jitter_q4 + 8u) >> 4);
+    }
+    rx->transit_last = transit;
+    if (transit < rx->transit_min)
+        rx->transit_min = transit;
+    if (transit > rx->transit_max)
+        rx->transit_max = transit;
+}
+
+static void receiver_add(telemetry_receiver_t *rx, const telemetry_packet_t *packet, uint32_t arrival_ms)
+{
+    const uint32_t seq = packet->seq;
+    if (seq >= sizeof(rx->seen))
+    {
+        rx->malformed++;
+        return;
+    }
+    if (rx->seen[seq])
+    {
+        rx->duplicate++;
+        return;
+    }
+    rx->seen[seq] = 1;
+    rx->received++;
+
+    const int32_t transit = (int32_t)(arrival_ms - packet->time_ms);
+    if (!rx->started || seq >= rx->next_seq)
+    {
+        rx->gaps += rx->started ? seq - rx->next_seq : seq;
+        rx->next_seq = seq + 1;
+        rx->started = true;
+        receiver_transit(rx, transit);
+    }
+    else
+    {
+        rx->late++;
+        if (rx->late == 1 || transit < rx->late_transit_min)
+            rx->late_transit_min = transit;
+    }
+}
+
+// Readings published but never received
+static uint32_t receiver_lost(const telemetry_receiver_t *rx)
+{
+    return rx->gaps - rx->late;
+}
+
+// -----------------------------------------------------------------------------
+// Network between the device and the receiver
+// -----------------------------------------------------------------------------
+
+static telemetry_receiver_t receiver;
+static uint16_t sent_r[READINGS];
+static uint32_t decode_errors = 0;
+
+static uint32_t rng_state = 31337u;
+static uint32_t rng_next(void)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return rng_state >> 8;
+}
+
+static int air_loss_percent = 0;
+static uint32_t air_lost = 0;
+static uint8_t held[UDP_TELEMETRY_PACKET_SIZE]; // One datagram delayed behind the next
+static bool holding = false;
+static uint32_t publish_ms = 0; // Device clock when the datagram was sent
+
+static void deliver(const uint8_t *data, uint16_t len, uint32_t arrival_ms)
+{
+    telemetry_packet_t packet;
+    if (!telemetry_decode(data, len, &packet))
+    {
+        receiver.malformed++;
+        return;
+    }
+    if (packet.seq < READINGS && packet.r != sent_r[packet.seq])
+        decode_errors++;
+    receiver_add(&receiver, &packet, arrival_ms);
+}
+
+static void on_datagram(const uint8_t *data, uint16_t len, uint16_t port)
+{
+    if (port != UDP_TELEMETRY_PORT)
+        return;
+    if ((int)(rng_next() % 100u) < air_loss_percent)
+    {
+        air_lost++;
+        return;
+    }
+    const uint32_t arrival_ms = publish_ms + DELAY_MIN_MS + rng_next() % DELAY_SPREAD_MS;
+
+    // Now and then: duplicated, or overtaken by the next datagram
+    const uint32_t roll = rng_next() % 100u;
+    if (roll == 0)
+        deliver(data, len, arrival_ms);
+    if (roll == 1 && !holding && len == sizeof(held))
+    {
+        memcpy(held, data, len);
+        holding = true;
+        return;
+    }
+    deliver(data, len, arrival_ms);
+    if (holding && roll != 1)
+    {
+        deliver(held, sizeof(held), arrival_ms);
+        holding = false;
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Tests
+// -----------------------------------------------------------------------------
+
+static void test_loss_accounting(void)
+{
+    uint32_t device_lost = 0;
+
+    memset(&receiver, 0, sizeof(receiver));
+    lwip_sim_set_udp_hook(on_datagram);
+    air_loss_percent = 3;
+    udp_telemetry_init();
+
+    for (uint32_t i = 0; i < READINGS; i++)
+    {
+        sent_r[i] = (uint16_t)(rng_next() % 60000u);
+        // Out of pbufs now and then: the reading is dropped on the device
+        if (rng_next() % 50u == 0)
+        {
+            lwip_sim_fail_pbuf_alloc(1);
+            device_lost++;
+        }
+        publish_ms = PUBLISH_MS * i;
+        udp_telemetry_publish(publish_ms, sent_r[i], 2000, 3000, 500, false);
+    }
+    if (holding)
+    {
+        deliver(held, sizeof(held), publish_ms + PUBLISH_MS);
+        holding = false;
+    }
+
+    printf("published %u: %u dropped on the device, %u in the air; received %u (%u late, %u duplicates), "
+           "checker reports %u lost\n",
+           (unsigned)READINGS, (unsigned)device_lost, (unsigned)air_lost, (unsigned)receiver.received,
+           (unsigned)receiver.late, (unsigned)receiver.duplicate, (unsigned)receiver_lost(&receiver));
+    TEST_CHECK(receiver.malformed == 0 && decode_errors == 0);
+    TEST_CHECK(receiver.late > 0 && receiver.duplicate > 0);
+    // Every reading is either received or counted as lost, wherever it was lost
+    TEST_CHECK(receiver.received + receiver_lost(&receiver) == receiver.next_seq);
+    TEST_CHECK_MSG(receiver_lost(&receiver) == device_lost + air_lost, "%u vs %u",
+                   (unsigned)receiver_lost(&receiver), (unsigned)(device_lost + air_lost));
+    TEST_CHECK(lwip_sim_pbufs_live() == 0 && lwip_sim_heap_used() == 0);
+}
+
+// Transit times spread over the simulated network delay: in-order packets within
+// DELAY_SPREAD_MS of each other, mean |D| that of two uniform delays (spread / 3),
+// and reordered ones at least a publish interval behind
+static void test_jitter(void)
+{
+    const double mean_d = (double)receiver.transit_diff_sum / receiver.transit_diffs;
+    const double expect_d = (DELAY_SPREAD_MS * DELAY_SPREAD_MS - 1) / (3.0 * DELAY_SPREAD_MS);
+
+    printf("transit %d..%d ms, mean |D| %.2f ms (expected %.2f), RFC 3550 jitter %.2f ms, reordered >= %d ms\n",
+           (int)receiver.transit_min, (int)receiver.transit_max, mean_d, expect_d, receiver.jitter_q4 / 16.0,
+           (int)receiver.late_transit_min);
+    TEST_CHECK(receiver.transit_min == DELAY_MIN_MS);
+    TEST_CHECK(receiver.transit_max == DELAY_MIN_MS + DELAY_SPREAD_MS - 1);
+    TEST_CHECK_MSG(mean_d > expect_d * 0.95 && mean_d < expect_d * 1.05, "%.2f", mean_d);
+    TEST_CHECK(receiver.jitter_q4 > 16u * 1 && receiver.jitter_q4 < 16u * DELAY_SPREAD_MS);
+    TEST_CHECK(receiver.late_transit_min >= PUBLISH_MS);
+}
+
+// The packet layout from udp_telemetry.h, byte by byte
+static uint8_t captured[64];
+static uint16_t captured_len = 0;
+
+static void capture(const uint8_t *data, uint16_t len, uint16_t port)
+{
+    if (port != UDP_TELEMETRY_PORT || len > sizeof(captured))
+        return;
+    memcpy(captured, data, len);
+    captured_len = len;
+}
+
+static void test_layout(void)
+{
+    static const uint8_t expect[UDP_TELEMETRY_PACKET_SIZE] = {
+        'T', 1, 0x01, 0x00,           // magic, version, flags: success
+        0x20, 0x4E, 0x00, 0x00,       // sequence 20000: numbering carries on
+        0x78, 0x56, 0x34, 0x12,       // 0x12345678 ms
+        0xE8, 0x03, 0xD0, 0x07,       // r 1000, g 2000
+        0xB8, 0x0B, 0xE7, 0x03,       // b 3000, correctness 999
+    };
+
+    lwip_sim_set_udp_hook(capture);
+    udp_telemetry_publish(0x12345678u, 1000, 2000, 3000, 999, true);
+    TEST_CHECK(captured_len == UDP_TELEMETRY_PACKET_SIZE);
+    TEST_CHECK(memcmp(captured, expect, sizeof(expect)) == 0);
+
+    // A failed allocation sends nothing but still uses up a number
+    captured_len = 0;
+    lwip_sim_fail_pbuf_alloc(1);
+    udp_telemetry_publish(0, 0, 0, 0, 0, false);
+    TEST_CHECK(captured_len == 0);
+    udp_telemetry_publish(0, 0, 0, 0, 0, false);
+    TEST_CHECK(captured_len == UDP_TELEMETRY_PACKET_SIZE && captured[4] == 0x22 && captured[2] == 0);
+    lwip_sim_set_udp_hook(NULL);
+}
+
+int main(void)
+{
+    test_loss_accounting();
+    test_jitter();
+    test_layout();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,348 @@
+// Embedded pages (cmake/embed_assets.cmake): every gzip payload inflates to the
+// minified page, the plain copy is that page, and the ETags are its hash (with
+// "-gz" for the gzip body); served over the simulated lwIP, a client gets the gzip
+// body only if its Accept-Encoding allows it, bodies go out byte for byte straight
+// from flash, and revalidation with a matching If-None-Match gets a bodiless 304. A benchmark compares the lwIP heap
+// high-water and time per page with copying the same response (TCP_WRITE_FLAG_COPY).
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+#include "web_assets.h"
+#include "wifi_server.h"
+#include "sha1.h"
+#include "lwip/stats.h"
+#include "host/lwip_sim.h"
+#include "host/test_common.h"
+
+#define PAGE_MAX 65536
+
+static long read_file(const char *path, char *out, long size)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return -1;
+    const long len = (long)fread(out, 1, size, f);
+    fclose(f);
+    return len;
+}
+
+// index.html -> "/", name.html -> "/name"
+static void asset_file(const web_asset_t *asset, const char *dir, char *out, int size)
+{
+    if (strcmp(asset->path, "/") == 0)
+        snprintf(out, size, "%s/index.html", dir);
+    else
+        snprintf(out, size, "%s/%s.html", dir, asset->path + 1);
+}
+
+static long gunzip(const uint8_t *in, uint32_t len, char *out, long size)
+{
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    if (inflateInit2(&z, 16 + MAX_WBITS) != Z_OK)
+        return -1;
+    z.next_in = (Bytef *)in;
+    z.avail_in = len;
+    z.next_out = (Bytef *)out;
+    z.avail_out = (uInt)size;
+    const int result = inflate(&z, Z_FINISH);
+    const long produced = (long)z.total_out;
+    const bool consumed_all = z.avail_in == 0;
+    inflateEnd(&z);
+    return (result == Z_STREAM_END && consumed_all) ? produced : -1;
+}
+
+static bool check_headers(const web_asset_body_t *body, bool gzip)
+{
+    char expect[96];
+    snprintf(expect, sizeof(expect), "\r\nContent-Length: %u\r\n", (unsigned)body->len);
+    const bool encoded = strstr(body->header, "\r\nContent-Encoding: gzip\r\n") != NULL;
+
+    return strncmp(body->header, "HTTP/1.1 200 OK\r\n", 17) == 0 && strstr(body->header, expect) != NULL &&
+           encoded == gzip && strstr(body->header, "\r\nVary: Accept-Encoding\r\n") != NULL &&
+           strstr(body->header, body->etag) != NULL &&
+           strncmp(body->not_modified, "HTTP/1.1 304 Not Modified\r\n", 27) == 0 &&
+           strstr(body->not_modified, "\r\nVary: Accept-Encoding\r\n") != NULL &&
+           strstr(body->not_modified, body->etag) != NULL && strstr(body->not_modified, "Content-Length") == NULL &&
+           body->header_len == strlen(body->header) && body->not_modified_len == strlen(body->not_modified);
+}
+
+static void test_payloads(void)
+{
+    static char page[PAGE_MAX], minified[PAGE_MAX], source[PAGE_MAX];
+    char path[512];
+
+    TEST_CHECK(web_asset_count >= 2);
+    TEST_CHECK(strcmp(web_assets[0].path, "/") == 0);
+
+    for (uint16_t i = 0; i < web_asset_count; i++)
+    {
+        const web_asset_t *asset = &web_assets[i];
+
+        // The gzip stream is complete and inflates to exactly the minified page
+        const long len = gunzip(asset->gzip.data, asset->gzip.len, page, sizeof(page));
+        asset_file(asset, WEB_ASSETS_WORK_DIR, path, sizeof(path));
+        const long minified_len = read_file(path, minified, sizeof(minified));
+        asset_file(asset, WEB_DIR, path, sizeof(path));
+        const long source_len = read_file(path, source, sizeof(source));
+
+        printf("%-10s %6ld bytes source, %6ld minified, %6u gzipped (%.0f %%)\n", asset->path, source_len, len,
+               (unsigned)asset->gzip.len, 100.0 * asset->gzip.len / (double)source_len);
+        TEST_CHECK_MSG(len > 0 && len == minified_len && memcmp(page, minified, len) == 0, "%s", asset->path);
+        TEST_CHECK(len <= source_len && (long)asset->gzip.len < len);
+        // The plain body is the minified page itself
+        TEST_CHECK_MSG(asset->identity.len == (uint32_t)len && memcmp(asset->identity.data, page, len) == 0, "%s",
+                       asset->path);
+        TEST_CHECK(strstr(page, "</html>") != NULL);
+
+        // Strong ETag: the first 16 hex digits of SHA-1 over what the browser ends up with
+        uint8_t digest[SHA1_DIGEST_SIZE];
+        char etag[22];
+        sha1_ctx_t sha;
+        sha1_init(&sha);
+        sha1_update(&sha, page, (size_t)len);
+        sha1_final(&sha, digest);
+        etag[0] = '"';
+        for (int k = 0; k < 8; k++)
+            snprintf(etag + 1 + 2 * k, 3, "%02x", digest[k]);
+        etag[17] = '"';
+        etag[18] = '\0';
+        TEST_CHECK_MSG(strcmp(asset->identity.etag, etag) == 0, "%s: %s vs %s", asset->path, asset->identity.etag,
+                       etag);
+        snprintf(etag + 17, 5, "-gz\"");
+        TEST_CHECK_MSG(strcmp(asset->gzip.etag, etag) == 0, "%s: %s vs %s", asset->path, asset->gzip.etag, etag);
+
+        // Prebuilt headers agree with the payload
+        TEST_CHECK(check_headers(&asset->gzip, true));
+        TEST_CHECK(check_headers(&asset->identity, false));
+    }
+}
+
+// Header, Connection line, then the payload byte for byte
+static bool is_full_response(const struct tcp_pcb *pcb, const web_asset_body_t *body)
+{
+    static const char keep_alive[] = "Connection: keep-alive\r\n\r\n";
+    uint32_t len;
+    const char *out = lwip_sim_output(pcb, &len);
+
+    return len == body->header_len + sizeof(keep_alive) - 1 + body->len &&
+           memcmp(out, body->header, body->header_len) == 0 &&
+           memcmp(out + body->header_len, keep_alive, sizeof(keep_alive) - 1) == 0 &&
+           memcmp(out + body->header_len + sizeof(keep_alive) - 1, body->data, body->len) == 0;
+}
+
+static void test_serving(void)
+{
+    char request[256];
+    const web_asset_t *index = &web_assets[0];
+
+    lwip_sim_reset();
+    struct tcp_pcb *pcb = lwip_sim_connect();
+    lwip_sim_recv_str(pcb, "GET / HTTP/1.1\r\nHost: x\r\nAccept-Encoding: gzip, deflate\r\n\r\n", 5);
+    TEST_CHECK(is_full_response(pcb, &index->gzip));
+    TEST_CHECK(lwip_sim_heap_used() == 0); // Nothing copied: all of it is sent from flash
+
+    // Through a small window the body streams over several ACKs and arrives intact
+    lwip_sim_reset();
+    pcb = lwip_sim_connect();
+    lwip_sim_set_sndbuf(pcb, 300);
+    lwip_sim_recv_str(pcb, "GET / HTTP/1.1\r\nHost: x\r\nAccept-Encoding: gzip\r\n\r\n", 0);
+    int acks = 0;
+    while (lwip_sim_unacked(pcb) && acks < 1000)
+    {
+        lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+        acks++;
+    }
+    printf("/ through a 300-byte window: %d ACKs\n", acks);
+    TEST_CHECK(is_full_response(pcb, &index->gzip));
+
+    // Unknown paths get the dashboard; every route gets its own page
+    lwip_sim_clear_output(pcb);
+    lwip_sim_set_sndbuf(pcb, TCP_SND_BUF);
+    lwip_sim_recv_str(pcb, "GET /no/such/page HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n", 0);
+    TEST_CHECK(is_full_response(pcb, &index->gzip));
+    for (uint16_t i = 0; i < web_asset_count; i++)
+    {
+        lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+        lwip_sim_clear_output(pcb);
+        snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n", web_assets[i].path);
+        lwip_sim_recv_str(pcb, request, 0);
+        TEST_CHECK_MSG(is_full_response(pcb, &web_assets[i].gzip), "%s", web_assets[i].path);
+    }
+}
+
+// Only a client that accepts gzip gets it; everyone else gets the plain page
+static void test_encoding(void)
+{
+    static const struct
+    {
+        const char *accept_encoding; // NULL: no header
+        bool gzip;
+    } cases[] = {
+        {NULL, false},
+        {"gzip, deflate, br, zstd", true},
+        {"identity", false},
+        {"br;q=1.0, gzip;q=0.8", true},
+        {"gzip;q=0, deflate", false},
+        {"*", true},
+        {"deflate, *;q=0", false},
+    };
+    char request[256];
+
+    lwip_sim_reset();
+    struct tcp_pcb *pcb = lwip_sim_connect();
+    for (uint16_t i = 0; i < web_asset_count; i++)
+    {
+        for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++)
+        {
+            int len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: x\r\n", web_assets[i].path);
+            if (cases[k].accept_encoding)
+                len += snprintf(request + len, sizeof(request) - len, "Accept-Encoding: %s\r\n",
+                                cases[k].accept_encoding);
+            snprintf(request + len, sizeof(request) - len, "\r\n");
+
+            lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+            lwip_sim_clear_output(pcb);
+            lwip_sim_recv_str(pcb, request, 0);
+            const web_asset_body_t *body = cases[k].gzip ? &web_assets[i].gzip : &web_assets[i].identity;
+            TEST_CHECK_MSG(is_full_response(pcb, body), "%s, Accept-Encoding: %s", web_assets[i].path,
+                           cases[k].accept_encoding ? cases[k].accept_encoding : "(none)");
+        }
+    }
+}
+
+// Revalidation: a matching If-None-Match gets the 304 header and nothing else
+static void test_not_modified(void)
+{
+    const web_asset_body_t *index = &web_assets[0].gzip;
+    char etags[4][96];
+    snprintf(etags[0], sizeof(etags[0]), "%s", index->etag);
+    snprintf(etags[1], sizeof(etags[1]), "W/%s", index->etag);
+    snprintf(etags[2], sizeof(etags[2]), "\"0123456789abcdef\", %s", index->etag);
+    snprintf(etags[3], sizeof(etags[3]), "*");
+
+    lwip_sim_reset();
+    struct tcp_pcb *pcb = lwip_sim_connect();
+    for (int i = 0; i < 4; i++)
+    {
+        char request[512];
+        uint32_t len;
+        snprintf(request, sizeof(request), "GET / HTTP/1.1\r\nAccept-Encoding: gzip\r\nIf-None-Match: %s\r\n\r\n",
+                 etags[i]);
+        lwip_sim_clear_output(pcb);
+        lwip_sim_recv_str(pcb, request, 7);
+
+        const char *out = lwip_sim_output(pcb, &len);
+        TEST_CHECK_MSG(len == index->not_modified_len + strlen("Connection: keep-alive\r\n\r\n") &&
+                           memcmp(out, index->not_modified, index->not_modified_len) == 0,
+                       "If-None-Match: %s", etags[i]);
+    }
+
+    // A stale ETag gets the page
+    lwip_sim_clear_output(pcb);
+    lwip_sim_recv_str(pcb, "GET / HTTP/1.1\r\nAccept-Encoding: gzip\r\nIf-None-Match: \"0123456789abcdef\"\r\n\r\n", 0);
+    TEST_CHECK(is_full_response(pcb, index));
+
+    // The gzip body's ETag does not revalidate the plain one, and the other way round
+    char request[256];
+    lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+    lwip_sim_clear_output(pcb);
+    snprintf(request, sizeof(request), "GET / HTTP/1.1\r\nIf-None-Match: %s\r\n\r\n", index->etag);
+    lwip_sim_recv_str(pcb, request, 0);
+    TEST_CHECK(is_full_response(pcb, &web_assets[0].identity));
+    lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+    lwip_sim_clear_output(pcb);
+    snprintf(request, sizeof(request), "GET / HTTP/1.1\r\nAccept-Encoding: gzip\r\nIf-None-Match: %s\r\n\r\n",
+             web_assets[0].identity.etag);
+    lwip_sim_recv_str(pcb, request, 0);
+    TEST_CHECK(is_full_response(pcb, index));
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_OPEN);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+#define BENCH_PAGES 5000
+
+// The same page served the way it was before http_send_static: header formatted per
+// request, then header and body copied into the lwIP heap, all or nothing
+static bool send_copied(struct tcp_pcb *pcb, const web_asset_body_t *asset)
+{
+    char header[512];
+    const int header_len = snprintf(header, sizeof(header), "%sConnection: keep-alive\r\n\r\n", asset->header);
+    if (tcp_sndbuf(pcb) < header_len + asset->len)
+        return false;
+    return tcp_write(pcb, header, (u16_t)header_len, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE) == ERR_OK &&
+           tcp_write(pcb, asset->data, (u16_t)asset->len, TCP_WRITE_FLAG_COPY) == ERR_OK;
+}
+
+// Per page: lwIP heap high-water and host time from request to fully acknowledged.
+// The copying run is driven by a HEAD request, so both runs parse the same request
+// and queue the server's header; only the body (and the header copy) differ.
+static void bench(void)
+{
+    char request[256], head[256];
+
+    for (uint16_t i = 0; i < web_asset_count; i++)
+    {
+        const char *path = web_assets[i].path;
+        const web_asset_body_t *asset = &web_assets[i].gzip;
+        snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: x\r\nAccept-Encoding: gzip\r\n\r\n", path);
+        snprintf(head, sizeof(head), "HEAD %s HTTP/1.1\r\nHost: x\r\nAccept-Encoding: gzip\r\n\r\n", path);
+
+        lwip_sim_reset();
+        struct tcp_pcb *pcb = lwip_sim_connect();
+        lwip_stats.mem.max = 0;
+        int sent = 0;
+        double t0 = now_s();
+        for (int k = 0; k < BENCH_PAGES; k++)
+        {
+            lwip_sim_clear_output(pcb);
+            lwip_sim_recv_str(pcb, head, 0);
+            sent += send_copied(pcb, asset);
+            lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+        }
+        const double copied_us = (now_s() - t0) * 1e6 / BENCH_PAGES;
+        const unsigned copied_heap = lwip_stats.mem.max;
+        TEST_CHECK(sent == BENCH_PAGES);
+
+        lwip_sim_reset();
+        pcb = lwip_sim_connect();
+        lwip_stats.mem.max = 0;
+        t0 = now_s();
+        for (int k = 0; k < BENCH_PAGES; k++)
+        {
+            lwip_sim_clear_output(pcb);
+            lwip_sim_recv_str(pcb, request, 0);
+            lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+        }
+        const double flash_us = (now_s() - t0) * 1e6 / BENCH_PAGES;
+        const unsigned flash_heap = lwip_stats.mem.max;
+        TEST_CHECK_MSG(is_full_response(pcb, asset), "%s", path);
+
+        printf("bench %-10s %5u-byte body: copied heap %u bytes, %.2f us/page; from flash heap %u bytes, "
+               "%.2f us/page (host)\n",
+               path, (unsigned)asset->len, copied_heap, copied_us, flash_heap, flash_us);
+        TEST_CHECK(copied_heap >= asset->header_len + asset->len);
+        TEST_CHECK(flash_heap == 0);
+    }
+}
+
+int main(void)
+{
+    wifi_init_ap("test", "password");
+
+    test_payloads();
+    test_serving();
+    test_encoding();
+    test_not_modified();
+    bench();
+
+    return TEST_RESULT();
+}
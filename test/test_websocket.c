@@ -0,0 +1,212 @@
+// /ws on the simulated lwIP: the RFC 6455 opening handshake (accept key, version
+// negotiation), telemetry frames and deltas, and client framing: masking, pings split
+// across pbufs, skipped data frames, control frame rules and the closing handshake.
+
+#include <string.h>
+#include "wifi_server.h"
+#include "host/lwip_sim.h"
+#include "host/pico_sim.h"
+#include "host/test_common.h"
+
+#define WS_OP_TEXT 0x1
+#define WS_OP_CLOSE 0x8
+#define WS_OP_PING 0x9
+#define WS_OP_PONG 0xA
+
+// RFC 6455 1.3 example
+static const char sample_key[] = "dGhlIHNhbXBsZSBub25jZQ==";
+static const char sample_accept[] = "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=";
+
+static void handshake_request(char *out, int size, const char *version_line)
+{
+    snprintf(out, size,
+             "GET /ws HTTP/1.1\r\nHost: 192.168.4.1\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+             "Sec-WebSocket-Key: %s\r\n%s\r\n",
+             sample_key, version_line);
+}
+
+// Masked client frame; returns its length
+static int client_frame(uint8_t *out, bool fin, uint8_t opcode, const uint8_t *payload, uint32_t len)
+{
+    static const uint8_t mask[4] = {0x37, 0xfa, 0x21, 0x3d};
+    int n = 0;
+
+    out[n++] = (uint8_t)((fin ? 0x80 : 0x00) | opcode);
+    if (len < 126)
+        out[n++] = (uint8_t)(0x80 | len);
+    else
+    {
+        out[n++] = 0x80 | 126;
+        out[n++] = (uint8_t)(len >> 8);
+        out[n++] = (uint8_t)len;
+    }
+    memcpy(out + n, mask, 4);
+    n += 4;
+    for (uint32_t i = 0; i < len; i++)
+        out[n++] = payload[i] ^ mask[i & 3];
+    return n;
+}
+
+// Connect and upgrade; output is cleared after the handshake and first frame
+static struct tcp_pcb *ws_connect(void)
+{
+    char request[256];
+    handshake_request(request, sizeof(request), "Sec-WebSocket-Version: 13\r\n");
+    struct tcp_pcb *pcb = lwip_sim_connect();
+    lwip_sim_recv_str(pcb, request, 0);
+    lwip_sim_clear_output(pcb);
+    return pcb;
+}
+
+// The close frame the server sent, as a status code (0 if none)
+static int close_status(const struct tcp_pcb *pcb)
+{
+    uint32_t len;
+    const uint8_t *out = (const uint8_t *)lwip_sim_output(pcb, &len);
+    if (len < 4 || out[len - 4] != (0x80 | WS_OP_CLOSE) || out[len - 3] != 2)
+        return 0;
+    return (out[len - 2] << 8) | out[len - 1];
+}
+
+static void test_handshake(void)
+{
+    char request[256];
+    uint32_t len;
+
+    lwip_sim_reset();
+    handshake_request(request, sizeof(request), "Sec-WebSocket-Version: 13\r\n");
+    struct tcp_pcb *pcb = lwip_sim_connect();
+    lwip_sim_recv_str(pcb, request, 11);
+
+    const char *out = lwip_sim_output(pcb, &len);
+    TEST_CHECK(strncmp(out, "HTTP/1.1 101 Switching Protocols\r\n", 34) == 0);
+    TEST_CHECK(strstr(out, sample_accept) != NULL);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_OPEN);
+
+    // Then the full state: FIN + binary, six fields
+    const uint8_t *frame = (const uint8_t *)strstr(out, "\r\n\r\n") + 4;
+    TEST_CHECK(frame[0] == 0x82 && frame[1] == 13 && frame[2] == 0x3F);
+    TEST_CHECK(frame[3] == (1000 & 0xFF) && frame[4] == (1000 >> 8));
+    TEST_CHECK((const char *)frame + 15 == out + len);
+
+    // Deltas: only what changed; nothing at all if nothing did
+    lwip_sim_clear_output(pcb);
+    wifi_update_data(1000, 2000, 3001, 500);
+    frame = (const uint8_t *)lwip_sim_output(pcb, &len);
+    TEST_CHECK(len == 5 && frame[1] == 3 && frame[2] == 0x04 && frame[3] == (3001 & 0xFF));
+    lwip_sim_clear_output(pcb);
+    wifi_update_data(1000, 2000, 3001, 500);
+    lwip_sim_output(pcb, &len);
+    TEST_CHECK(len == 0);
+
+    // Any other version: 426 naming the one we speak
+    static const char *const versions[] = {"Sec-WebSocket-Version: 8\r\n", "Sec-WebSocket-Version: 13x\r\n",
+                                           "Sec-WebSocket-Version: 269\r\n", ""};
+    for (size_t i = 0; i < sizeof(versions) / sizeof(versions[0]); i++)
+    {
+        handshake_request(request, sizeof(request), versions[i]);
+        pcb = lwip_sim_connect();
+        lwip_sim_recv_str(pcb, request, 0);
+        out = lwip_sim_output(pcb, NULL);
+        TEST_CHECK_MSG(strncmp(out, "HTTP/1.1 426 Upgrade Required\r\n", 31) == 0, "%s", versions[i]);
+        TEST_CHECK(strstr(out, "\r\nSec-WebSocket-Version: 13\r\n") != NULL);
+        TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_CLOSED);
+    }
+
+    // No key: not a handshake at all
+    pcb = lwip_sim_connect();
+    lwip_sim_recv_str(pcb, "GET /ws HTTP/1.1\r\nHost: x\r\nUpgrade: websocket\r\nSec-WebSocket-Version: 13\r\n\r\n", 0);
+    TEST_CHECK(strncmp(lwip_sim_output(pcb, NULL), "HTTP/1.1 400", 12) == 0);
+}
+
+static void test_framing(void)
+{
+    uint8_t frame[512];
+    uint32_t len;
+    int n;
+
+    lwip_sim_reset();
+    struct tcp_pcb *pcb = ws_connect();
+
+    // Ping split over 3-byte pbufs: pong with the same payload
+    n = client_frame(frame, true, WS_OP_PING, (const uint8_t *)"hello", 5);
+    lwip_sim_recv(pcb, frame, (uint16_t)n, 3);
+    const uint8_t *out = (const uint8_t *)lwip_sim_output(pcb, &len);
+    TEST_CHECK(len == 7 && out[0] == (0x80 | WS_OP_PONG) && out[1] == 5 && memcmp(out + 2, "hello", 5) == 0);
+
+    // A large text frame arriving in two deliveries is skipped, then a ping still works
+    uint8_t text[300];
+    memset(text, 'x', sizeof(text));
+    n = client_frame(frame, true, WS_OP_TEXT, text, sizeof(text));
+    lwip_sim_recv(pcb, frame, 100, 0);
+    lwip_sim_recv(pcb, frame + 100, (uint16_t)(n - 100), 7);
+    n = client_frame(frame, true, WS_OP_PING, NULL, 0);
+    lwip_sim_clear_output(pcb);
+    lwip_sim_recv(pcb, frame, (uint16_t)n, 0);
+    out = (const uint8_t *)lwip_sim_output(pcb, &len);
+    TEST_CHECK(len == 2 && out[0] == (0x80 | WS_OP_PONG));
+    TEST_CHECK(lwip_sim_recved(pcb) > sizeof(text));
+
+    // Quiet for long enough: the server pings
+    lwip_sim_clear_output(pcb);
+    lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+    for (int i = 0; i < 15; i++)
+        lwip_sim_poll(pcb);
+    out = (const uint8_t *)lwip_sim_output(pcb, &len);
+    TEST_CHECK(len == 2 && out[0] == (0x80 | WS_OP_PING));
+
+    // Closing handshake: the status is echoed and the connection closes
+    const uint8_t status[2] = {0x03, 0xE8};
+    n = client_frame(frame, true, WS_OP_CLOSE, status, 2);
+    lwip_sim_clear_output(pcb);
+    lwip_sim_recv(pcb, frame, (uint16_t)n, 0);
+    TEST_CHECK(close_status(pcb) == 1000);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_CLOSED);
+    TEST_CHECK(lwip_sim_pbufs_live() == 0);
+}
+
+// Each of these is a protocol error: close with 1002
+static void test_protocol_errors(void)
+{
+    uint8_t frame[512], payload[200];
+    memset(payload, 'p', sizeof(payload));
+
+    static const char *const names[4] = {"fragmented ping", "126-byte ping", "fragmented close", "unmasked ping"};
+    uint8_t frames[4][256];
+    client_frame(frames[0], false, WS_OP_PING, payload, 4); // FIN clear on a control frame
+    client_frame(frames[1], true, WS_OP_PING, payload, 126); // 16-bit length
+    client_frame(frames[2], false, WS_OP_CLOSE, payload, 2);
+    client_frame(frames[3], true, WS_OP_PING, payload, 4);
+    frames[3][1] &= 0x7F;
+
+    lwip_sim_reset();
+    for (int i = 0; i < 4; i++)
+    {
+        struct tcp_pcb *pcb = ws_connect();
+        // Only the first two bytes are needed to reject it
+        lwip_sim_recv(pcb, frames[i], 2, 0);
+        TEST_CHECK_MSG(close_status(pcb) == 1002, "%s", names[i]);
+        TEST_CHECK_MSG(lwip_sim_state(pcb) == LWIP_SIM_CLOSED, "%s", names[i]);
+    }
+
+    // A valid 125-byte ping is still answered
+    struct tcp_pcb *pcb = ws_connect();
+    const int n = client_frame(frame, true, WS_OP_PING, payload, 125);
+    lwip_sim_recv(pcb, frame, (uint16_t)n, 0);
+    uint32_t len;
+    const uint8_t *out = (const uint8_t *)lwip_sim_output(pcb, &len);
+    TEST_CHECK(len == 127 && out[0] == (0x80 | WS_OP_PONG) && out[1] == 125);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_OPEN);
+}
+
+int main(void)
+{
+    wifi_init_ap("test", "password");
+    wifi_update_data(1000, 2000, 3000, 500);
+
+    test_handshake();
+    test_framing();
+    test_protocol_errors();
+
+    return TEST_RESULT();
+}
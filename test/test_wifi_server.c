@@ -0,0 +1,443 @@
+// wifi_server connection handling on the simulated lwIP: keep-alive and pipelining,
+// the idle timeout (a client that is still reading a long response is not idle),
+// HEAD requests, eviction when the connection pool is full, no pbuf leaks on close,
+// every response owed to a client that half-closed, /stats delivered whole when the
+// lwIP heap is short, and a requests/sec and latency benchmark.
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "wifi_server.h"
+#include "loop_stats.h"
+#include "host/lwip_sim.h"
+#include "host/pico_sim.h"
+#include "host/test_common.h"
+
+#define MAX_POLLS 100
+
+static int count(const char *haystack, const char *needle)
+{
+    int n = 0;
+    for (const char *p = haystack; (p = strstr(p, needle)) != NULL; p++)
+        n++;
+    return n;
+}
+
+// Same over binary output (gzipped pages contain NUL bytes)
+static int count_bytes(const char *data, uint32_t len, const char *needle)
+{
+    const size_t n = strlen(needle);
+    int found = 0;
+    for (uint32_t i = 0; i + n <= len; i++)
+    {
+        if (memcmp(data + i, needle, n) == 0)
+            found++;
+    }
+    return found;
+}
+
+// Acknowledge everything the server has written so far
+static void ack_all(struct tcp_pcb *pcb)
+{
+    while (lwip_sim_state(pcb) == LWIP_SIM_OPEN && lwip_sim_unacked(pcb))
+        lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+}
+
+// Polls until the server closes an idle connection (MAX_POLLS if it never does)
+static int polls_until_closed(struct tcp_pcb *pcb)
+{
+    int polls = 0;
+    while (polls < MAX_POLLS && lwip_sim_state(pcb) == LWIP_SIM_OPEN)
+    {
+        lwip_sim_poll(pcb);
+        polls++;
+    }
+    return polls;
+}
+
+static const char request_data[] = "GET /data HTTP/1.1\r\nHost: 192.168.4.1\r\n\r\n";
+
+// Three pipelined requests cut into 7-byte pbufs: three responses in order, the
+// last one closes, and every byte received is handed back to the window
+static void test_pipelining(void)
+{
+    static const char requests[] = "GET /data HTTP/1.1\r\nHost: x\r\n\r\n"
+                                   "GET /data HTTP/1.1\r\nHost: x\r\n\r\n"
+                                   "GET /success HTTP/1.1\r\nConnection: close\r\n\r\n";
+    lwip_sim_reset();
+    struct tcp_pcb *pcb = lwip_sim_connect();
+    TEST_CHECK(pcb != NULL);
+    lwip_sim_recv_str(pcb, requests, 7);
+
+    const char *out = lwip_sim_output(pcb, NULL);
+    TEST_CHECK(count(out, "HTTP/1.1 200 OK") == 3);
+    TEST_CHECK(count(out, "Connection: keep-alive") == 2);
+    TEST_CHECK(count(out, "Connection: close") == 1);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_CLOSED);
+    TEST_CHECK(lwip_sim_recved(pcb) == sizeof(requests) - 1);
+    TEST_CHECK(lwip_sim_pbufs_live() == 0);
+
+    // HTTP/1.0 without keep-alive closes after one response
+    pcb = lwip_sim_connect();
+    lwip_sim_recv_str(pcb, "GET /data HTTP/1.0\r\n\r\n", 0);
+    TEST_CHECK(count(lwip_sim_output(pcb, NULL), "Connection: close") == 1);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_CLOSED);
+}
+
+static void test_idle_timeout(void)
+{
+    lwip_sim_reset();
+    struct tcp_pcb *idle = lwip_sim_connect();
+    struct tcp_pcb *busy = lwip_sim_connect();
+    lwip_sim_recv_str(idle, request_data, 0);
+    ack_all(idle);
+
+    // A client sending a request every few polls is never idle long enough
+    int polls = 0;
+    while (lwip_sim_state(idle) == LWIP_SIM_OPEN && polls < MAX_POLLS)
+    {
+        if (polls % 3 == 0)
+        {
+            lwip_sim_recv_str(busy, request_data, 0);
+            ack_all(busy);
+        }
+        lwip_sim_poll(idle);
+        lwip_sim_poll(busy);
+        polls++;
+    }
+    printf("idle keep-alive connection closed after %d polls\n", polls);
+    TEST_CHECK(polls > 1 && polls < MAX_POLLS);
+    TEST_CHECK(lwip_sim_state(idle) == LWIP_SIM_CLOSED);
+    TEST_CHECK(lwip_sim_state(busy) == LWIP_SIM_OPEN);
+
+    // Once it stops, it times out after the same number of polls
+    lwip_sim_recv_str(busy, request_data, 0);
+    ack_all(busy);
+    TEST_CHECK(polls_until_closed(busy) == polls);
+}
+
+// A long /history response through a small send buffer: one chunk per ACK, with a
+// poll between ACKs. The client is reading all along, so it must not time out.
+static void test_slow_stream_not_idle(void)
+{
+    lwip_sim_reset();
+    for (int i = 0; i < 600; i++)
+    {
+        sim_advance_ns(100000000ull); // One history entry per 100 ms
+        wifi_update_data((uint16_t)(1000 + i), 2000, 3000, 500);
+    }
+
+    struct tcp_pcb *pcb = lwip_sim_connect();
+    lwip_sim_set_sndbuf(pcb, 400); // One history chunk in flight
+    lwip_sim_recv_str(pcb, "GET /history HTTP/1.1\r\nHost: x\r\n\r\n", 0);
+
+    int rounds = 0;
+    uint32_t len = 0;
+    while (lwip_sim_state(pcb) == LWIP_SIM_OPEN && rounds < 1000)
+    {
+        const char *out = lwip_sim_output(pcb, &len);
+        if (len >= 5 && memcmp(out + len - 5, "0\r\n\r\n", 5) == 0)
+            break;
+        lwip_sim_poll(pcb);
+        lwip_sim_poll(pcb);
+        lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+        rounds++;
+    }
+
+    const char *out = lwip_sim_output(pcb, &len);
+    printf("/history: %u bytes over %d ACKs, 2 polls each\n", (unsigned)len, rounds);
+    TEST_CHECK_MSG(lwip_sim_state(pcb) == LWIP_SIM_OPEN, "closed as idle after %d ACKs", rounds);
+    TEST_CHECK(rounds > 20);
+    TEST_CHECK(len >= 5 && memcmp(out + len - 5, "0\r\n\r\n", 5) == 0);
+    TEST_CHECK(count(out, ",1599,2000,3000,") == 1); // The newest entry made it
+}
+
+// HEAD gets exactly the GET headers and no body; streams and other methods get 405
+static void test_head(void)
+{
+    static const char *const paths[] = {"/", "/success", "/data", "/stats", "/history"};
+    char request[128];
+    uint32_t get_len, head_len;
+
+    lwip_sim_reset();
+    struct tcp_pcb *pcb = lwip_sim_connect();
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++)
+    {
+        snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\n\r\n", paths[i]);
+        lwip_sim_clear_output(pcb);
+        lwip_sim_recv_str(pcb, request, 0);
+        ack_all(pcb);
+        const char *get = lwip_sim_output(pcb, &get_len);
+        const char *end = strstr(get, "\r\n\r\n");
+        const uint32_t get_header_len = end ? (uint32_t)(end + 4 - get) : 0;
+        char get_header[1024];
+        snprintf(get_header, sizeof(get_header), "%.*s", (int)get_header_len, get);
+
+        snprintf(request, sizeof(request), "HEAD %s HTTP/1.1\r\n\r\n", paths[i]);
+        lwip_sim_clear_output(pcb);
+        lwip_sim_recv_str(pcb, request, 0);
+        ack_all(pcb);
+        const char *head = lwip_sim_output(pcb, &head_len);
+
+        // /stats changes between the two requests (uptime); compare up to the body
+        const bool same = head_len == get_header_len &&
+                          (strcmp(paths[i], "/stats") == 0 ? strncmp(head, get_header, 17) == 0
+                                                           : memcmp(head, get_header, head_len) == 0);
+        TEST_CHECK_MSG(same && get_len > get_header_len, "HEAD %s: %u header bytes of %u (GET header %u)", paths[i],
+                       (unsigned)head_len, (unsigned)get_len, (unsigned)get_header_len);
+        TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_OPEN);
+    }
+
+    lwip_sim_clear_output(pcb);
+    lwip_sim_recv_str(pcb, "HEAD /events HTTP/1.1\r\n\r\n", 0);
+    TEST_CHECK(strstr(lwip_sim_output(pcb, NULL), "405 Method Not Allowed\r\nAllow: GET\r\n") != NULL);
+
+    pcb = lwip_sim_connect();
+    lwip_sim_recv_str(pcb, "POST /data HTTP/1.1\r\nContent-Length: 0\r\n\r\n", 0);
+    TEST_CHECK(strstr(lwip_sim_output(pcb, NULL), "405 Method Not Allowed\r\nAllow: GET, HEAD\r\n") != NULL);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_CLOSED);
+}
+
+// With every slot taken, a new client evicts the connection idle the longest
+static void test_pool_eviction(void)
+{
+    struct tcp_pcb *pcbs[4];
+
+    lwip_sim_reset();
+    for (int i = 0; i < 4; i++)
+    {
+        pcbs[i] = lwip_sim_connect();
+        lwip_sim_recv_str(pcbs[i], request_data, 0);
+        ack_all(pcbs[i]);
+    }
+    // Connection 2 has been quiet the longest
+    for (int i = 0; i < 4; i++)
+        lwip_sim_poll(pcbs[i]);
+    lwip_sim_poll(pcbs[2]);
+    lwip_sim_poll(pcbs[2]);
+
+    struct tcp_pcb *late = lwip_sim_connect();
+    TEST_CHECK(late != NULL);
+    TEST_CHECK(lwip_sim_state(pcbs[2]) == LWIP_SIM_ABORTED);
+    for (int i = 0; i < 4; i++)
+    {
+        if (i != 2)
+            TEST_CHECK_MSG(lwip_sim_state(pcbs[i]) == LWIP_SIM_OPEN, "connection %d", i);
+    }
+
+    // Every connection, old and new, is still served
+    lwip_sim_recv_str(late, request_data, 0);
+    TEST_CHECK(count(lwip_sim_output(late, NULL), "HTTP/1.1 200 OK") == 1);
+    lwip_sim_clear_output(pcbs[0]);
+    lwip_sim_recv_str(pcbs[0], request_data, 0);
+    TEST_CHECK(count(lwip_sim_output(pcbs[0], NULL), "HTTP/1.1 200 OK") == 1);
+}
+
+// Closing (or being reset) with pipelined requests still queued frees their pbufs
+static void test_close_frees_buffers(void)
+{
+    static const char two_requests[] = "GET /data HTTP/1.1\r\nHost: x\r\n\r\nGET /data HTTP/1.1\r\nHost: x\r\n\r\n";
+
+    lwip_sim_reset();
+    struct tcp_pcb *a = lwip_sim_connect();
+    struct tcp_pcb *b = lwip_sim_connect();
+    // No send space: the first response waits, the second request stays in the receive chain
+    lwip_sim_set_sndbuf(a, 0);
+    lwip_sim_set_sndbuf(b, 0);
+    lwip_sim_recv_str(a, two_requests, 5);
+    lwip_sim_recv_str(b, two_requests, 0);
+    TEST_CHECK(lwip_sim_pbufs_live() > 0);
+    TEST_CHECK(lwip_sim_recved(a) < sizeof(two_requests) - 1);
+
+    // Half-closed, but still owed two responses: it goes when it times out instead
+    lwip_sim_fin(a);
+    TEST_CHECK(lwip_sim_state(a) == LWIP_SIM_OPEN);
+    TEST_CHECK(polls_until_closed(a) < MAX_POLLS);
+    TEST_CHECK(lwip_sim_state(a) == LWIP_SIM_CLOSED);
+    lwip_sim_reset();
+    TEST_CHECK(lwip_sim_state(b) == LWIP_SIM_RESET);
+    TEST_CHECK(lwip_sim_pbufs_live() == 0);
+    TEST_CHECK(lwip_sim_heap_used() == 0);
+
+    // The freed slots take new clients
+    for (int i = 0; i < 4; i++)
+    {
+        struct tcp_pcb *pcb = lwip_sim_connect();
+        lwip_sim_recv_str(pcb, request_data, 0);
+        TEST_CHECK(count(lwip_sim_output(pcb, NULL), "HTTP/1.1 200 OK") == 1);
+    }
+}
+
+// A client that sends its requests and then half-closes (shutdown(SHUT_WR)) still gets
+// every response, the pipelined ones and a page larger than the send buffer included,
+// and the connection closes once the last one is queued
+static void test_half_close(void)
+{
+    static const char requests[] = "GET / HTTP/1.1\r\nHost: x\r\n\r\n"
+                                   "GET /data HTTP/1.1\r\nHost: x\r\n\r\n"
+                                   "GET /stats HTTP/1.1\r\nHost: x\r\n\r\n"
+                                   "GET /history HTTP/1.1\r\nHost: x\r\n\r\n";
+    lwip_sim_reset();
+    struct tcp_pcb *pcb = lwip_sim_connect();
+    lwip_sim_set_sndbuf(pcb, 400);
+    lwip_sim_recv_str(pcb, requests, 0);
+    lwip_sim_fin(pcb);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_OPEN);
+
+    int rounds = 0;
+    while (lwip_sim_state(pcb) == LWIP_SIM_OPEN && rounds < 1000)
+    {
+        lwip_sim_ack(pcb, lwip_sim_unacked(pcb));
+        rounds++;
+    }
+    uint32_t len;
+    const char *out = lwip_sim_output(pcb, &len);
+    printf("half-closed client: 4 responses, %u bytes over %d ACKs, then closed\n", (unsigned)len, rounds);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_CLOSED);
+    TEST_CHECK(count_bytes(out, len, "HTTP/1.1 200 OK") == 4);
+    TEST_CHECK(len >= 5 && memcmp(out + len - 5, "0\r\n\r\n", 5) == 0); // /history finished
+    TEST_CHECK(lwip_sim_recved(pcb) == sizeof(requests) - 1);
+
+    // Nothing owed, or only half a request: closes right away
+    pcb = lwip_sim_connect();
+    lwip_sim_recv_str(pcb, request_data, 0);
+    ack_all(pcb);
+    lwip_sim_fin(pcb);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_CLOSED);
+    pcb = lwip_sim_connect();
+    lwip_sim_recv_str(pcb, "GET /data HTTP/1.1\r\nHo", 0);
+    lwip_sim_fin(pcb);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_CLOSED);
+    TEST_CHECK(lwip_sim_output(pcb, NULL)[0] == '\0');
+
+    // An event stream has no reader left once the client half-closes
+    pcb = lwip_sim_connect();
+    lwip_sim_recv_str(pcb, "GET /events HTTP/1.1\r\n\r\n", 0);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_OPEN);
+    lwip_sim_fin(pcb);
+    TEST_CHECK(lwip_sim_state(pcb) == LWIP_SIM_CLOSED);
+    TEST_CHECK(lwip_sim_pbufs_live() == 0);
+}
+
+// True if the output is one response whose body is exactly Content-Length bytes of JSON
+static bool is_complete_json(const struct tcp_pcb *pcb)
+{
+    uint32_t len;
+    const char *out = lwip_sim_output(pcb, &len);
+    const char *length = strstr(out, "Content-Length: ");
+    const char *body = strstr(out, "\r\n\r\n");
+    if (!length || !body)
+        return false;
+    body += 4;
+    const uint32_t body_len = (uint32_t)(out + len - body);
+    return strtoul(length + 16, NULL, 10) == body_len && body[0] == '{' && memcmp(out + len - 2, "}}", 2) == 0;
+}
+
+// /stats is bigger than what other traffic leaves of the lwIP heap: the body streams
+// in pieces as ACKs free memory instead of being cut short, and while one client's
+// body is still being queued a second /stats waits for it
+static void test_stats_tight_heap(void)
+{
+    lwip_sim_reset();
+    lwip_sim_set_heap(900); // What other traffic left: less than header and body together
+    struct tcp_pcb *a = lwip_sim_connect();
+    struct tcp_pcb *b = lwip_sim_connect();
+
+    lwip_sim_recv_str(a, "GET /stats HTTP/1.1\r\n\r\n", 0);
+    lwip_sim_recv_str(b, "GET /stats HTTP/1.1\r\n\r\n", 0);
+    TEST_CHECK(lwip_sim_output(b, NULL)[0] == '\0');
+
+    int rounds = 0;
+    while ((lwip_sim_unacked(a) || lwip_sim_unacked(b) || lwip_sim_output(b, NULL)[0] == '\0') && rounds < MAX_POLLS)
+    {
+        lwip_sim_ack(a, lwip_sim_unacked(a));
+        lwip_sim_ack(b, lwip_sim_unacked(b));
+        lwip_sim_poll(b);
+        rounds++;
+    }
+    printf("/stats twice through a 900-byte heap: %d rounds, %u bytes\n", rounds,
+           (unsigned)strlen(lwip_sim_output(a, NULL)));
+    TEST_CHECK(is_complete_json(a) && is_complete_json(b));
+    TEST_CHECK(lwip_sim_state(a) == LWIP_SIM_OPEN && lwip_sim_state(b) == LWIP_SIM_OPEN);
+    TEST_CHECK(lwip_sim_heap_used() == 0);
+
+    lwip_sim_set_heap(MEM_SIZE);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Load generator: BENCH_CLIENTS keep-alive clients take turns sending a request from a
+// dashboard-like mix and reading the whole response (ACKing as it arrives). Latency is
+// the host time from the request arriving to the last byte of its response being
+// queued; requests/sec is the server-side throughput on the host, not on the Pico.
+#define BENCH_CLIENTS 4
+#define BENCH_REQUESTS 20000
+
+static void bench(void)
+{
+    static const char *const mix[] = {
+        "GET /data HTTP/1.1\r\nHost: x\r\n\r\n", "GET /data HTTP/1.1\r\nHost: x\r\n\r\n",
+        "GET /data HTTP/1.1\r\nHost: x\r\n\r\n", "GET /data HTTP/1.1\r\nHost: x\r\n\r\n",
+        "GET / HTTP/1.1\r\nHost: x\r\n\r\n",     "GET /stats HTTP/1.1\r\nHost: x\r\n\r\n",
+        "GET /history HTTP/1.1\r\nHost: x\r\n\r\n",
+    };
+    static double latency_us[BENCH_REQUESTS];
+    struct tcp_pcb *clients[BENCH_CLIENTS];
+    int answered = 0;
+
+    lwip_sim_reset();
+    for (int c = 0; c < BENCH_CLIENTS; c++)
+        clients[c] = lwip_sim_connect();
+
+    const double start = now_s();
+    for (int i = 0; i < BENCH_REQUESTS; i++)
+    {
+        struct tcp_pcb *pcb = clients[i % BENCH_CLIENTS];
+        lwip_sim_clear_output(pcb);
+        const double t0 = now_s();
+        lwip_sim_recv_str(pcb, mix[i % (int)(sizeof(mix) / sizeof(mix[0]))], 0);
+        ack_all(pcb);
+        latency_us[i] = (now_s() - t0) * 1e6;
+        answered += count(lwip_sim_output(pcb, NULL), "HTTP/1.1 200 OK");
+    }
+    const double elapsed = now_s() - start;
+
+    qsort(latency_us, BENCH_REQUESTS, sizeof(latency_us[0]), compare_double);
+    printf("bench (host, %d clients, %d requests): %.0f requests/s, latency p50 %.1f us, p99 %.1f us, max %.1f us\n",
+           BENCH_CLIENTS, BENCH_REQUESTS, BENCH_REQUESTS / elapsed, latency_us[BENCH_REQUESTS / 2],
+           latency_us[BENCH_REQUESTS * 99 / 100], latency_us[BENCH_REQUESTS - 1]);
+    TEST_CHECK_MSG(answered == BENCH_REQUESTS, "%d of %d answered", answered, BENCH_REQUESTS);
+    for (int c = 0; c < BENCH_CLIENTS; c++)
+        TEST_CHECK(lwip_sim_state(clients[c]) == LWIP_SIM_OPEN);
+    TEST_CHECK(lwip_sim_heap_used() == 0);
+}
+
+int main(void)
+{
+    loop_stats_init(); // As main.c does before any stage runs or /stats is served
+    wifi_init_ap("test", "password");
+    wifi_update_data(1000, 2000, 3000, 500);
+
+    test_pipelining();
+    test_idle_timeout();
+    test_slow_stream_not_idle();
+    test_head();
+    test_pool_eviction();
+    test_close_frees_buffers();
+    test_half_close();
+    test_stats_tight_heap();
+    bench();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,72 @@
+#include "udp_telemetry.h"
+#include "pico/cyw43_arch.h"
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+#include "lwip/ip_addr.h"
+
+static struct udp_pcb *telemetry_pcb = NULL;
+static uint32_t telemetry_seq = 0;
+
+// -----------------------------------------------------------------------------
+// Internal helpers
+// -----------------------------------------------------------------------------
+
+static inline void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+// -----------------------------------------------------------------------------
+// Public API implementation
+// -----------------------------------------------------------------------------
+
+void udp_telemetry_init(void)
+{
+    if (!UDP_TELEMETRY_ENABLED || telemetry_pcb)
+        return;
+
+    telemetry_pcb = udp_new();
+    if (!telemetry_pcb)
+        return;
+#if IP_SOF_BROADCAST
+    ip_set_option(telemetry_pcb, SOF_BROADCAST);
+#endif
+    telemetry_seq = 0;
+}
+
+void udp_telemetry_publish(uint32_t time_ms, uint16_t r, uint16_t g, uint16_t b, uint16_t correctness, bool success)
+{
+    if (!telemetry_pcb)
+        return;
+
+    // Numbered before anything can fail, so every lost reading leaves a gap
+    const uint32_t seq = telemetry_seq++;
+
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, UDP_TELEMETRY_PACKET_SIZE, PBUF_RAM);
+    if (!p)
+        return; // Out of memory: this reading is lost, the sequence number shows it
+
+    uint8_t *packet = (uint8_t *)p->payload;
+    packet[0] = UDP_TELEMETRY_MAGIC;
+    packet[1] = UDP_TELEMETRY_VERSION;
+    put_u16(packet + 2, success ? UDP_TELEMETRY_FLAG_SUCCESS : 0);
+    put_u32(packet + 4, seq);
+    put_u32(packet + 8, time_ms);
+    put_u16(packet + 12, r);
+    put_u16(packet + 14, g);
+    put_u16(packet + 16, b);
+    put_u16(packet + 18, correctness);
+
+    // Subnet broadcast on the AP interface
+    ip_addr_t broadcast;
+    IP4_ADDR(ip_2_ip4(&broadcast), 192, 168, 4, 255);
+    udp_sendto_if(telemetry_pcb, p, &broadcast, UDP_TELEMETRY_PORT, &cyw43_state.netif[CYW43_ITF_AP]);
+    pbuf_free(p);
+}
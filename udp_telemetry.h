@@ -0,0 +1,38 @@
+#ifndef UDP_TELEMETRY_H
+#define UDP_TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// --- CONFIGURATION ---
+// Broadcast every reading on the AP subnet (off by default: costs airtime even with no listeners)
+#ifndef UDP_TELEMETRY_ENABLED
+#define UDP_TELEMETRY_ENABLED 0
+#endif
+#define UDP_TELEMETRY_PORT 4210
+
+// Packet layout (20 bytes, little-endian):
+//   0  uint8   magic 'T'
+//   1  uint8   version (1)
+//   2  uint16  flags (bit 0: success locked)
+//   4  uint32  sequence number (gaps = lost packets)
+//   8  uint32  milliseconds since boot
+//   12 uint16  r, g, b (Hz)
+//   18 uint16  correctness (tenths of a percent)
+#define UDP_TELEMETRY_MAGIC 'T'
+#define UDP_TELEMETRY_VERSION 1
+#define UDP_TELEMETRY_PACKET_SIZE 20
+#define UDP_TELEMETRY_FLAG_SUCCESS (1u << 0)
+
+/**
+ * @brief Fire-and-forget telemetry for any number of viewers.
+ *
+ * One broadcast datagram per reading to 192.168.4.255, so the cost is the same
+ * whether nobody or every phone in the AP is listening.
+ */
+void udp_telemetry_init(void);
+
+// Broadcast one reading (call with the lwIP lock held)
+void udp_telemetry_publish(uint32_t time_ms, uint16_t r, uint16_t g, uint16_t b, uint16_t correctness, bool success);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef WEB_ASSETS_H
+#define WEB_ASSETS_H
+
+#include <stdint.h>
+
+/**
+ * @brief One way of sending an asset's body, with its own ETag and prebuilt headers.
+ *
+ * The prebuilt headers carry everything but the Connection line and the blank line
+ * that end the header block, including "Vary: Accept-Encoding".
+ */
+typedef struct
+{
+    const char *etag;         // Strong ETag, quotes included (differs per encoding)
+    const uint8_t *data;
+    uint32_t len;
+    const char *header;       // "HTTP/1.1 200 OK\r\n...": status, type, encoding, length, ETag, caching
+    uint16_t header_len;
+    const char *not_modified; // "HTTP/1.1 304 Not Modified\r\n...", for a matching If-None-Match
+    uint16_t not_modified_len;
+} web_asset_body_t;
+
+/**
+ * @brief One embedded web asset (generated from web/ by cmake/embed_assets.cmake).
+ *
+ * Bodies are minified at build time and live in flash twice: gzip-compressed for
+ * clients whose Accept-Encoding allows it, and plain for everyone else (no header,
+ * "identity", curl without --compressed, ...).
+ */
+typedef struct
+{
+    const char *path;          // Route, e.g. "/" or "/success"
+    const char *content_type;
+    web_asset_body_t gzip;     // Content-Encoding: gzip
+    web_asset_body_t identity; // The minified file as is
+} web_asset_t;
+
+// Route table, in the order the assets are listed in CMakeLists.txt
+extern const web_asset_t web_assets[];
+extern const uint16_t web_asset_count;
+
+#endif
@@ -1,172 +1,1167 @@
 #include "wifi_server.h"
+#include "correctness.h"
+#include "target_set.h"
+#include "sha1.h"
+#include "web_assets.h"
+#include "http_parser.h"
+#include "history.h"
+#include "udp_telemetry.h"
+#include "loop_stats.h"
+#include "scheduler.h"
 #include "pico/cyw43_arch.h"
 #include "lwip/pbuf.h"
 #include "lwip/tcp.h"
 #include "lwip/netif.h"
 #include "lwip/err.h"
+#include "lwip/stats.h"
+#include "lwip/memp.h"
 #include <stdbool.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
-// Forward declaration for poll callback (lwIP expects err_t return type)
-static err_t poll_close_cb(void *arg, struct tcp_pcb *tpcb);
+// --- CONNECTION SETTINGS ---
+// Keep-alive connections served at once (lwIP default MEMP_NUM_TCP_PCB is 5, one is the listener)
+#define HTTP_MAX_CONNECTIONS 4
+// tcp_poll interval in lwIP coarse ticks (2 x 500 ms = 1 s)
+#define HTTP_POLL_INTERVAL 2
+// Close a keep-alive connection after this many idle poll intervals
+#define HTTP_IDLE_TIMEOUT_POLLS 10
+
+// --- SERVER-SENT EVENTS (/events) ---
+// Only push when a channel moves by at least this much...
+#define SSE_MIN_DELTA_HZ 10
+#define SSE_MIN_DELTA_CORRECTNESS 5 // Tenths of a percent
+// ...and never more often than this
+#define SSE_MIN_INTERVAL_MS 100
+// A subscriber with more than this many unacknowledged bytes is skipped; it gets
+// the latest state once it catches up (events are coalesced, never queued)
+#define SSE_MAX_UNACKED 512
+// Comment line sent after this many quiet poll intervals so proxies/browsers keep the stream
+#define SSE_HEARTBEAT_POLLS 15
+
+// --- HISTORY (/history) ---
+// Payload bytes per chunk (one tcp_write each)
+#define HISTORY_CHUNK_MAX 384
+// Longest CSV row: "4294967295,4294967295,65535,65535,65535,100.0\n"
+#define HISTORY_CSV_ROW_MAX 48
+#define HISTORY_BIN_ROW_SIZE 16
+
+// --- STATS (/stats) ---
+// Room for the whole document (stage histograms, scheduler tasks, lwIP pools: about 2 KB)
+#define STATS_JSON_MAX 3072
+// The body is copied into the lwIP heap this much at a time, paced by tcp_sent
+#define STATS_CHUNK_MAX 512
+
+// --- WEBSOCKET (/ws) ---
+// Telemetry frames are skipped (not queued) while a client has this much unacknowledged
+#define WS_MAX_UNACKED 256
+// Ping a quiet client after this many poll intervals
+#define WS_PING_POLLS 15
+// Largest control frame payload (RFC 6455 5.5)
+#define WS_MAX_CONTROL_PAYLOAD 125
+
+// Binary telemetry frame: one byte of WS_FIELD_* flags, then every flagged field
+// in bit order as uint16 little-endian. Only fields that changed since the previous
+// frame to that client are present; the first frame after the handshake has all.
+#define WS_FIELD_R (1u << 0)
+#define WS_FIELD_G (1u << 1)
+#define WS_FIELD_B (1u << 2)
+#define WS_FIELD_CORRECTNESS (1u << 3) // Tenths of a percent
+#define WS_FIELD_SUCCESS (1u << 4)     // 0 or 1
+#define WS_FIELD_TARGET (1u << 5)      // Target index (names are in /data)
+#define WS_FIELD_COUNT 6
+
+typedef enum
+{
+    HTTP_CONN_REQUEST,   // Plain (keep-alive) HTTP
+    HTTP_CONN_SSE,       // /events stream
+    HTTP_CONN_WEBSOCKET, // Upgraded /ws connection
+} http_conn_mode_t;
+
+// Per-connection state (one per accepted PCB)
+typedef struct
+{
+    struct tcp_pcb *pcb;
+    bool in_use;
+    bool close_pending;  // Close once the current response has been queued
+    bool peer_closed;    // Client half-closed: answer what it already sent, then close
+    uint8_t idle_polls;  // Poll intervals since the last activity
+    uint8_t mode;        // http_conn_mode_t
+    bool sse_pending;    // Latest state not yet delivered (client was behind)
+    uint16_t unacked;    // Bytes written but not yet acknowledged
+    const char *tx_ptr;  // Rest of a static body still to be queued (see http_stream)
+    uint32_t tx_left;
+    bool tx_copy;        // tx_ptr is stats_body (RAM, reused): copy it out in STATS_CHUNK_MAX pieces
+    bool history_active; // A /history response is being generated
+    bool history_binary; // Packed records instead of CSV
+    bool history_chunked; // Chunked transfer coding (HTTP/1.1); otherwise the end is the close
+    uint32_t history_seq; // Next entry to send
+    uint32_t history_end; // Entry the response stops before (fixed when the request arrived)
+    bool ws_synced;      // WebSocket client has had a full frame (later frames are deltas)
+    uint16_t ws_last[WS_FIELD_COUNT]; // Field values last sent to this WebSocket client
+    uint32_t ws_skip;    // Payload bytes of an ignored data frame still to discard
+    struct pbuf *rx;     // Received but unprocessed data (not yet tcp_recved, so the window throttles the client)
+    http_parser_t parser;
+    bool request_ready;  // Parser holds a complete request whose response did not fit yet
+} http_conn_t;
+
+static http_conn_t http_conns[HTTP_MAX_CONNECTIONS];
+
+// /stats document being streamed; one response at a time owns it (see stats_start)
+static char stats_body[STATS_JSON_MAX];
 
 static uint16_t global_r = 0, global_g = 0, global_b = 0;
-static float global_correctness = 0.0f;
+static uint16_t global_correctness = 0;    // Tenths of a percent
 static bool global_success_locked = false; // Lock at 97%
+static uint16_t global_target_index = 0;
+static char global_target_name[TARGET_NAME_LEN + 1] = "";
+
+// Last state pushed to /events subscribers (for change detection and rate limiting)
+static uint16_t sse_last_r = 0, sse_last_g = 0, sse_last_b = 0;
+static uint16_t sse_last_correctness = 0;
+static bool sse_last_success = false;
+static uint32_t sse_last_push_ms = 0;
+
+// Pages are built from web/ by cmake/embed_assets.cmake (minified, gzipped and plain, in flash)
+// and sent without TCP_WRITE_FLAG_COPY. Their headers are prebuilt at build time
+// minus the Connection line, which is one of two constant strings picked per request.
+static const char http_connection_keep_alive[] = "Connection: keep-alive\r\n\r\n";
+static const char http_connection_close[] = "Connection: close\r\n\r\n";
 
-// --- HTML CODE (Stored as a string) ---
-// This includes a script that automatically fetches /data every 500ms
-static const char *html_page_body =
-    "<!DOCTYPE html><html><head><meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">"
-    "<style>"
-    "body { font-family: sans-serif; text-align: center; background: #1a1a1a; color: white; }"
-    ".box { width: 100px; height: 100px; margin: 20px auto; border: 2px solid #fff; }"
-    ".bar-container { width: 80%; background: #444; margin: 10px auto; height: 30px; border-radius: 15px; }"
-    ".bar { height: 100%; background: #4caf50; width: 0%; border-radius: 15px; transition: width 0.5s; }"
-    "</style></head>"
-    "<body>"
-    "<h1>Spectral Interface</h1>"
-    "<h3>Current Mix</h3>"
-    "<div id=\"colorBox\" class=\"box\"></div>"
-    "<h3>Correctness: <span id=\"per\">0</span>%</h3>"
-    "<div class=\"bar-container\"><div id=\"bar\" class=\"bar\"></div></div>"
-    "<p>R: <span id=\"r\">0</span> G: <span id=\"g\">0</span> B: <span id=\"b\">0</span></p>"
-    "<script>"
-    "let hasTriggeredSuccess = false;"
-    "function update(){"
-    "  fetch('/data?t=' + Date.now(), {cache: 'no-store'})"
-    "    .then(r => r.json())"
-    "    .then(data => {"
-    "      document.getElementById('r').innerText = data.r;"
-    "      document.getElementById('g').innerText = data.g;"
-    "      document.getElementById('b').innerText = data.b;"
-    "      document.getElementById('per').innerText = Math.round(data.correctness);"
-    "      document.getElementById('bar').style.width = data.correctness + '%';"
-    "      document.getElementById('colorBox').style.backgroundColor = 'rgb(' + (data.r/10) + ',' + (data.g/10) + ',' + (data.b/10) + ')';"
-    "      if (data.success === true && !hasTriggeredSuccess) {"
-    "        hasTriggeredSuccess = true;"
-    "        setTimeout(() => { window.location = '/success'; }, 500);"
-    "      }"
-    "    })"
-    "    .catch(err => console.log('Error:', err));"
-    "}"
-    "setInterval(update, 500);"
-    "update();"
-    "</script></body></html>";
-
-// Success page for >= 97% accuracy
-static const char *success_page_body =
-    "<!DOCTYPE html><html><head><meta name=\"viewport\" content=\"width=device-width, initial-scale=1\">"
-    "<style>"
-    "body { font-family: sans-serif; text-align: center; background: linear-gradient(135deg, #2a5 0%, #1a3 100%); color: white; min-height: 100vh; display: flex; flex-direction: column; justify-content: center; align-items: center; margin: 0; padding: 20px; }"
-    "h1 { font-size: 48px; margin: 20px 0; animation: pulse 1s infinite; }"
-    ".sequence { font-size: 32px; font-weight: bold; margin: 30px 0; letter-spacing: 10px; }"
-    ".pattern { font-size: 18px; margin: 20px 0; }"
-    ".back-link { margin-top: 40px; }"
-    ".back-link a { color: white; text-decoration: none; padding: 10px 20px; border: 2px solid white; border-radius: 5px; }"
-    "@keyframes pulse { 0%, 100% { opacity: 1; } 50% { opacity: 0.7; } }"
-    "</style></head>"
-    "<body>"
-    "<h1>🎉 SUCCESS! 🎉</h1>"
-    "<div class=\"sequence\">2, 6, 18, 54, X</div>"
-    "<div class=\"pattern\">Geometric Sequence<br>Each term × 3</div>"
-    "<div class=\"back-link\"><a href=\"/\">Back to Calibration</a></div>"
-    "</body></html>";
-
-static err_t http_callback(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+// -----------------------------------------------------------------------------
+// Connection management
+// -----------------------------------------------------------------------------
+
+static void http_conn_free(http_conn_t *conn)
 {
-    if (p == NULL)
+    conn->in_use = false;
+    conn->mode = HTTP_CONN_REQUEST;
+    conn->pcb = NULL;
+    if (conn->rx)
     {
-        tcp_close(tpcb);
-        return ERR_OK;
+        pbuf_free(conn->rx);
+        conn->rx = NULL;
+    }
+}
+
+// Detach callbacks and close. Returns ERR_ABRT if the PCB had to be aborted,
+// which lwIP callbacks must pass back.
+static err_t http_conn_close(http_conn_t *conn)
+{
+    struct tcp_pcb *pcb = conn->pcb;
+    err_t result = ERR_OK;
+
+    tcp_arg(pcb, NULL);
+    tcp_recv(pcb, NULL);
+    tcp_sent(pcb, NULL);
+    tcp_poll(pcb, NULL, 0);
+    tcp_err(pcb, NULL);
+
+    if (tcp_close(pcb) != ERR_OK)
+    {
+        tcp_abort(pcb);
+        result = ERR_ABRT;
+    }
+
+    http_conn_free(conn);
+    return result;
+}
+
+static http_conn_t *http_conn_alloc(void)
+{
+    http_conn_t *idlest = NULL;
+
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        if (!http_conns[i].in_use)
+            return &http_conns[i];
+        if (!idlest || http_conns[i].idle_polls > idlest->idle_polls)
+            idlest = &http_conns[i];
+    }
+
+    // Pool full: evict the connection that has been idle the longest
+    tcp_arg(idlest->pcb, NULL);
+    tcp_abort(idlest->pcb);
+    http_conn_free(idlest);
+    return idlest;
+}
+
+// -----------------------------------------------------------------------------
+// Request handling
+// -----------------------------------------------------------------------------
+
+// Drop the first len bytes of the receive chain and open the window by as much
+static void http_rx_consume(http_conn_t *conn, uint16_t len)
+{
+    if (len == 0)
+        return;
+    conn->rx = pbuf_free_header(conn->rx, len);
+    tcp_recved(conn->pcb, len);
+}
+
+// Run the parser over the receive chain, one pbuf at a time, without copying.
+// Consumes exactly the request head; a pipelined next request stays queued.
+static http_parse_result_t http_rx_parse(http_conn_t *conn)
+{
+    http_parse_result_t result = HTTP_PARSE_INCOMPLETE;
+    uint16_t used = 0;
+
+    for (struct pbuf *q = conn->rx; q && result == HTTP_PARSE_INCOMPLETE; q = q->next)
+    {
+        uint16_t consumed = 0;
+        result = http_parser_feed(&conn->parser, (const char *)q->payload, q->len, &consumed);
+        used += consumed;
     }
 
-    char *request = (char *)p->payload;
-    tcp_recved(tpcb, p->tot_len);
+    http_rx_consume(conn, used);
+    return result;
+}
+
+// Write raw bytes, tracking them until acknowledged
+static err_t http_write(http_conn_t *conn, const void *data, u16_t len, u8_t flags)
+{
+    err_t result = tcp_write(conn->pcb, data, len, flags);
+    if (result == ERR_OK)
+        conn->unacked += len;
+    return result;
+}
+
+static int history_format(const history_entry_t *entry, bool binary, char *out)
+{
+    if (!binary)
+        return sprintf(out, "%lu,%lu,%u,%u,%u,%u.%u\n", (unsigned long)entry->seq, (unsigned long)entry->time_ms,
+                       entry->r, entry->g, entry->b, entry->correctness / 10u, entry->correctness % 10u);
+
+    // seq, time_ms (uint32), r, g, b, correctness (uint16), all little-endian
+    const uint32_t words[2] = {entry->seq, entry->time_ms};
+    const uint16_t halves[4] = {entry->r, entry->g, entry->b, entry->correctness};
+    int len = 0;
+    for (int i = 0; i < 2; i++)
+        for (int k = 0; k < 4; k++)
+            out[len++] = (char)(words[i] >> (8 * k));
+    for (int i = 0; i < 4; i++)
+        for (int k = 0; k < 2; k++)
+            out[len++] = (char)(halves[i] >> (8 * k));
+    return len;
+}
+
+// Generate the /history body one chunk at a time, as long as lwIP has room.
+// Entries overwritten while the response is in flight are skipped (the sequence
+// numbers show the gap). Returns true once the body is complete.
+static bool history_stream(http_conn_t *conn)
+{
+    static const char last_chunk[] = "0\r\n\r\n";
+    const int start = conn->history_chunked ? 6 : 0; // Room for "XXXX\r\n"
 
-    // 0. Check if SUCCESS page requested
-    if (strstr(request, "GET /success"))
+    while (conn->history_active)
     {
-        int body_len = strlen(success_page_body);
-        char header[256];
-        int header_len = snprintf(header, sizeof(header),
-                                  "HTTP/1.1 200 OK\r\n"
-                                  "Content-Type: text/html; charset=utf-8\r\n"
-                                  "Connection: close\r\n"
-                                  "Cache-Control: no-store, no-cache, must-revalidate, max-age=0\r\n"
-                                  "Pragma: no-cache\r\n"
-                                  "Content-Length: %d\r\n\r\n",
-                                  body_len);
-        tcp_write(tpcb, header, header_len, TCP_WRITE_FLAG_COPY);
-        tcp_write(tpcb, success_page_body, body_len, TCP_WRITE_FLAG_COPY);
-        tcp_output(tpcb);
-        tcp_close(tpcb);
+        char chunk[6 + HISTORY_CHUNK_MAX + 2];
+        int len = start;
+        const uint32_t first_seq = conn->history_seq;
+
+        if (tcp_sndbuf(conn->pcb) < sizeof(chunk) || tcp_sndqueuelen(conn->pcb) >= TCP_SND_QUEUELEN - 1)
+            return false;
+
+        while (conn->history_seq < conn->history_end && len + HISTORY_CSV_ROW_MAX <= start + HISTORY_CHUNK_MAX)
+        {
+            history_entry_t entry;
+            if (!history_get(conn->history_seq, &entry))
+            {
+                conn->history_seq = history_oldest_seq(); // Fell behind the writer
+                continue;
+            }
+            len += history_format(&entry, conn->history_binary, chunk + len);
+            conn->history_seq++;
+        }
+
+        if (len == start)
+        {
+            // Done
+            if (conn->history_chunked)
+                http_write(conn, last_chunk, sizeof(last_chunk) - 1, 0);
+            else
+                conn->close_pending = true;
+            conn->history_active = false;
+            break;
+        }
+
+        if (conn->history_chunked)
+        {
+            char size[7];
+            snprintf(size, sizeof(size), "%04x\r\n", len - start);
+            memcpy(chunk, size, 6);
+            chunk[len++] = '\r';
+            chunk[len++] = '\n';
+        }
+        if (http_write(conn, chunk, len, TCP_WRITE_FLAG_COPY) != ERR_OK)
+        {
+            conn->history_seq = first_seq; // Out of segments: regenerate this chunk on the next ACK
+            return false;
+        }
+    }
+    return true;
+}
+
+// Queue as much of the pending body as lwIP will take; tcp_sent calls back in
+// here as the window opens. Returns true once it is all queued.
+static bool http_stream(http_conn_t *conn)
+{
+    if (conn->history_active)
+        return history_stream(conn);
+
+    while (conn->tx_left > 0)
+    {
+        u16_t room = tcp_sndbuf(conn->pcb);
+        if (room == 0 || tcp_sndqueuelen(conn->pcb) >= TCP_SND_QUEUELEN - 1)
+            return false;
+
+        if (conn->tx_copy && room > STATS_CHUNK_MAX)
+            room = STATS_CHUNK_MAX;
+
+        u16_t chunk = (conn->tx_left < room) ? (u16_t)conn->tx_left : room;
+        u8_t flags = (chunk < conn->tx_left) ? TCP_WRITE_FLAG_MORE : 0;
+        if (conn->tx_copy)
+            flags |= TCP_WRITE_FLAG_COPY;
+        if (http_write(conn, conn->tx_ptr, chunk, flags) != ERR_OK)
+            return false; // Out of segments, retry on the next ACK
+
+        conn->tx_ptr += chunk;
+        conn->tx_left -= chunk;
+    }
+    return true;
+}
+
+// True if the client's If-None-Match lists the asset's current ETag (or is "*").
+// Weak comparison, as RFC 7232 asks for If-None-Match, so W/"..." matches too.
+static bool http_etag_matches(const char *if_none_match, const char *etag)
+{
+    if (strcmp(if_none_match, "*") == 0)
+        return true;
+    return etag[0] != '\0' && strstr(if_none_match, etag) != NULL;
+}
+
+// Send a fixed error response and close once it is out
+static bool http_send_error(http_conn_t *conn, const char *response, u16_t len)
+{
+    if (tcp_sndbuf(conn->pcb) < len)
+        return false;
+    http_write(conn, response, len, 0); // Static, no copy needed
+    conn->close_pending = true;
+    return true;
+}
+
+static const char http_bad_request[] = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+static const char http_method_not_allowed[] =
+    "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET, HEAD\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+// /events and /ws are streams: there is no header-only form of them
+static const char http_stream_not_allowed[] =
+    "HTTP/1.1 405 Method Not Allowed\r\nAllow: GET\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+// RFC 6455 4.4: name the version we speak
+static const char http_upgrade_required[] = "HTTP/1.1 426 Upgrade Required\r\nSec-WebSocket-Version: 13\r\n"
+                                            "Content-Length: 0\r\nConnection: close\r\n\r\n";
+
+// HEAD: the same headers as GET, no body (RFC 7231 4.3.2)
+static bool http_head_only(const http_conn_t *conn)
+{
+    return conn->parser.method == HTTP_METHOD_HEAD;
+}
+
+// Start a static page in one of its encodings. Only the header has to fit now; the
+// body streams behind it. A revalidation with a matching ETag gets 304 and no body.
+static bool http_send_static(http_conn_t *conn, const web_asset_body_t *page, bool not_modified)
+{
+    const char *connection = conn->close_pending ? http_connection_close : http_connection_keep_alive;
+    const u16_t connection_len = conn->close_pending ? sizeof(http_connection_close) - 1
+                                                     : sizeof(http_connection_keep_alive) - 1;
+    const char *header = not_modified ? page->not_modified : page->header;
+    const u16_t header_len = not_modified ? page->not_modified_len : page->header_len;
+
+    if (tcp_sndbuf(conn->pcb) < header_len + connection_len || tcp_sndqueuelen(conn->pcb) > TCP_SND_QUEUELEN - 4)
+        return false;
+
+    const bool body = !not_modified && !http_head_only(conn);
+    if (http_write(conn, header, header_len, TCP_WRITE_FLAG_MORE) != ERR_OK)
+        return false;
+    if (http_write(conn, connection, connection_len, body ? TCP_WRITE_FLAG_MORE : 0) != ERR_OK)
+    {
+        conn->close_pending = true; // Header is already queued, the stream is unusable
+        return true;
+    }
+
+    if (body)
+    {
+        conn->tx_ptr = (const char *)page->data;
+        conn->tx_left = page->len;
+        conn->tx_copy = false;
+        http_stream(conn);
+    }
+    return true;
+}
+
+// 200 header for a generated (never cached) body
+static int http_format_header(const http_conn_t *conn, char *header, int size, const char *content_type, int body_len)
+{
+    return snprintf(header, size,
+                    "HTTP/1.1 200 OK\r\n"
+                    "Content-Type: %s\r\n"
+                    "Connection: %s\r\n"
+                    "Cache-Control: no-store, no-cache, must-revalidate, max-age=0\r\n"
+                    "Pragma: no-cache\r\n"
+                    "Content-Length: %d\r\n\r\n",
+                    content_type, conn->close_pending ? "close" : "keep-alive", body_len);
+}
+
+// Queue one complete small response. Returns false (nothing queued) if lwIP has no room yet.
+static bool http_send_response(http_conn_t *conn, const char *content_type, const char *body, int body_len)
+{
+    char header[256];
+    int header_len = http_format_header(conn, header, sizeof(header), content_type, body_len);
+
+    if (http_head_only(conn))
+        return tcp_sndbuf(conn->pcb) >= header_len &&
+               http_write(conn, header, header_len, TCP_WRITE_FLAG_COPY) == ERR_OK;
+
+    // All or nothing, so a half-written response never goes out
+    if (tcp_sndbuf(conn->pcb) < (u16_t)(header_len + body_len) || tcp_sndqueuelen(conn->pcb) > TCP_SND_QUEUELEN - 4)
+        return false;
+
+    if (http_write(conn, header, header_len, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE) != ERR_OK)
+        return false;
+    if (http_write(conn, body, body_len, TCP_WRITE_FLAG_COPY) != ERR_OK)
+    {
+        conn->close_pending = true; // Header is already queued, the stream is unusable
+        return true;
+    }
+    return true;
+}
+
+static int http_build_json(char *buf, int size)
+{
+    return snprintf(buf, size,
+                    "{\"r\":%d,\"g\":%d,\"b\":%d,\"correctness\":%u.%u,\"success\":%s,\"target\":\"%s\",\"target_index\":%u}",
+                    global_r, global_g, global_b, global_correctness / 10u, global_correctness % 10u,
+                    global_success_locked ? "true" : "false", global_target_name, global_target_index);
+}
+
+#if LWIP_STATS && MEMP_STATS
+static int stats_format_pool(char *buf, int size, const char *name, const struct stats_mem *pool)
+{
+    return snprintf(buf, size, ",\"%s\":{\"used\":%u,\"max\":%u,\"avail\":%u,\"err\":%u}", name,
+                    (unsigned)pool->used, (unsigned)pool->max, (unsigned)pool->avail, (unsigned)pool->err);
+}
+#endif
+
+// Stage timing (see loop_stats.h), scheduler jitter / overruns plus lwIP heap / pool usage and open connections
+static int stats_format_json(char *buf, int size)
+{
+    int len = snprintf(buf, size, "{\"uptime_ms\":%lu,\"loop\":", (unsigned long)to_ms_since_boot(get_absolute_time()));
+    if (len < size)
+        len += loop_stats_format_json(buf + len, size - len);
+    if (len < size)
+        len += snprintf(buf + len, size - len, ",\"scheduler\":");
+    if (len < size)
+        len += scheduler_format_json(buf + len, size - len);
+
+    int connections = 0;
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+        connections += http_conns[i].in_use;
+    if (len < size)
+        len += snprintf(buf + len, size - len, ",\"http_connections\":%d,\"lwip\":{", connections);
+
+#if LWIP_STATS && MEM_STATS
+    if (len < size)
+        len += snprintf(buf + len, size - len, "\"heap\":{\"used\":%u,\"max\":%u,\"avail\":%u,\"err\":%u}",
+                        (unsigned)lwip_stats.mem.used, (unsigned)lwip_stats.mem.max, (unsigned)lwip_stats.mem.avail,
+                        (unsigned)lwip_stats.mem.err);
+#else
+    if (len < size)
+        len += snprintf(buf + len, size - len, "\"heap\":null");
+#endif
+#if LWIP_STATS && MEMP_STATS
+    if (len < size)
+        len += stats_format_pool(buf + len, size - len, "pbuf_pool", lwip_stats.memp[MEMP_PBUF_POOL]);
+    if (len < size)
+        len += stats_format_pool(buf + len, size - len, "pbuf_ref", lwip_stats.memp[MEMP_PBUF]);
+    if (len < size)
+        len += stats_format_pool(buf + len, size - len, "tcp_pcb", lwip_stats.memp[MEMP_TCP_PCB]);
+    if (len < size)
+        len += stats_format_pool(buf + len, size - len, "tcp_seg", lwip_stats.memp[MEMP_TCP_SEG]);
+    if (len < size)
+        len += stats_format_pool(buf + len, size - len, "udp_pcb", lwip_stats.memp[MEMP_UDP_PCB]);
+#endif
+    if (len < size)
+        len += snprintf(buf + len, size - len, "}}");
+
+    // Never report more than was written (a truncated document is still better than none)
+    return (len < size) ? len : size - 1;
+}
+
+// Push the current state as one event. Returns false (and remembers it) if the
+// client is behind, so a slow reader can never pile up pbufs.
+static bool sse_send_event(http_conn_t *conn)
+{
+    char event[224];
+    int len = snprintf(event, sizeof(event), "data: ");
+    len += http_build_json(event + len, sizeof(event) - len - 2);
+    event[len++] = '\n';
+    event[len++] = '\n';
+
+    if (conn->unacked > SSE_MAX_UNACKED || tcp_sndbuf(conn->pcb) < len ||
+        http_write(conn, event, len, TCP_WRITE_FLAG_COPY) != ERR_OK)
+    {
+        conn->sse_pending = true;
+        return false;
+    }
+
+    conn->sse_pending = false;
+    conn->idle_polls = 0;
+    tcp_output(conn->pcb);
+    return true;
+}
+
+// Turn this connection into an /events stream
+static bool sse_subscribe(http_conn_t *conn)
+{
+    static const char header[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-store\r\n"
+        "Connection: keep-alive\r\n\r\n"
+        "retry: 2000\n\n";
+
+    if (tcp_sndbuf(conn->pcb) < sizeof(header) - 1)
+        return false;
+    if (http_write(conn, header, sizeof(header) - 1, 0) != ERR_OK) // Static, no copy needed
+        return false;
+
+    conn->mode = HTTP_CONN_SSE;
+    conn->close_pending = false; // The stream outlives the request
+    sse_send_event(conn);        // Current state straight away
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+// WebSocket (RFC 6455)
+// -----------------------------------------------------------------------------
+
+#define WS_OP_CONTINUATION 0x0
+#define WS_OP_TEXT 0x1
+#define WS_OP_BINARY 0x2
+#define WS_OP_CLOSE 0x8
+#define WS_OP_PING 0x9
+#define WS_OP_PONG 0xA
+
+#define WS_VERSION 13
+
+#define WS_CLOSE_PROTOCOL_ERROR 1002
+#define WS_CLOSE_TOO_BIG 1009
+
+static void ws_base64(const uint8_t *in, int len, char *out)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    for (int i = 0; i < len; i += 3)
+    {
+        uint32_t v = (uint32_t)in[i] << 16;
+        if (i + 1 < len)
+            v |= (uint32_t)in[i + 1] << 8;
+        if (i + 2 < len)
+            v |= in[i + 2];
+
+        *out++ = alphabet[(v >> 18) & 0x3F];
+        *out++ = alphabet[(v >> 12) & 0x3F];
+        *out++ = (i + 1 < len) ? alphabet[(v >> 6) & 0x3F] : '=';
+        *out++ = (i + 2 < len) ? alphabet[v & 0x3F] : '=';
+    }
+    *out = '\0';
+}
+
+// Queue one unmasked server frame (payload up to 125 bytes). All or nothing.
+static bool ws_send_frame(http_conn_t *conn, uint8_t opcode, const uint8_t *payload, uint8_t len)
+{
+    uint8_t frame[2 + WS_MAX_CONTROL_PAYLOAD];
+    frame[0] = 0x80 | opcode; // FIN, never fragmented
+    frame[1] = len;
+    if (len)
+        memcpy(frame + 2, payload, len);
+
+    if (tcp_sndbuf(conn->pcb) < len + 2u)
+        return false;
+    return http_write(conn, frame, len + 2u, TCP_WRITE_FLAG_COPY) == ERR_OK;
+}
+
+// Send the fields that changed since this client's last frame. A client that is
+// behind is skipped; since ws_last is only advanced on success, its next frame
+// carries everything it missed.
+static bool ws_send_telemetry(http_conn_t *conn)
+{
+    const uint16_t now[WS_FIELD_COUNT] = {global_r, global_g, global_b, global_correctness,
+                                          global_success_locked ? 1u : 0u, global_target_index};
+    uint8_t payload[1 + 2 * WS_FIELD_COUNT];
+    uint8_t len = 1;
+    uint8_t fields = 0;
+
+    for (int i = 0; i < WS_FIELD_COUNT; i++)
+    {
+        if (conn->ws_synced && now[i] == conn->ws_last[i])
+            continue;
+        fields |= (uint8_t)(1u << i);
+        payload[len++] = (uint8_t)(now[i] & 0xFF);
+        payload[len++] = (uint8_t)(now[i] >> 8);
+    }
+    if (!fields)
+        return true;
+    payload[0] = fields;
+
+    if (conn->unacked > WS_MAX_UNACKED || !ws_send_frame(conn, WS_OP_BINARY, payload, len))
+        return false;
+
+    memcpy(conn->ws_last, now, sizeof(now));
+    conn->ws_synced = true;
+    conn->idle_polls = 0;
+    tcp_output(conn->pcb);
+    return true;
+}
+
+static err_t ws_fail(http_conn_t *conn, uint16_t status)
+{
+    const uint8_t code[2] = {(uint8_t)(status >> 8), (uint8_t)status};
+    ws_send_frame(conn, WS_OP_CLOSE, code, sizeof(code));
+    return http_conn_close(conn);
+}
+
+// Answer the opening handshake and switch the connection to WebSocket framing
+static bool ws_upgrade(http_conn_t *conn)
+{
+    static const char ws_guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+    const char *key = conn->parser.ws_key;
+    const size_t key_len = strlen(key);
+
+    if (key_len == 0 || !conn->parser.upgrade_websocket)
+        return http_send_error(conn, http_bad_request, sizeof(http_bad_request) - 1);
+    if (conn->parser.ws_version != WS_VERSION)
+        return http_send_error(conn, http_upgrade_required, sizeof(http_upgrade_required) - 1);
+
+    // Sec-WebSocket-Accept = base64(SHA-1(key + GUID))
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    char accept[29];
+    sha1_ctx_t sha;
+    sha1_init(&sha);
+    sha1_update(&sha, key, key_len);
+    sha1_update(&sha, ws_guid, sizeof(ws_guid) - 1);
+    sha1_final(&sha, digest);
+    ws_base64(digest, sizeof(digest), accept);
+
+    char response[160];
+    int len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 101 Switching Protocols\r\n"
+                       "Upgrade: websocket\r\n"
+                       "Connection: Upgrade\r\n"
+                       "Sec-WebSocket-Accept: %s\r\n\r\n",
+                       accept);
+
+    if (tcp_sndbuf(conn->pcb) < len || http_write(conn, response, len, TCP_WRITE_FLAG_COPY) != ERR_OK)
+        return false;
+
+    conn->mode = HTTP_CONN_WEBSOCKET;
+    conn->close_pending = false;
+    conn->ws_synced = false;
+    conn->ws_skip = 0;
+    ws_send_telemetry(conn); // Full state straight away
+    return true;
+}
+
+// Handle every complete client frame received, then catch up on telemetry.
+// Frames are read straight from the pbuf chain: control frames (at most 125 bytes)
+// are copied out to answer them, data frames are skipped as they arrive.
+static err_t ws_process(http_conn_t *conn)
+{
+    while (conn->rx)
+    {
+        const uint16_t available = conn->rx->tot_len;
+
+        if (conn->ws_skip)
+        {
+            uint16_t skip = (conn->ws_skip < available) ? (uint16_t)conn->ws_skip : available;
+            http_rx_consume(conn, skip);
+            conn->ws_skip -= skip;
+            continue;
+        }
+
+        if (available < 2)
+            break;
+        const uint8_t b0 = pbuf_get_at(conn->rx, 0);
+        const uint8_t b1 = pbuf_get_at(conn->rx, 1);
+        const uint8_t opcode = b0 & 0x0F;
+        uint32_t len = b1 & 0x7F;
+        uint16_t header_len = 2;
+
+        // Client frames must be masked
+        if (!(b1 & 0x80))
+            return ws_fail(conn, WS_CLOSE_PROTOCOL_ERROR);
+        // Control frames are never fragmented and carry at most 125 bytes, so only
+        // the 7-bit length is valid for them (RFC 6455 5.5)
+        if (opcode >= WS_OP_CLOSE && (!(b0 & 0x80) || len > WS_MAX_CONTROL_PAYLOAD))
+            return ws_fail(conn, WS_CLOSE_PROTOCOL_ERROR);
+
+        if (len == 126)
+        {
+            if (available < 4)
+                break;
+            len = ((uint32_t)pbuf_get_at(conn->rx, 2) << 8) | pbuf_get_at(conn->rx, 3);
+            header_len = 4;
+        }
+        else if (len == 127)
+        {
+            if (available < 10)
+                break;
+            // Anything past 4 GB is certainly not for us
+            for (int i = 2; i < 6; i++)
+            {
+                if (pbuf_get_at(conn->rx, i))
+                    return ws_fail(conn, WS_CLOSE_TOO_BIG);
+            }
+            len = 0;
+            for (int i = 6; i < 10; i++)
+                len = (len << 8) | pbuf_get_at(conn->rx, i);
+            header_len = 10;
+        }
+        header_len += 4; // Masking key
+
+        if (opcode < WS_OP_CLOSE)
+        {
+            // Telemetry only flows to the client: drop data frames unread
+            if (opcode > WS_OP_BINARY)
+                return ws_fail(conn, WS_CLOSE_PROTOCOL_ERROR);
+            if (available < header_len)
+                break;
+            http_rx_consume(conn, header_len);
+            conn->ws_skip = len;
+            continue;
+        }
+
+        if (available < header_len + len)
+            break; // Wait for the rest
+
+        uint8_t mask[4];
+        uint8_t payload[WS_MAX_CONTROL_PAYLOAD];
+        pbuf_copy_partial(conn->rx, mask, 4, header_len - 4);
+        pbuf_copy_partial(conn->rx, payload, (u16_t)len, header_len);
+        for (uint32_t i = 0; i < len; i++)
+            payload[i] ^= mask[i & 3];
+        http_rx_consume(conn, header_len + (uint16_t)len);
+
+        switch (opcode)
+        {
+        case WS_OP_CLOSE:
+            // Echo the status code back and finish
+            ws_send_frame(conn, WS_OP_CLOSE, payload, len >= 2 ? 2 : 0);
+            tcp_output(conn->pcb);
+            return http_conn_close(conn);
+        case WS_OP_PING:
+            ws_send_frame(conn, WS_OP_PONG, payload, (uint8_t)len); // Best effort: the next ping gets one
+            break;
+        case WS_OP_PONG:
+            break;
+        default:
+            return ws_fail(conn, WS_CLOSE_PROTOCOL_ERROR);
+        }
+    }
+
+    ws_send_telemetry(conn);
+    tcp_output(conn->pcb);
+    return ERR_OK;
+}
+
+// Look the request path up in the generated asset table. Unknown paths get the
+// dashboard ("/"), as they always have.
+static const web_asset_t *http_find_asset(const char *path)
+{
+    const web_asset_t *fallback = &web_assets[0];
+
+    for (uint16_t i = 0; i < web_asset_count; i++)
+    {
+        const web_asset_t *asset = &web_assets[i];
+        if (strcmp(asset->path, path) == 0)
+            return asset;
+        if (strcmp(asset->path, "/") == 0)
+            fallback = asset;
+    }
+    return fallback;
+}
+
+// Value of name=... in a query string ("" if absent)
+static const char *http_query_param(const char *query, const char *name, char *value, int size)
+{
+    const size_t name_len = strlen(name);
+    const char *p = query;
+
+    value[0] = '\0';
+    while (*p)
+    {
+        if (strncmp(p, name, name_len) == 0 && p[name_len] == '=')
+        {
+            p += name_len + 1;
+            int len = 0;
+            while (p[len] && p[len] != '&' && len < size - 1)
+            {
+                value[len] = p[len];
+                len++;
+            }
+            value[len] = '\0';
+            break;
+        }
+        p = strchr(p, '&');
+        if (!p)
+            break;
+        p++;
+    }
+    return value;
+}
+
+// Start /history?since=<seq>[&format=bin]: everything recorded from since (or the
+// oldest entry still held) up to now, streamed by history_stream
+static bool history_start(http_conn_t *conn)
+{
+    const http_parser_t *req = &conn->parser;
+    char value[12];
+
+    uint32_t since = strtoul(http_query_param(req->query, "since", value, sizeof(value)), NULL, 10);
+    const bool binary = strcmp(http_query_param(req->query, "format", value, sizeof(value)), "bin") == 0;
+    const bool chunked = req->minor_version >= 1;
+
+    const uint32_t end = history_next_seq();
+    if (since > end)
+        since = 0; // A cursor from before a reboot: start over
+    if (since < history_oldest_seq())
+        since = history_oldest_seq();
+
+    // Without chunking the only way to mark the end is to close
+    if (!chunked)
+        conn->close_pending = true;
+
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: %s\r\n"
+                              "Cache-Control: no-store\r\n"
+                              "%s"
+                              "X-History-First: %lu\r\n"
+                              "X-History-Next: %lu\r\n"
+                              "Connection: %s\r\n\r\n",
+                              binary ? "application/octet-stream" : "text/csv",
+                              chunked ? "Transfer-Encoding: chunked\r\n" : "",
+                              (unsigned long)since, (unsigned long)end,
+                              conn->close_pending ? "close" : "keep-alive");
+
+    const u8_t flags = http_head_only(conn) ? TCP_WRITE_FLAG_COPY : TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE;
+    if (tcp_sndbuf(conn->pcb) < header_len || http_write(conn, header, header_len, flags) != ERR_OK)
+        return false;
+    if (http_head_only(conn))
+        return true;
+
+    conn->history_active = true;
+    conn->history_binary = binary;
+    conn->history_chunked = chunked;
+    conn->history_seq = since;
+    conn->history_end = end;
+    history_stream(conn);
+    return true;
+}
+
+// True while another connection is still copying stats_body out
+static bool stats_busy(const http_conn_t *conn)
+{
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        const http_conn_t *other = &http_conns[i];
+        if (other != conn && other->in_use && other->tx_copy && other->tx_left > 0)
+            return true;
+    }
+    return false;
+}
+
+// Start /stats. The document is too big to copy into the lwIP heap in one go next
+// to other traffic, so only the header has to fit now and the body streams behind it
+// like a static page, each piece retried on the next ACK until lwIP takes it.
+static bool stats_start(http_conn_t *conn)
+{
+    if (stats_busy(conn))
+        return false; // Retried from poll once the other response is queued
+
+    const int body_len = stats_format_json(stats_body, sizeof(stats_body));
+    char header[256];
+    const int header_len = http_format_header(conn, header, sizeof(header), "application/json", body_len);
+
+    const u8_t flags = http_head_only(conn) ? TCP_WRITE_FLAG_COPY : TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE;
+    if (tcp_sndbuf(conn->pcb) < header_len || tcp_sndqueuelen(conn->pcb) > TCP_SND_QUEUELEN - 4 ||
+        http_write(conn, header, header_len, flags) != ERR_OK)
+        return false;
+    if (http_head_only(conn))
+        return true;
+
+    conn->tx_ptr = stats_body;
+    conn->tx_left = body_len;
+    conn->tx_copy = true;
+    http_stream(conn);
+    return true;
+}
+
+// Route the parsed request. Returns false if the response could not be queued yet.
+static bool http_handle_request(http_conn_t *conn)
+{
+    const http_parser_t *req = &conn->parser;
+
+    // 0. Everything here is read-only; HEAD gets the GET headers without the body
+    if (req->method != HTTP_METHOD_GET && req->method != HTTP_METHOD_HEAD)
+    {
+        return http_send_error(conn, http_method_not_allowed, sizeof(http_method_not_allowed) - 1);
+    }
+    else if (req->method == HTTP_METHOD_HEAD && (strcmp(req->path, "/events") == 0 || strcmp(req->path, "/ws") == 0))
+    {
+        return http_send_error(conn, http_stream_not_allowed, sizeof(http_stream_not_allowed) - 1);
     }
     // 1. Check if the browser is asking for DATA (JSON)
-    else if (strstr(request, "GET /data"))
-    {
-        char json_body[128];
-        snprintf(json_body, sizeof(json_body), "{\"r\":%d,\"g\":%d,\"b\":%d,\"correctness\":%.1f,\"success\":%s}",
-                 global_r, global_g, global_b, global_correctness,
-                 global_success_locked ? "true" : "false");
-
-        char header[256];
-        int body_len = strlen(json_body);
-        int header_len = snprintf(header, sizeof(header),
-                                  "HTTP/1.1 200 OK\r\n"
-                                  "Content-Type: application/json\r\n"
-                                  "Connection: close\r\n"
-                                  "Cache-Control: no-store, no-cache, must-revalidate, max-age=0\r\n"
-                                  "Pragma: no-cache\r\n"
-                                  "Content-Length: %d\r\n\r\n",
-                                  body_len);
-
-        tcp_write(tpcb, header, header_len, TCP_WRITE_FLAG_COPY);
-        tcp_write(tpcb, json_body, body_len, TCP_WRITE_FLAG_COPY);
-        tcp_output(tpcb);
-        tcp_close(tpcb);
-    }
-    // 2. Otherwise, send the DASHBOARD (HTML)
+    else if (strcmp(req->path, "/data") == 0)
+    {
+        char json_body[192];
+        int body_len = http_build_json(json_body, sizeof(json_body));
+        return http_send_response(conn, "application/json", json_body, body_len);
+    }
+    // 2. Live updates pushed as Server-Sent Events
+    else if (strcmp(req->path, "/events") == 0)
+    {
+        return sse_subscribe(conn);
+    }
+    // 3. Binary telemetry over WebSocket
+    else if (strcmp(req->path, "/ws") == 0)
+    {
+        return ws_upgrade(conn);
+    }
+    // 4. Recorded readings since a sequence number
+    else if (strcmp(req->path, "/history") == 0)
+    {
+        return history_start(conn);
+    }
+    // 5. Runtime statistics
+    else if (strcmp(req->path, "/stats") == 0)
+    {
+        return stats_start(conn);
+    }
+    // 6. Otherwise, an embedded page (success page, dashboard, ...), gzipped if the client takes it
     else
     {
-        int body_len = strlen(html_page_body);
-        char header[256];
-        int header_len = snprintf(header, sizeof(header),
-                                  "HTTP/1.1 200 OK\r\n"
-                                  "Content-Type: text/html; charset=utf-8\r\n"
-                                  "Connection: close\r\n"
-                                  "Cache-Control: no-store, no-cache, must-revalidate, max-age=0\r\n"
-                                  "Pragma: no-cache\r\n"
-                                  "Content-Length: %d\r\n\r\n",
-                                  body_len);
+        const web_asset_t *asset = http_find_asset(req->path);
+        const web_asset_body_t *page = req->accept_gzip ? &asset->gzip : &asset->identity;
+        return http_send_static(conn, page, http_etag_matches(req->if_none_match, page->etag));
+    }
+}
+
+// Serve every complete (possibly pipelined) request waiting in the buffer, in order.
+// Stops early if lwIP runs out of send space; tcp_sent / poll resume it later.
+static err_t http_process(http_conn_t *conn)
+{
+    if (conn->mode == HTTP_CONN_WEBSOCKET)
+        return ws_process(conn);
+
+    if (conn->mode == HTTP_CONN_SSE)
+    {
+        // An event stream only talks one way; anything the client sends is ignored
+        if (conn->rx)
+            http_rx_consume(conn, conn->rx->tot_len);
+        if (conn->sse_pending)
+            sse_send_event(conn);
+        return ERR_OK;
+    }
+
+    bool drained = false; // Every complete request has been answered and queued
+    while (!conn->close_pending && conn->mode == HTTP_CONN_REQUEST)
+    {
+        // Responses go out in order: finish the current body before the next request
+        if (!http_stream(conn))
+            break;
+
+        if (!conn->request_ready)
+        {
+            http_parse_result_t result = http_rx_parse(conn);
+            if (result == HTTP_PARSE_INCOMPLETE)
+            {
+                drained = true;
+                break;
+            }
+            if (result == HTTP_PARSE_ERROR)
+            {
+                // Malformed or oversized: answer 400 (or just close if even that does not fit)
+                if (!http_send_error(conn, http_bad_request, sizeof(http_bad_request) - 1))
+                    return http_conn_close(conn);
+                break;
+            }
+            conn->request_ready = true;
+        }
+
+        conn->close_pending = !conn->parser.keep_alive;
+        if (!http_handle_request(conn))
+        {
+            conn->close_pending = false; // Not sent yet, retried from tcp_sent / poll
+            break;
+        }
 
-        tcp_write(tpcb, header, header_len, TCP_WRITE_FLAG_COPY);
-        tcp_write(tpcb, html_page_body, body_len, TCP_WRITE_FLAG_COPY);
-        tcp_output(tpcb);
-        tcp_close(tpcb);
+        conn->request_ready = false;
+        http_parser_reset(&conn->parser);
     }
 
-    pbuf_free(p);
+    // A client that half-closed sends no more requests: close once the last answer is
+    // out (a stream it asked for last has no reader to keep it open)
+    if (conn->peer_closed && (drained || conn->mode != HTTP_CONN_REQUEST))
+    {
+        if (conn->mode != HTTP_CONN_REQUEST)
+            return http_conn_close(conn);
+        conn->close_pending = true;
+    }
+
+    // A closing connection still has to finish its body
+    if (conn->close_pending)
+        http_stream(conn);
+
+    tcp_output(conn->pcb);
+
+    if (conn->close_pending && conn->tx_left == 0 && !conn->history_active)
+        return http_conn_close(conn);
     return ERR_OK;
 }
 
-static err_t connection_callback(void *arg, struct tcp_pcb *newpcb, err_t err)
+// -----------------------------------------------------------------------------
+// lwIP callbacks
+// -----------------------------------------------------------------------------
+
+static err_t http_recv_cb(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
 {
-    tcp_recv(newpcb, http_callback);
-    tcp_err(newpcb, NULL); // optional: we could set a real err callback
-    // Close lingering connections via poll callback
-    tcp_poll(newpcb, poll_close_cb, (u8_t)4);
-    tcp_nagle_disable(newpcb);
-    tcp_setprio(newpcb, TCP_PRIO_NORMAL);
-    return ERR_OK;
+    (void)err;
+    http_conn_t *conn = (http_conn_t *)arg;
+
+    // Remote side closed. It may still be reading: finish the responses (and pipelined
+    // requests) it is owed first, http_process closes once they are all queued. Streams
+    // have nothing owed and close now.
+    if (p == NULL)
+    {
+        if (!conn)
+            return tcp_close(tpcb);
+        if (conn->mode != HTTP_CONN_REQUEST)
+            return http_conn_close(conn);
+        conn->peer_closed = true;
+        return http_process(conn);
+    }
+
+    if (!conn)
+    {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+
+    // Keep the chain as it is; the parser walks it in place and tcp_recved is
+    // only called for what has been consumed
+    if (conn->rx)
+        pbuf_cat(conn->rx, p);
+    else
+        conn->rx = p;
+
+    conn->idle_polls = 0;
+    return http_process(conn);
+}
+
+static err_t http_sent_cb(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+    (void)tpcb;
+    http_conn_t *conn = (http_conn_t *)arg;
+    if (!conn)
+        return ERR_OK;
+
+    conn->unacked = (len < conn->unacked) ? (conn->unacked - len) : 0;
+    // The client is reading: a long /history or a slow static send is not idle
+    conn->idle_polls = 0;
+
+    // Send space freed up: serve pipelined requests that were waiting for it
+    return http_process(conn);
 }
 
-// Poll callback: close connection to avoid leaks if lingering
-static err_t poll_close_cb(void *arg, struct tcp_pcb *tpcb)
+// Poll callback: resume stalled work and close idle keep-alive connections
+static err_t http_poll_cb(void *arg, struct tcp_pcb *tpcb)
+{
+    http_conn_t *conn = (http_conn_t *)arg;
+    if (!conn)
+    {
+        tcp_abort(tpcb);
+        return ERR_ABRT;
+    }
+
+    if (conn->mode == HTTP_CONN_WEBSOCKET)
+    {
+        if (++conn->idle_polls >= WS_PING_POLLS && conn->unacked == 0)
+        {
+            ws_send_frame(conn, WS_OP_PING, NULL, 0);
+            tcp_output(tpcb);
+            conn->idle_polls = 0;
+        }
+        return ws_process(conn);
+    }
+
+    if (conn->mode == HTTP_CONN_SSE)
+    {
+        // Streams never time out, but keep them warm while nothing changes
+        if (++conn->idle_polls >= SSE_HEARTBEAT_POLLS && conn->unacked == 0 && tcp_sndbuf(conn->pcb) >= 3)
+        {
+            http_write(conn, ":\n\n", 3, 0);
+            tcp_output(tpcb);
+            conn->idle_polls = 0;
+        }
+        return http_process(conn);
+    }
+
+    if (++conn->idle_polls >= HTTP_IDLE_TIMEOUT_POLLS)
+        return http_conn_close(conn);
+
+    return http_process(conn);
+}
+
+static void http_err_cb(void *arg, err_t err)
+{
+    (void)err;
+    // lwIP has already freed the PCB
+    if (arg)
+        http_conn_free((http_conn_t *)arg);
+}
+
+static err_t connection_callback(void *arg, struct tcp_pcb *newpcb, err_t err)
 {
     (void)arg;
-    tcp_close(tpcb);
+    if (err != ERR_OK || newpcb == NULL)
+        return ERR_VAL;
+
+    http_conn_t *conn = http_conn_alloc();
+    conn->pcb = newpcb;
+    conn->in_use = true;
+    conn->close_pending = false;
+    conn->peer_closed = false;
+    conn->idle_polls = 0;
+    conn->mode = HTTP_CONN_REQUEST;
+    conn->sse_pending = false;
+    conn->unacked = 0;
+    conn->tx_left = 0;
+    conn->tx_copy = false;
+    conn->history_active = false;
+    conn->rx = NULL;
+    conn->request_ready = false;
+    http_parser_reset(&conn->parser);
+
+    tcp_arg(newpcb, conn);
+    tcp_recv(newpcb, http_recv_cb);
+    tcp_sent(newpcb, http_sent_cb);
+    tcp_err(newpcb, http_err_cb);
+    tcp_poll(newpcb, http_poll_cb, HTTP_POLL_INTERVAL);
+    tcp_nagle_disable(newpcb);
+    tcp_setprio(newpcb, TCP_PRIO_NORMAL);
     return ERR_OK;
 }
 
@@ -176,6 +1171,10 @@ void wifi_init_ap(const char *ssid, const char *password)
         return;
     cyw43_arch_enable_ap_mode(ssid, password, CYW43_AUTH_WPA2_AES_PSK);
 
+    // From here on lwIP runs from the background async_context (cyw43 IRQ and
+    // lwIP timers), so every call from this context goes under the lwIP lock
+    cyw43_arch_lwip_begin();
+
     struct netif *n = &cyw43_state.netif[CYW43_ITF_AP];
     ip4_addr_t ip, mask;
     IP4_ADDR(&ip, 192, 168, 4, 1);
@@ -184,13 +1183,58 @@ void wifi_init_ap(const char *ssid, const char *password)
     netif_set_netmask(n, &mask);
     netif_set_up(n);
 
+    history_init();
+    udp_telemetry_init();
+
     struct tcp_pcb *pcb = tcp_new();
     tcp_bind(pcb, IP_ADDR_ANY, 80);
     pcb = tcp_listen(pcb);
     tcp_accept(pcb, connection_callback);
+
+    cyw43_arch_lwip_end();
+}
+
+// Push to every /events subscriber if the state moved enough since the last push (lwIP lock held)
+static void sse_publish(void)
+{
+    const uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    const bool changed =
+        (global_r > sse_last_r ? global_r - sse_last_r : sse_last_r - global_r) >= SSE_MIN_DELTA_HZ ||
+        (global_g > sse_last_g ? global_g - sse_last_g : sse_last_g - global_g) >= SSE_MIN_DELTA_HZ ||
+        (global_b > sse_last_b ? global_b - sse_last_b : sse_last_b - global_b) >= SSE_MIN_DELTA_HZ ||
+        (global_correctness > sse_last_correctness ? global_correctness - sse_last_correctness
+                                                   : sse_last_correctness - global_correctness) >= SSE_MIN_DELTA_CORRECTNESS ||
+        global_success_locked != sse_last_success;
+
+    // The success transition is always delivered immediately
+    if (!changed || ((now_ms - sse_last_push_ms) < SSE_MIN_INTERVAL_MS && global_success_locked == sse_last_success))
+        return;
+
+    sse_last_r = global_r;
+    sse_last_g = global_g;
+    sse_last_b = global_b;
+    sse_last_correctness = global_correctness;
+    sse_last_success = global_success_locked;
+    sse_last_push_ms = now_ms;
+
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        if (http_conns[i].in_use && http_conns[i].mode == HTTP_CONN_SSE)
+            sse_send_event(&http_conns[i]);
+    }
+}
+
+// Stream to every WebSocket client at the sensor rate (deltas only, no rate limit; lwIP lock held)
+static void ws_publish(void)
+{
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        if (http_conns[i].in_use && http_conns[i].mode == HTTP_CONN_WEBSOCKET)
+            ws_send_telemetry(&http_conns[i]);
+    }
 }
 
-void wifi_update_data(uint16_t r, uint16_t g, uint16_t b, float correctness)
+void wifi_update_data(uint16_t r, uint16_t g, uint16_t b, uint16_t correctness)
 {
     // Once success is locked, freeze the display values
     if (global_success_locked)
@@ -199,6 +1243,11 @@ void wifi_update_data(uint16_t r, uint16_t g, uint16_t b, float correctness)
         return;
     }
 
+    // lwIP callbacks read this state from the background context: update it and
+    // push it out in one critical section so no response sees a half-written reading
+    const uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    cyw43_arch_lwip_begin();
+
     // Update display with current values
     global_r = r;
     global_g = g;
@@ -206,15 +1255,43 @@ void wifi_update_data(uint16_t r, uint16_t g, uint16_t b, float correctness)
     global_correctness = correctness;
 
     // Lock success state at 97%
-    if (correctness >= 97.0f)
+    if (correctness >= CORRECTNESS_SUCCESS)
     {
         global_success_locked = true;
-        global_correctness = 97.0f; // Freeze at 97% so browser sees consistent state
+        global_correctness = CORRECTNESS_SUCCESS; // Freeze at 97% so browser sees consistent state
     }
+
+    history_add(now_ms, global_r, global_g, global_b, global_correctness);
+    udp_telemetry_publish(now_ms, global_r, global_g, global_b, global_correctness, global_success_locked);
+    sse_publish();
+    ws_publish();
+
+    cyw43_arch_lwip_end();
+}
+
+int wifi_format_stats(char *buf, int size)
+{
+    cyw43_arch_lwip_begin();
+    int len = stats_format_json(buf, size);
+    cyw43_arch_lwip_end();
+    return len;
+}
+
+void wifi_update_target(uint16_t index, const char *name)
+{
+    if (global_success_locked)
+        return;
+
+    cyw43_arch_lwip_begin();
+    global_target_index = index;
+    strncpy(global_target_name, name, TARGET_NAME_LEN);
+    global_target_name[TARGET_NAME_LEN] = '\0';
+    cyw43_arch_lwip_end();
 }
 
 void wifi_poll(void)
 {
+    // Nothing to do with the threadsafe_background arch; kept for poll-mode builds
     cyw43_arch_poll();
 }
 
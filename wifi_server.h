@@ -8,12 +8,25 @@
 void wifi_init_ap(const char *ssid, const char *password);
 
 // Update the data that gets sent to the web browser
-void wifi_update_data(uint16_t r, uint16_t g, uint16_t b, float correctness);
+// correctness is in tenths of a percent (0-1000, see correctness.h)
+// Also pushes it to /events subscribers and, as binary delta frames, to /ws clients,
+// and records it for /history?since=<seq>[&format=bin] (CSV rows or packed
+// 16-byte records: seq, time_ms, r, g, b, correctness, little-endian)
+// With UDP_TELEMETRY_ENABLED it is also broadcast to UDP port 4210 (see udp_telemetry.h)
+void wifi_update_data(uint16_t r, uint16_t g, uint16_t b, uint16_t correctness);
+
+// Report which target color is currently closest (shown on the dashboard)
+void wifi_update_target(uint16_t index, const char *name);
+
+// Format the /stats document (stage timings, scheduler jitter, lwIP memory, connections) into buf.
+// Returns its length; the output is truncated to size - 1 characters if needed.
+int wifi_format_stats(char *buf, int size);
 
 // Check if success has been locked (>=97%)
 bool wifi_is_success_locked(void);
 
-// Poll function to handle network traffic (call in main loop)
+// Networking runs in the background (cyw43 IRQ / async_context), so the main loop
+// does not need to call this; it only services poll-mode (pico_cyw43_arch_lwip_poll) builds
 void wifi_poll(void);
 
 #endif
\ No newline at end of file